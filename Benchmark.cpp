@@ -0,0 +1,195 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+static std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+static std::string baseName(const std::string& fileName) {
+    size_t slash = fileName.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? fileName : fileName.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+// Contents of a JSON string: names and camera paths may hold backslashes (Windows paths) or quotes
+static std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        unsigned char u = (unsigned char)c;
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (c == '\t') {
+            escaped += "\\t";
+        } else if (c == '\r') {
+            escaped += "\\r";
+        } else if (u < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", u);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool BenchmarkScenario::load(const char* fileName) {
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open benchmark scenario " << fileName << std::endl;
+        return false;
+    }
+
+    name = baseName(fileName);
+    float duration = -1.0f;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            std::cerr << fileName << ":" << lineNumber << ": expected key = value" << std::endl;
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        bool valid = true;
+        if (key == "name") name = value;
+        else if (key == "mode") {
+            if (value == "simulation") mode = SIMULATION;
+            else if (value == "render") mode = RENDER;
+            else if (value == "combined") mode = COMBINED;
+            else valid = false;
+        }
+        else if (key == "fish") valid = (fish = atoi(value.c_str())) >= 0;
+        else if (key == "corals") valid = (corals = atoi(value.c_str())) >= 0;
+        else if (key == "stones") valid = (stones = atoi(value.c_str())) >= 0;
+        else if (key == "seed") {
+            seed = (unsigned)strtoul(value.c_str(), NULL, 10);
+            seedSet = true;
+        }
+        else if (key == "resolution") {
+            valid = sscanf(value.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+        }
+        else if (key == "camera") valid = !(camera = value).empty();
+        else if (key == "frames") valid = (frames = atoi(value.c_str())) > 0;
+        else if (key == "duration") valid = (duration = (float)atof(value.c_str())) > 0.0f;
+        else if (key == "timestep") valid = (timestep = (float)atof(value.c_str())) > 0.0f;
+        else if (key == "warmup") valid = (warmupFrames = atoi(value.c_str())) >= 0;
+        else {
+            std::cerr << fileName << ":" << lineNumber << ": unknown key " << key << std::endl;
+            return false;
+        }
+
+        if (!valid) {
+            std::cerr << fileName << ":" << lineNumber << ": invalid " << key << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    // Duration is simulated time, so the frame count doesn't depend on how fast the machine is
+    if (duration > 0.0f) {
+        frames = std::max(1, (int)ceilf(duration / timestep));
+    }
+    return true;
+}
+
+const char* BenchmarkScenario::getModeName() const {
+    switch (mode) {
+    case SIMULATION: return "simulation";
+    case RENDER: return "render";
+    default: return "combined";
+    }
+}
+
+double BenchmarkReport::percentile(double p) const {
+    if (frameTimes.empty()) return 0.0;
+    std::vector<double> sorted(frameTimes);
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+bool BenchmarkReport::writeJson(const char* fileName, const BenchmarkScenario& scenario, double setupMilliseconds) const {
+    FILE* file = stdout;
+    if (fileName != NULL) {
+        #pragma warning(suppress : 4996)
+        file = fopen(fileName, "w");
+        if (file == NULL) return false;
+    }
+
+    double total = 0.0;
+    for (double frameTime : frameTimes) {
+        total += frameTime;
+    }
+    const double frameCount = (double)frameTimes.size();
+    const double framesPerSecond = total > 0.0 ? frameCount * 1000.0 / total : 0.0;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scenario\": \"%s\",\n", jsonEscape(scenario.name).c_str());
+    fprintf(file, "  \"mode\": \"%s\",\n", scenario.getModeName());
+    fprintf(file, "  \"fish\": %d,\n  \"corals\": %d,\n  \"stones\": %d,\n", scenario.fish, scenario.corals, scenario.stones);
+    fprintf(file, "  \"seed\": %u,\n", scenario.seed);
+    fprintf(file, "  \"resolution\": [%d, %d],\n", scenario.width, scenario.height);
+    fprintf(file, "  \"camera\": \"%s\",\n", jsonEscape(scenario.camera).c_str());
+    fprintf(file, "  \"timestep\": %.6f,\n", scenario.timestep);
+    fprintf(file, "  \"warmupFrames\": %d,\n", scenario.warmupFrames);
+    fprintf(file, "  \"frames\": %d,\n", (int)frameTimes.size());
+    fprintf(file, "  \"setupMs\": %.3f,\n", setupMilliseconds);
+    fprintf(file, "  \"totalMs\": %.3f,\n", total);
+    fprintf(file, "  \"frameTimeMs\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+        frameCount > 0.0 ? total / frameCount : 0.0, percentile(0.0), percentile(50.0), percentile(95.0), percentile(99.0), percentile(100.0));
+    fprintf(file, "  \"framesPerSecond\": %.3f,\n", framesPerSecond);
+    if (scenario.simulates() && scenario.fish >= 0) {
+        fprintf(file, "  \"fishUpdatesPerSecond\": %.1f,\n", framesPerSecond * scenario.fish);
+    }
+    fprintf(file, "  \"peakMemoryBytes\": %zu\n", peakMemoryBytes());
+    fprintf(file, "}\n");
+
+    if (file != stdout) fclose(file);
+    return true;
+}
+
+size_t peakMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;         // bytes
+#else
+    return (size_t)usage.ru_maxrss * 1024;  // kilobytes
+#endif
+#endif
+}
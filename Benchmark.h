@@ -0,0 +1,65 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+// Benchmark scenario run by --benchmark (see benchmarks/*.txt).
+// A scenario is a text file of "key = value" lines, '#' starts a comment:
+//
+//     mode = combined        # simulation, render or combined
+//     fish = 10000           # population; omitted = the normal random scene
+//     corals = 5
+//     stones = 6
+//     seed = 42
+//     resolution = 1280x720
+//     camera = orbit         # orbit, fixed or a recorded .aqcp file
+//     duration = 10          # simulated seconds (or: frames = 600)
+//     timestep = 0.016667
+//     warmup = 30            # frames run before measuring
+struct BenchmarkScenario {
+    enum Mode { SIMULATION, RENDER, COMBINED };
+
+    std::string name;           // file name without directory and extension
+    Mode mode = COMBINED;
+    int fish = -1;              // -1 = default random population
+    int corals = -1;
+    int stones = -1;
+    unsigned seed = 1;
+    bool seedSet = false;       // the file has a seed (otherwise a camera recording uses its own)
+    int width = 1280;
+    int height = 720;
+    std::string camera = "orbit"; // orbit, fixed or a camera recording
+    int frames = 600;           // measured frames
+    int warmupFrames = 30;
+    float timestep = 1.0f / 60.0f;
+
+    // Parse a scenario file; prints the problem and returns false on error
+    bool load(const char* fileName);
+
+    const char* getModeName() const;
+    bool simulates() const { return mode != RENDER; }
+    bool renders() const { return mode != SIMULATION; }
+};
+
+// Frame times of a benchmark run and the JSON report built from them
+class BenchmarkReport {
+private:
+    std::vector<double> frameTimes; // ms, in frame order
+
+public:
+    void reserve(int frames) { frameTimes.reserve(frames); }
+    void addFrame(double milliseconds) { frameTimes.push_back(milliseconds); }
+
+    // Nearest-rank percentile of the frame times in ms (p in 0..100)
+    double percentile(double p) const;
+
+    // Write the report as JSON to a file, or to stdout if fileName is NULL
+    bool writeJson(const char* fileName, const BenchmarkScenario& scenario, double setupMilliseconds) const;
+};
+
+// Peak resident set size of the process in bytes (0 if unknown)
+size_t peakMemoryBytes();
+
+#endif // BENCHMARK_H
@@ -0,0 +1,147 @@
+#include "CameraPath.h"
+#include <algorithm>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+static const char MAGIC[4] = { 'A', 'Q', 'C', 'P' };
+static const int FLOATS_PER_SAMPLE = 7;
+
+// Explicit byte order, so recordings move between machines
+static void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((unsigned char)(value >> (8 * i)));
+    }
+}
+
+static void putF32(std::vector<unsigned char>& out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    putU32(out, bits);
+}
+
+static uint32_t getU32(const unsigned char* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static float getF32(const unsigned char* in) {
+    uint32_t bits = getU32(in);
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+CameraPath::Sample CameraPath::sample(float time) const {
+    if (samples.empty()) return Sample();
+    if (time <= samples.front().time) return samples.front();
+    if (time >= samples.back().time) return samples.back();
+
+    // First sample later than time; the one before it is at or before time
+    auto next = std::upper_bound(samples.begin(), samples.end(), time,
+        [](float t, const Sample& s) { return t < s.time; });
+    const Sample& b = *next;
+    const Sample& a = *(next - 1);
+
+    float span = b.time - a.time;
+    float t = span > 0.0f ? (time - a.time) / span : 1.0f;
+
+    Sample result;
+    result.time = time;
+    result.position = glm::mix(a.position, b.position, t);
+    result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+    result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    result.fov = a.fov + (b.fov - a.fov) * t;
+    return result;
+}
+
+bool CameraPath::save(const char* fileName) const {
+    std::vector<unsigned char> data;
+    data.reserve(16 + samples.size() * FLOATS_PER_SAMPLE * 4);
+    data.insert(data.end(), MAGIC, MAGIC + 4);
+    putU32(data, VERSION);
+    putU32(data, seed);
+    putU32(data, (uint32_t)samples.size());
+    for (const Sample& s : samples) {
+        putF32(data, s.time);
+        putF32(data, s.position.x);
+        putF32(data, s.position.y);
+        putF32(data, s.position.z);
+        putF32(data, s.yaw);
+        putF32(data, s.pitch);
+        putF32(data, s.fov);
+    }
+
+    #pragma warning(suppress : 4996)
+    FILE* file = fopen(fileName, "wb");
+    if (file == NULL) {
+        std::cerr << "Cannot write camera path " << fileName << std::endl;
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    if (!written) {
+        std::cerr << "Cannot write camera path " << fileName << std::endl;
+    }
+    return written;
+}
+
+bool CameraPath::load(const char* fileName) {
+    #pragma warning(suppress : 4996)
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        std::cerr << "Cannot open camera path " << fileName << std::endl;
+        return false;
+    }
+
+    unsigned char header[16];
+    bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+        memcmp(header, MAGIC, 4) == 0 && getU32(header + 4) == VERSION;
+    if (!valid) {
+        std::cerr << fileName << " is not a version " << VERSION << " camera path" << std::endl;
+        fclose(file);
+        return false;
+    }
+
+    // The sample count comes from the file: check it against the file size before allocating
+    uint32_t count = getU32(header + 12);
+    long dataStart = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, dataStart, SEEK_SET);
+    uint64_t dataSize = (uint64_t)count * FLOATS_PER_SAMPLE * 4;
+    if (count == 0 || dataStart < 0 || fileSize < dataStart || dataSize > (uint64_t)(fileSize - dataStart)) {
+        std::cerr << "Camera path " << fileName << " is truncated or empty" << std::endl;
+        fclose(file);
+        return false;
+    }
+    std::vector<unsigned char> data((size_t)dataSize);
+    bool complete = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    if (!complete) {
+        std::cerr << "Camera path " << fileName << " is truncated or empty" << std::endl;
+        return false;
+    }
+
+    seed = getU32(header + 8);
+    samples.resize(count);
+    const unsigned char* in = data.data();
+    for (Sample& s : samples) {
+        s.time = getF32(in);
+        s.position = glm::vec3(getF32(in + 4), getF32(in + 8), getF32(in + 12));
+        s.yaw = getF32(in + 16);
+        s.pitch = getF32(in + 20);
+        s.fov = getF32(in + 24);
+        in += FLOATS_PER_SAMPLE * 4;
+    }
+
+    // sample() searches the times, so they must not decrease (this also rejects NaN)
+    for (size_t i = 0; i < samples.size(); ++i) {
+        bool ordered = i == 0 ? samples[i].time == samples[i].time : samples[i].time >= samples[i - 1].time;
+        if (!ordered) {
+            std::cerr << "Camera path " << fileName << " has sample times out of order" << std::endl;
+            samples.clear();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+// Recorded camera motion for reproducible performance runs (record with R,
+// replay with --camera FILE.aqcp, also headless and in benchmark scenarios).
+//
+// File layout, all fields little-endian:
+//     char[4]  "AQCP"
+//     uint32   version (1)
+//     uint32   scene seed (Random::getSeed() while recording)
+//     uint32   sample count
+//     samples: float time, x, y, z, yaw, pitch, fov (28 bytes each)
+//
+// Samples are taken once per rendered frame at real frame times; replay
+// interpolates them at whatever (fixed) timestep the replay runs with.
+class CameraPath {
+public:
+    struct Sample {
+        float time; // seconds since the recording started
+        glm::vec3 position;
+        float yaw;  // degrees, as in mouseCallback
+        float pitch;
+        float fov;
+    };
+
+    static const uint32_t VERSION = 1;
+
+private:
+    std::vector<Sample> samples;
+    uint32_t seed;
+
+public:
+    CameraPath() : seed(0) {}
+
+    void clear() { samples.clear(); }
+
+    // Append a sample; times must not decrease
+    void add(const Sample& sample) { samples.push_back(sample); }
+
+    bool empty() const { return samples.empty(); }
+    size_t size() const { return samples.size(); }
+    float getDuration() const { return samples.empty() ? 0.0f : samples.back().time; }
+
+    uint32_t getSeed() const { return seed; }
+    void setSeed(uint32_t value) { seed = value; }
+
+    // Camera state at a time, linearly interpolated and clamped to the recording
+    Sample sample(float time) const;
+
+    // Print the problem and return false on I/O or format errors
+    bool save(const char* fileName) const;
+    bool load(const char* fileName);
+};
+
+#endif // CAMERA_PATH_H
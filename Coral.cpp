@@ -1,22 +1,22 @@
 #include "Coral.h"
+#include "Random.h"
+#include "constants.h"
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 #include <algorithm>
 
+static const char* CORAL_MODEL = "coral.obj";
+static const char* CORAL_TEXTURE = "coral.png";
+
 Coral::Coral(const std::string& objPath, const std::string& texturePath,
     glm::vec3 pos, glm::vec3 rot, glm::vec3 scl)
     : position(pos), rotation(rot), scale(scl) {
 
-    ModelLoader loader;
-    modelData = loader.loadModel(objPath, texturePath);
-
-    if (!modelData) {
-        std::cerr << "Failed to load coral model: " << objPath << std::endl;
-    }
+    // Loaded once per model file; a failed load is reported once by the loader
+    modelData = ModelLoader::loadShared(objPath, texturePath);
 
     // Initialize random sway properties for each coral
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = Random::engine();
     std::uniform_real_distribution<float> speedDist(0.6f, 1.2f);
     std::uniform_real_distribution<float> ampDist(0.8f, 1.5f);
 
@@ -29,18 +29,16 @@ void Coral::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::
 
     shader->use();
 
-    // Create model matrix
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, position);
-    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::scale(model, scale);
+    // Create model and normal matrices once per instance (not per vertex in the shader)
+    Transform transform = Transform::fromEulerDegrees(position, rotation, scale);
+    glm::mat4 model = transform.matrix();
+    glm::mat3 normalMatrix = transform.normalMatrix();
 
     // Send matrices to shader
     glUniformMatrix4fv(shader->u("P"), 1, false, glm::value_ptr(projection));
     glUniformMatrix4fv(shader->u("V"), 1, false, glm::value_ptr(view));
     glUniformMatrix4fv(shader->u("M"), 1, false, glm::value_ptr(model));
+    glUniformMatrix3fv(shader->u("N"), 1, false, glm::value_ptr(normalMatrix));
     glUniform1f(shader->u("time"), time * swaySpeed);  // Individual sway timing
     glUniform1f(shader->u("swayAmplitude"), swayAmplitude);  // Individual sway strength
     glUniform3fv(shader->u("cameraPos"), 1, glm::value_ptr(glm::vec3(0.0f))); // Will be set properly in main
@@ -49,7 +47,7 @@ void Coral::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::
     if (modelData->texture != 0) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, modelData->texture);
-        glUniform1i(shader->u("coralTexture"), 0);
+        glUniform1i(shader->u("diffuseTexture"), 0);
     }
 
     // Draw the coral
@@ -58,22 +56,30 @@ void Coral::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::
     glBindVertexArray(0);
 }
 
+std::vector<std::string> Coral::textureFiles() {
+    return { CORAL_TEXTURE };
+}
+
 std::vector<std::unique_ptr<Coral>> Coral::createRandomCorals(
-    const std::vector<std::unique_ptr<Stone>>& existingStones) {
+    const std::vector<std::unique_ptr<Stone>>& existingStones, int count) {
 
     std::vector<std::unique_ptr<Coral>> corals;
 
     // Random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = Random::engine();
     std::uniform_real_distribution<float> xDist(-6.0f, 6.0f);  // Inside aquarium X bounds (with margin)
     std::uniform_real_distribution<float> zDist(-4.0f, 4.0f);  // Inside aquarium Z bounds (with margin)
     std::uniform_real_distribution<float> scaleDist(0.4f, 0.8f);  // Similar to stones
     std::uniform_real_distribution<float> yRotDist(0.0f, 360.0f); // Only Y rotation for upright corals
 
-    // Create 3-5 corals
+    // Create 3-5 corals unless a count is given
     std::uniform_int_distribution<int> countDist(3, 5);
-    int coralCount = countDist(gen);
+    int coralCount = count < 0 ? countDist(gen) : count;
+
+    // Without the (quadratic) spacing check every first position is taken
+    const bool spaced = coralCount <= MAX_SPACED_OBJECTS && (int)existingStones.size() <= MAX_SPACED_OBJECTS;
+    const bool logEach = coralCount <= MAX_LOGGED_OBJECTS;
+    corals.reserve(coralCount);
 
     for (int i = 0; i < coralCount; ++i) {
         glm::vec3 position;
@@ -90,6 +96,7 @@ std::vector<std::unique_ptr<Coral>> Coral::createRandomCorals(
 
             // Check distance from existing stones
             validPosition = true;
+            if (!spaced) break;
             for (const auto& stone : existingStones) {
                 float distance = glm::length(position - stone->getPosition());
                 if (distance < 2.5f) { // Slightly more space than stones need
@@ -125,11 +132,13 @@ std::vector<std::unique_ptr<Coral>> Coral::createRandomCorals(
             glm::vec3 scale(uniformScale, uniformScale, uniformScale);
 
             // Create coral
-            auto coral = std::make_unique<Coral>("coral.obj", "coral.png", position, rotation, scale);
+            auto coral = std::make_unique<Coral>(CORAL_MODEL, CORAL_TEXTURE, position, rotation, scale);
             corals.push_back(std::move(coral));
 
-            std::cout << "Created coral at position ("
-                << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+            if (logEach) {
+                std::cout << "Created coral at position ("
+                    << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+            }
         }
         else {
             std::cout << "Could not find valid position for coral after " << attempts << " attempts" << std::endl;
@@ -3,6 +3,7 @@
 
 #include "ModelLoader.h"
 #include "shaderprogram.h"
+#include "Transform.h"
 #include "Stone.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -11,7 +12,7 @@
 
 class Coral {
 private:
-    std::unique_ptr<ModelData> modelData;
+    std::shared_ptr<ModelData> modelData; // shared by all instances of the same model
     glm::vec3 position;
     glm::vec3 rotation;
     glm::vec3 scale;
@@ -30,9 +31,12 @@ public:
     float getSwaySpeed() const { return swaySpeed; }
     float getSwayAmplitude() const { return swayAmplitude; }
 
-    // Static method to create random corals avoiding stones
+    // Static method to create random corals avoiding stones (count < 0: 3-5 corals)
     static std::vector<std::unique_ptr<Coral>> createRandomCorals(
-        const std::vector<std::unique_ptr<Stone>>& existingStones);
+        const std::vector<std::unique_ptr<Stone>>& existingStones, int count = -1);
+
+    // Texture of the coral model (for preloading)
+    static std::vector<std::string> textureFiles();
 };
 
 #endif // CORAL_H
\ No newline at end of file
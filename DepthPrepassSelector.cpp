@@ -0,0 +1,108 @@
+#include "DepthPrepassSelector.h"
+#include <iostream>
+
+DepthPrepassSelector::DepthPrepassSelector(int sampleFrames, float reevaluateInterval)
+    : nextQuery(0), activeQuery(-1), mode(AUTO), prepass(false), chosenPrepass(false),
+    measuring(true), frameCounter(0), sampleFrames(sampleFrames),
+    reevaluateInterval(reevaluateInterval), decisionTime(0.0f) {
+
+    glGenQueries(QUERY_COUNT, queries);
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        queryPending[i] = false;
+        queryPrepass[i] = false;
+    }
+    startMeasuring();
+}
+
+DepthPrepassSelector::~DepthPrepassSelector() {
+    glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void DepthPrepassSelector::startMeasuring() {
+    measuring = true;
+    frameCounter = 0;
+    gpuTime[0] = gpuTime[1] = 0.0;
+    samples[0] = samples[1] = 0;
+}
+
+void DepthPrepassSelector::collectResults() {
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        if (!queryPending[i]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+        queryPending[i] = false;
+
+        if (measuring) {
+            int variant = queryPrepass[i] ? 1 : 0;
+            gpuTime[variant] += static_cast<double>(elapsed);
+            samples[variant]++;
+        }
+    }
+}
+
+void DepthPrepassSelector::beginOpaquePass(float time) {
+    collectResults();
+
+    if (mode == ALWAYS) {
+        prepass = true;
+    }
+    else if (mode == NEVER) {
+        prepass = false;
+    }
+    else if (measuring) {
+        if (samples[0] >= sampleFrames && samples[1] >= sampleFrames) {
+            double withoutPrepass = gpuTime[0] / samples[0];
+            double withPrepass = gpuTime[1] / samples[1];
+            chosenPrepass = withPrepass < withoutPrepass;
+            measuring = false;
+            decisionTime = time;
+
+            std::cout << "Opaque pass: " << withoutPrepass / 1.0e6 << " ms without depth pre-pass, "
+                << withPrepass / 1.0e6 << " ms with it -> "
+                << (chosenPrepass ? "using depth pre-pass" : "using front-to-back only") << std::endl;
+            prepass = chosenPrepass;
+        }
+        else {
+            // Alternate variants so both see the same view
+            prepass = (frameCounter++ & 1) != 0;
+        }
+    }
+    else {
+        prepass = chosenPrepass;
+        if (time - decisionTime > reevaluateInterval) {
+            startMeasuring();
+        }
+    }
+
+    // Only time frames whose result slot is free; never wait on the GPU
+    activeQuery = -1;
+    if (mode == AUTO && measuring && !queryPending[nextQuery]) {
+        activeQuery = nextQuery;
+        nextQuery = (nextQuery + 1) % QUERY_COUNT;
+        queryPrepass[activeQuery] = prepass;
+        glBeginQuery(GL_TIME_ELAPSED, queries[activeQuery]);
+    }
+}
+
+void DepthPrepassSelector::endOpaquePass() {
+    if (activeQuery < 0) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    queryPending[activeQuery] = true;
+    activeQuery = -1;
+}
+
+void DepthPrepassSelector::cycleMode() {
+    mode = mode == AUTO ? ALWAYS : (mode == ALWAYS ? NEVER : AUTO);
+    if (mode == AUTO) {
+        startMeasuring();
+    }
+
+    const char* names[] = { "auto (measured)", "always", "never" };
+    std::cout << "Depth pre-pass: " << names[mode] << std::endl;
+}
@@ -0,0 +1,59 @@
+#ifndef DEPTH_PREPASS_SELECTOR_H
+#define DEPTH_PREPASS_SELECTOR_H
+
+#include <GL/glew.h>
+
+// Decides whether the opaque pass uses a depth-only pre-pass (followed by a
+// GL_EQUAL color pass) or plain front-to-back drawing.
+// In AUTO mode both variants are timed on the GPU with GL_TIME_ELAPSED queries
+// (alternating frame by frame), the cheaper one is kept and the measurement is
+// repeated periodically since the cost depends on what the camera looks at.
+class DepthPrepassSelector {
+public:
+    enum Mode { AUTO, ALWAYS, NEVER };
+
+private:
+    static const int QUERY_COUNT = 4; // frames in flight before a result is read back
+
+    GLuint queries[QUERY_COUNT];
+    bool queryPending[QUERY_COUNT];
+    bool queryPrepass[QUERY_COUNT];   // which variant each query measured
+    int nextQuery;
+    int activeQuery;
+
+    Mode mode;
+    bool prepass;                     // variant used for the current frame
+    bool chosenPrepass;               // AUTO decision
+    bool measuring;
+    int frameCounter;
+    int sampleFrames;
+    float reevaluateInterval;
+    float decisionTime;
+
+    double gpuTime[2];                // accumulated ns, [0] = no pre-pass, [1] = pre-pass
+    int samples[2];
+
+    void collectResults();
+    void startMeasuring();
+
+public:
+    DepthPrepassSelector(int sampleFrames = 32, float reevaluateInterval = 10.0f);
+    ~DepthPrepassSelector();
+
+    DepthPrepassSelector(const DepthPrepassSelector&) = delete;
+    DepthPrepassSelector& operator=(const DepthPrepassSelector&) = delete;
+
+    // Pick the variant for this frame and start timing the opaque pass
+    void beginOpaquePass(float time);
+
+    // Stop timing the opaque pass
+    void endOpaquePass();
+
+    bool useDepthPrepass() const { return prepass; }
+
+    // AUTO -> ALWAYS -> NEVER
+    void cycleMode();
+    Mode getMode() const { return mode; }
+};
+
+#endif // DEPTH_PREPASS_SELECTOR_H
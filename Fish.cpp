@@ -1,4 +1,6 @@
 #include "Fish.h"
+#include "Random.h"
+#include "constants.h"
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 #include <algorithm>
@@ -7,20 +9,30 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// Fish types with specific corrections for problematic models
+struct FishConfig {
+    std::string name;
+    glm::vec3 rotationOffset;  // Additional rotation to fix orientation
+    glm::vec3 scaleMultiplier; // Scale adjustments if needed
+};
+
+static const std::vector<FishConfig> fishConfigs = {
+    {"TropicalFish01", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)},
+    {"TropicalFish02", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)},
+    {"TropicalFish03", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)},
+    {"TropicalFish12", glm::vec3(0.0f, 0.0f, 180.0f), glm::vec3(1.0f, 1.0f, 1.0f)}, // Flip upside down
+    {"TropicalFish15", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)}
+};
+
 Fish::Fish(const std::string& objPath, const std::string& texturePath,
     glm::vec3 pos, glm::vec3 rot, glm::vec3 scl)
     : position(pos), rotation(rot), scale(scl) {
 
-    ModelLoader loader;
-    modelData = loader.loadModel(objPath, texturePath);
-
-    if (!modelData) {
-        std::cerr << "Failed to load fish model: " << objPath << std::endl;
-    }
+    // Loaded once per model file; a failed load is reported once by the loader
+    modelData = ModelLoader::loadShared(objPath, texturePath);
 
     // Initialize movement properties
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = Random::engine();
     std::uniform_real_distribution<float> speedDist(0.8f, 1.5f);
     std::uniform_real_distribution<float> radiusDist(1.0f, 3.0f);
     std::uniform_real_distribution<float> timeDist(2.0f, 5.0f);
@@ -36,8 +48,7 @@ Fish::Fish(const std::string& objPath, const std::string& texturePath,
 }
 
 void Fish::generateNewTarget() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = Random::engine();
     std::uniform_real_distribution<float> xDist(AQUARIUM_MIN_X, AQUARIUM_MAX_X);
     std::uniform_real_distribution<float> yDist(AQUARIUM_MIN_Y, AQUARIUM_MAX_Y);
     std::uniform_real_distribution<float> zDist(AQUARIUM_MIN_Z, AQUARIUM_MAX_Z);
@@ -107,6 +118,8 @@ void Fish::updateMovement(float deltaTime) {
 }
 
 void Fish::update(float deltaTime) {
+    // Not profiled per fish: with large populations the events would flood the
+    // profiler ring buffer (the "Update fish" section in drawScene covers it)
     updateMovement(deltaTime);
 }
 
@@ -115,18 +128,16 @@ void Fish::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::m
 
     shader->use();
 
-    // Create model matrix
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, position);
-    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::scale(model, scale);
+    // Create model and normal matrices once per instance (not per vertex in the shader)
+    Transform transform = Transform::fromEulerDegrees(position, rotation, scale);
+    glm::mat4 model = transform.matrix();
+    glm::mat3 normalMatrix = transform.normalMatrix();
 
     // Send matrices to shader
     glUniformMatrix4fv(shader->u("P"), 1, false, glm::value_ptr(projection));
     glUniformMatrix4fv(shader->u("V"), 1, false, glm::value_ptr(view));
     glUniformMatrix4fv(shader->u("M"), 1, false, glm::value_ptr(model));
+    glUniformMatrix3fv(shader->u("N"), 1, false, glm::value_ptr(normalMatrix));
     glUniform1f(shader->u("time"), time);
     glUniform3fv(shader->u("cameraPos"), 1, glm::value_ptr(glm::vec3(0.0f))); // Will be set properly in main
 
@@ -134,7 +145,7 @@ void Fish::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::m
     if (modelData->texture != 0) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, modelData->texture);
-        glUniform1i(shader->u("fishTexture"), 0);
+        glUniform1i(shader->u("diffuseTexture"), 0);
     }
 
     // Draw the fish
@@ -143,38 +154,61 @@ void Fish::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::m
     glBindVertexArray(0);
 }
 
-std::vector<std::unique_ptr<Fish>> Fish::createRandomFish() {
+void Fish::drawDepth(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view) {
+    if (!modelData || !shader) return;
+
+    shader->use();
+
+    glm::mat4 model = Transform::fromEulerDegrees(position, rotation, scale).matrix();
+
+    glUniformMatrix4fv(shader->u("P"), 1, false, glm::value_ptr(projection));
+    glUniformMatrix4fv(shader->u("V"), 1, false, glm::value_ptr(view));
+    glUniformMatrix4fv(shader->u("M"), 1, false, glm::value_ptr(model));
+
+    // Alpha tested like the color pass
+    if (modelData->texture != 0) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, modelData->texture);
+        glUniform1i(shader->u("alphaTexture"), 0);
+    }
+
+    glBindVertexArray(modelData->VAO);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(modelData->vertexCount));
+    glBindVertexArray(0);
+}
+
+std::vector<std::string> Fish::textureFiles() {
+    std::vector<std::string> files;
+    for (const FishConfig& config : fishConfigs) {
+        files.push_back(config.name + ".png");
+    }
+    return files;
+}
+
+std::vector<std::unique_ptr<Fish>> Fish::createRandomFish(int count) {
     std::vector<std::unique_ptr<Fish>> fish;
 
     // Random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = Random::engine();
     std::uniform_real_distribution<float> xDist(AQUARIUM_MIN_X, AQUARIUM_MAX_X);
     std::uniform_real_distribution<float> yDist(AQUARIUM_MIN_Y, AQUARIUM_MAX_Y);
     std::uniform_real_distribution<float> zDist(AQUARIUM_MIN_Z, AQUARIUM_MAX_Z);
     std::uniform_real_distribution<float> rotDist(0.0f, 360.0f);
     std::uniform_real_distribution<float> scaleDist(0.15f, 0.25f);
 
-    // Fish types with specific corrections for problematic models
-    struct FishConfig {
-        std::string name;
-        glm::vec3 rotationOffset;  // Additional rotation to fix orientation
-        glm::vec3 scaleMultiplier; // Scale adjustments if needed
-    };
-
-    std::vector<FishConfig> fishConfigs = {
-        {"TropicalFish01", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)},
-        {"TropicalFish02", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)},
-        {"TropicalFish03", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)},
-        {"TropicalFish12", glm::vec3(0.0f, 0.0f, 180.0f), glm::vec3(1.0f, 1.0f, 1.0f)}, // Flip upside down
-        {"TropicalFish15", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f)}
-    };
-
-    // Create 8-12 fish (1-3 of each type)
+    // Create 5-15 fish (1-3 of each type) unless a count is given
     std::uniform_int_distribution<int> fishPerTypeDist(1, 3);
+    const int typeCount = (int)fishConfigs.size();
+
+    // Large populations can't keep 1.5 units apart in the tank anyway, and the
+    // pairwise check would be quadratic
+    const bool spaced = count <= MAX_SPACED_OBJECTS;
+    const bool logEach = count <= MAX_LOGGED_OBJECTS;
+    if (count > 0) fish.reserve(count);
 
-    for (const auto& fishConfig : fishConfigs) {
-        int fishCount = fishPerTypeDist(gen);
+    for (int type = 0; type < typeCount; ++type) {
+        const FishConfig& fishConfig = fishConfigs[type];
+        int fishCount = count < 0 ? fishPerTypeDist(gen) : count / typeCount + (type < count % typeCount ? 1 : 0);
 
         for (int i = 0; i < fishCount; ++i) {
             // Generate random position in aquarium
@@ -192,6 +226,7 @@ std::vector<std::unique_ptr<Fish>> Fish::createRandomFish() {
 
                 // Check distance from existing fish
                 validPosition = true;
+                if (!spaced) break;
                 for (const auto& existingFish : fish) {
                     float distance = glm::length(position - existingFish->getPosition());
                     if (distance < 1.5f) { // Minimum 1.5 units apart
@@ -220,8 +255,10 @@ std::vector<std::unique_ptr<Fish>> Fish::createRandomFish() {
             auto newFish = std::make_unique<Fish>(objPath, texPath, position, rotation, scale);
             fish.push_back(std::move(newFish));
 
-            std::cout << "Created " << fishConfig.name << " at position ("
-                << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+            if (logEach) {
+                std::cout << "Created " << fishConfig.name << " at position ("
+                    << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+            }
         }
     }
 
@@ -3,6 +3,7 @@
 
 #include "ModelLoader.h"
 #include "shaderprogram.h"
+#include "Transform.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -11,7 +12,7 @@
 
 class Fish {
 private:
-    std::unique_ptr<ModelData> modelData;
+    std::shared_ptr<ModelData> modelData; // shared by all instances of the same model
     glm::vec3 position;
     glm::vec3 rotation;
     glm::vec3 scale;
@@ -44,13 +45,18 @@ public:
 
     void update(float deltaTime);
     void draw(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view, float time);
+    void drawDepth(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view); // Depth pre-pass
 
     // Getters
     glm::vec3 getPosition() const { return position; }
     glm::vec3 getScale() const { return scale; }
 
     // Static method to create random fish in aquarium
-    static std::vector<std::unique_ptr<Fish>> createRandomFish();
+    // (count < 0: 1-3 of each species, otherwise count fish spread evenly over the species)
+    static std::vector<std::unique_ptr<Fish>> createRandomFish(int count = -1);
+
+    // Texture of every species (for preloading)
+    static std::vector<std::string> textureFiles();
 };
 
 #endif // FISH_H
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "FogPass.h"
+#include <algorithm>
+#include <iostream>
+
+FogPass::FogPass(ShaderLibrary* shaders, int width, int height, int downscale)
+    : width(width), height(height), downscale(downscale),
+    sceneFBO(0), sceneColor(0), sceneDepth(0),
+    fogFBO(0), fogColor(0), fogDepth(0), outputFBO(0), quadVAO(0) {
+
+    downsampleShader = shaders->get("v_fullscreen.glsl", NULL, "f_fog_depth_downsample.glsl");
+    upsampleShader = shaders->get("v_fullscreen.glsl", NULL, "f_fog_upsample.glsl");
+
+    // Core profile needs a bound VAO even though the triangle has no attributes
+    glGenVertexArrays(1, &quadVAO);
+
+    createTargets();
+}
+
+FogPass::~FogPass() {
+    deleteTargets();
+    glDeleteVertexArrays(1, &quadVAO);
+}
+
+void FogPass::createTargets() {
+    int fogWidth = std::max(1, width / downscale);
+    int fogHeight = std::max(1, height / downscale);
+
+    // Resize and setDownscale may run between passes, so leave the caller's framebuffer bound
+    GLint previousFBO = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+
+    // Scene color + depth, both sampled later
+    glGenTextures(1, &sceneColor);
+    glBindTexture(GL_TEXTURE_2D, sceneColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &sceneDepth);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &sceneFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColor, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, sceneDepth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Fog pass scene framebuffer is incomplete" << std::endl;
+    }
+
+    // Low resolution fog color (premultiplied) + depth
+    glGenTextures(1, &fogColor);
+    glBindTexture(GL_TEXTURE_2D, fogColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, fogWidth, fogHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &fogDepth);
+    glBindTexture(GL_TEXTURE_2D, fogDepth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, fogWidth, fogHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &fogFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, fogFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fogColor, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, fogDepth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Fog pass low resolution framebuffer is incomplete" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void FogPass::deleteTargets() {
+    glDeleteFramebuffers(1, &sceneFBO);
+    glDeleteFramebuffers(1, &fogFBO);
+    glDeleteTextures(1, &sceneColor);
+    glDeleteTextures(1, &sceneDepth);
+    glDeleteTextures(1, &fogColor);
+    glDeleteTextures(1, &fogDepth);
+    sceneFBO = sceneColor = sceneDepth = 0;
+    fogFBO = fogColor = fogDepth = 0;
+}
+
+void FogPass::resize(int newWidth, int newHeight) {
+    if (newWidth <= 0 || newHeight <= 0) return;
+    if (newWidth == width && newHeight == height) return;
+    width = newWidth;
+    height = newHeight;
+    deleteTargets();
+    createTargets();
+}
+
+void FogPass::setDownscale(int newDownscale) {
+    if (newDownscale < 1 || newDownscale == downscale) return;
+    downscale = newDownscale;
+    deleteTargets();
+    createTargets();
+}
+
+void FogPass::beginOutput() {
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+    glViewport(0, 0, width, height);
+}
+
+void FogPass::beginScene() {
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void FogPass::beginFog() {
+    int fogWidth = std::max(1, width / downscale);
+    int fogHeight = std::max(1, height / downscale);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fogFBO);
+    glViewport(0, 0, fogWidth, fogHeight);
+    const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, transparent); // leaves the scene clear color untouched
+
+    // Downsample scene depth: depth only, always written
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_ALWAYS);
+
+    downsampleShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glUniform1i(downsampleShader->u("sceneDepth"), 0);
+    glUniform1i(downsampleShader->u("downscale"), downscale);
+
+    glBindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    // Fog is accumulated premultiplied so it can be filtered and composited with (ONE, ONE_MINUS_SRC_ALPHA)
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void FogPass::composite(float nearPlane, float farPlane) {
+    // Present the scene
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+    glViewport(0, 0, width, height);
+
+    // Bilateral upsample of the fog on top of it
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    upsampleShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fogColor);
+    glUniform1i(upsampleShader->u("fogColor"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, fogDepth);
+    glUniform1i(upsampleShader->u("fogDepth"), 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glUniform1i(upsampleShader->u("sceneDepth"), 2);
+    glUniform1i(upsampleShader->u("downscale"), downscale);
+    glUniform1f(upsampleShader->u("nearPlane"), nearPlane);
+    glUniform1f(upsampleShader->u("farPlane"), farPlane);
+
+    glBindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
@@ -0,0 +1,65 @@
+#ifndef FOG_PASS_H
+#define FOG_PASS_H
+
+#include <GL/glew.h>
+#include "shaderprogram.h"
+#include "ShaderLibrary.h"
+
+// Low-resolution water fog pass.
+// The scene is rendered into an offscreen target, its depth is downsampled to
+// 1/downscale resolution, the fog volume is drawn there (premultiplied alpha) and
+// finally upsampled with a depth-aware bilateral filter and composited on top of
+// the scene in the output framebuffer (the default one unless rendering
+// headless). Fog fill cost drops by downscale^2.
+class FogPass {
+private:
+    int width, height;
+    int downscale;
+
+    // Full resolution scene capture
+    GLuint sceneFBO, sceneColor, sceneDepth;
+
+    // Low resolution fog target
+    GLuint fogFBO, fogColor, fogDepth;
+
+    // Where the composited frame goes (0 = default framebuffer)
+    GLuint outputFBO;
+
+    // Full-screen triangle (generated from gl_VertexID)
+    GLuint quadVAO;
+
+    ShaderProgram* downsampleShader; // owned by the ShaderLibrary
+    ShaderProgram* upsampleShader;
+
+    void createTargets();
+    void deleteTargets();
+
+public:
+    FogPass(ShaderLibrary* shaders, int width, int height, int downscale = 2);
+    ~FogPass();
+
+    FogPass(const FogPass&) = delete;
+    FogPass& operator=(const FogPass&) = delete;
+
+    // Framebuffer size in pixels (glfwGetFramebufferSize, not the window size)
+    void resize(int newWidth, int newHeight);
+    void setDownscale(int newDownscale);
+    int getDownscale() const { return downscale; }
+
+    // Framebuffer that receives the composited frame (offscreen target in headless mode)
+    void setOutputFramebuffer(GLuint fbo) { outputFBO = fbo; }
+
+    // Bind the output framebuffer at full size; the scene goes here directly when the fog is not low resolution
+    void beginOutput();
+
+    // Redirect scene rendering into the offscreen target
+    void beginScene();
+
+    // Downsample scene depth and bind the low resolution fog target; draw the fog volume after this
+    void beginFog();
+
+    // Upsample the fog, composite it over the scene and present into the output framebuffer
+    void composite(float nearPlane, float farPlane);
+};
+
+#endif // FOG_PASS_H
@@ -0,0 +1,109 @@
+#include "GoldenImages.h"
+#include "lodepng.h"
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+const char* GoldenImages::diffDirectory = "golden_diff";
+
+static void makeDirectory(const std::string& directory) {
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+GoldenImages::GoldenImages(Mode mode, const std::string& directory, const Thresholds& thresholds)
+    : mode(mode), directory(directory), thresholds(thresholds), frames(0), failures(0), compareMilliseconds(0.0) {
+    if (mode == RECORD) {
+        makeDirectory(directory);
+    }
+}
+
+std::string GoldenImages::framePath(const std::string& dir, int frame) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%05d.png", frame);
+    return dir + name;
+}
+
+// Frames are written while rendering, so with the fastest compression level on all cores
+static unsigned encodeFrame(const std::string& path, const std::vector<unsigned char>& rgba, int width, int height) {
+    lodepng::State state;
+    state.encoder.zlibsettings.level = 1;
+    std::vector<unsigned char> png;
+    unsigned error = lodepng::encodeParallel(png, rgba, width, height, state);
+    if (!error) error = lodepng::save_file(png, path);
+    return error;
+}
+
+bool GoldenImages::processFrame(int frame, const std::vector<unsigned char>& rgba, int width, int height) {
+    frames++;
+    std::string referencePath = framePath(directory, frame);
+
+    if (mode == RECORD) {
+        unsigned error = encodeFrame(referencePath, rgba, width, height);
+        if (error) {
+            std::cout << "Cannot write " << referencePath << ": " << lodepng_error_text(error) << std::endl;
+            failures++;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<unsigned char> reference;
+    unsigned referenceWidth, referenceHeight;
+    unsigned error = lodepng::decode(reference, referenceWidth, referenceHeight, referencePath);
+    if (error) {
+        std::cout << "Golden frame " << frame << ": cannot load " << referencePath << ": " << lodepng_error_text(error) << std::endl;
+        failures++;
+        return false;
+    }
+    if ((int)referenceWidth != width || (int)referenceHeight != height) {
+        std::cout << "Golden frame " << frame << ": reference is " << referenceWidth << "x" << referenceHeight
+            << ", rendered " << width << "x" << height << std::endl;
+        failures++;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ImageDiff diff = ImageCompare::compare(reference.data(), rgba.data(), width, height, thresholds.tolerance);
+    compareMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double overFraction = (double)diff.pixelsOver / ((double)width * height);
+    bool passed = overFraction <= thresholds.maxPixelsOverFraction && diff.ssim >= thresholds.minSsim;
+    if (passed) return true;
+
+    failures++;
+    std::cout << "Golden frame " << frame << " differs: " << diff.pixelsOver << " pixels over tolerance ("
+        << overFraction * 100.0 << "%), max error " << diff.maxError << ", mean error " << diff.meanError
+        << ", SSIM " << diff.ssim << std::endl;
+
+    // Heatmap for the CI artifacts (computed again, only for failing frames)
+    std::vector<unsigned char> heatmap;
+    ImageCompare::compare(reference.data(), rgba.data(), width, height, thresholds.tolerance, &heatmap);
+    makeDirectory(diffDirectory);
+    std::string heatmapPath = framePath(diffDirectory, frame);
+    error = encodeFrame(heatmapPath, heatmap, width, height);
+    if (error) {
+        std::cout << "Cannot write " << heatmapPath << ": " << lodepng_error_text(error) << std::endl;
+    }
+    return false;
+}
+
+void GoldenImages::report() const {
+    if (mode == RECORD) {
+        std::cout << "Golden images: recorded " << frames - failures << " frames in " << directory << std::endl;
+        return;
+    }
+    std::cout << "Golden images: " << frames - failures << "/" << frames << " frames match " << directory
+        << " (compare " << (frames > 0 ? compareMilliseconds / frames : 0.0) << " ms/frame)";
+    if (failures > 0) {
+        std::cout << ", heatmaps in " << diffDirectory << "/";
+    }
+    std::cout << std::endl;
+}
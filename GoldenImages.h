@@ -0,0 +1,48 @@
+#ifndef GOLDEN_IMAGES_H
+#define GOLDEN_IMAGES_H
+
+#include "ImageCompare.h"
+#include <string>
+#include <vector>
+
+// Golden-image regression check for headless runs.
+// RECORD stores selected frames as <directory>/frame_NNNNN.png; CHECK compares
+// the same frames against them (ImageCompare) and writes a heatmap of every
+// failing frame to golden_diff/frame_NNNNN.png. Record the references with the
+// same renderer as the checks (llvmpipe and GPU drivers rasterize differently).
+class GoldenImages {
+public:
+    enum Mode { RECORD, CHECK };
+
+    struct Thresholds {
+        int tolerance = 8;                    // per channel difference ignored (0-255)
+        double maxPixelsOverFraction = 0.001; // share of pixels allowed over the tolerance
+        double minSsim = 0.99;
+    };
+
+    static const char* diffDirectory;
+
+private:
+    Mode mode;
+    std::string directory;
+    Thresholds thresholds;
+
+    int frames;
+    int failures;
+    double compareMilliseconds;
+
+    std::string framePath(const std::string& dir, int frame) const;
+
+public:
+    GoldenImages(Mode mode, const std::string& directory, const Thresholds& thresholds);
+
+    // Record or check one frame (RGBA8, top row first); false on a mismatch or I/O error
+    bool processFrame(int frame, const std::vector<unsigned char>& rgba, int width, int height);
+
+    int getFailures() const { return failures; }
+
+    // Print the number of frames recorded or checked and the failures
+    void report() const;
+};
+
+#endif // GOLDEN_IMAGES_H
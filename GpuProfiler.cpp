@@ -0,0 +1,131 @@
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include <iostream>
+#include <string.h>
+
+GpuProfiler::GpuProfiler() : currentFrame(0), recording(false) {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        glGenQueries(MAX_SECTIONS + 1, frames[i].queries);
+        frames[i].sectionCount = 0;
+        frames[i].pending = false;
+        frames[i].cpuOffsetNs = 0.0;
+    }
+    track = Profiler::createTrack("GPU");
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        glDeleteQueries(MAX_SECTIONS + 1, frames[i].queries);
+    }
+}
+
+void GpuProfiler::addSample(const char* name, double milliseconds) {
+    PassStats* stats = NULL;
+    for (PassStats& pass : passes) {
+        if (pass.name == name || strcmp(pass.name, name) == 0) {
+            stats = &pass;
+            break;
+        }
+    }
+    if (stats == NULL) {
+        passes.push_back(PassStats());
+        stats = &passes.back();
+        stats->name = name;
+        stats->sampleCount = 0;
+        stats->nextSample = 0;
+        stats->sum = 0.0;
+    }
+
+    if (stats->sampleCount == AVERAGE_WINDOW) {
+        stats->sum -= stats->samples[stats->nextSample];
+    } else {
+        stats->sampleCount++;
+    }
+    stats->samples[stats->nextSample] = milliseconds;
+    stats->sum += milliseconds;
+    stats->nextSample = (stats->nextSample + 1) % AVERAGE_WINDOW;
+}
+
+void GpuProfiler::collectResults() {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        Frame& frame = frames[i];
+        if (!frame.pending) continue;
+
+        // The last timestamp finishes last, so it tells whether the whole frame is ready
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.sectionCount], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 timestamps[MAX_SECTIONS + 1];
+        for (int q = 0; q <= frame.sectionCount; ++q) {
+            glGetQueryObjectui64v(frame.queries[q], GL_QUERY_RESULT, &timestamps[q]);
+        }
+        frame.pending = false;
+
+        for (int s = 0; s < frame.sectionCount; ++s) {
+            double startNs = (double)timestamps[s] + frame.cpuOffsetNs;
+            double endNs = (double)timestamps[s + 1] + frame.cpuOffsetNs;
+            addSample(frame.names[s], (endNs - startNs) / 1.0e6);
+            Profiler::recordOnTrack(track, frame.names[s],
+                Profiler::nanosecondsToTicks(startNs), Profiler::nanosecondsToTicks(endNs));
+        }
+    }
+}
+
+void GpuProfiler::beginFrame(const char* firstSection) {
+    collectResults();
+
+    currentFrame = (currentFrame + 1) % FRAMES_IN_FLIGHT;
+    Frame& frame = frames[currentFrame];
+    recording = !frame.pending;
+    if (!recording) return;
+
+    // GPU clock -> Profiler clock. glGet(GL_TIMESTAMP) returns the GPU time without waiting
+    // for queued work; re-measured every frame so drift between the clocks doesn't build up.
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    frame.cpuOffsetNs = Profiler::ticksToNanoseconds(Profiler::now()) - (double)gpuNow;
+
+    frame.sectionCount = 0;
+    mark(firstSection);
+}
+
+void GpuProfiler::mark(const char* section) {
+    if (!recording) return;
+
+    Frame& frame = frames[currentFrame];
+    if (frame.sectionCount == MAX_SECTIONS) return;
+
+    glQueryCounter(frame.queries[frame.sectionCount], GL_TIMESTAMP);
+    frame.names[frame.sectionCount] = section;
+    frame.sectionCount++;
+}
+
+void GpuProfiler::endFrame() {
+    if (!recording) return;
+
+    Frame& frame = frames[currentFrame];
+    glQueryCounter(frame.queries[frame.sectionCount], GL_TIMESTAMP);
+    frame.pending = frame.sectionCount > 0;
+    recording = false;
+}
+
+double GpuProfiler::getAverage(const char* section) const {
+    for (const PassStats& pass : passes) {
+        if (strcmp(pass.name, section) == 0) {
+            return pass.sampleCount > 0 ? pass.sum / pass.sampleCount : 0.0;
+        }
+    }
+    return 0.0;
+}
+
+void GpuProfiler::report() const {
+    double total = 0.0;
+    std::cout << "GPU time per pass (average of last " << AVERAGE_WINDOW << " frames):" << std::endl;
+    for (const PassStats& pass : passes) {
+        double average = pass.sampleCount > 0 ? pass.sum / pass.sampleCount : 0.0;
+        total += average;
+        std::cout << "  " << pass.name << ": " << average << " ms" << std::endl;
+    }
+    std::cout << "  total: " << total << " ms" << std::endl;
+}
@@ -0,0 +1,71 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <GL/glew.h>
+#include <vector>
+
+// GPU time per render pass from GL_TIMESTAMP queries (glQueryCounter).
+// A timestamp is written at every section boundary, so sections need no
+// begin/end pairs and can sit inside the GL_TIME_ELAPSED query used by
+// DepthPrepassSelector. Queries live in a ring of FRAMES_IN_FLIGHT frames and
+// results are read only once available, so the CPU never waits on the GPU;
+// if the GPU falls that far behind, the frame is simply not measured.
+// Finished passes feed per-pass rolling averages and the "GPU" track of the
+// CPU Profiler trace (GPU time is mapped to CPU time with GL_TIMESTAMP).
+class GpuProfiler {
+public:
+    static const int FRAMES_IN_FLIGHT = 4;
+    static const int MAX_SECTIONS = 24;
+    static const int AVERAGE_WINDOW = 64; // frames in the rolling average
+
+private:
+    struct Frame {
+        GLuint queries[MAX_SECTIONS + 1];
+        const char* names[MAX_SECTIONS];
+        int sectionCount;
+        bool pending;
+        double cpuOffsetNs; // add to GPU ns to get Profiler ns
+    };
+
+    struct PassStats {
+        const char* name;
+        double samples[AVERAGE_WINDOW];
+        int sampleCount;
+        int nextSample;
+        double sum;
+    };
+
+    Frame frames[FRAMES_IN_FLIGHT];
+    int currentFrame;
+    bool recording;   // false when this frame's slot was still in flight
+    int track;        // Profiler track id
+
+    std::vector<PassStats> passes;
+
+    void collectResults();
+    void addSample(const char* name, double milliseconds);
+
+public:
+    GpuProfiler();
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Read finished frames and start timing a new one with its first section
+    void beginFrame(const char* firstSection);
+
+    // End the current section and start the next (name must be a string literal)
+    void mark(const char* section);
+
+    // End the last section; call before swapping buffers
+    void endFrame();
+
+    // Rolling average GPU time of a pass in ms (0 if never measured)
+    double getAverage(const char* section) const;
+
+    // Print all rolling averages to stdout
+    void report() const;
+};
+
+#endif // GPU_PROFILER_H
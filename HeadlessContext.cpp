@@ -0,0 +1,164 @@
+#include "HeadlessContext.h"
+#include <iostream>
+#include <string.h>
+#ifdef AQUARIUM_EGL
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext(int width, int height)
+    : width(width), height(height), window(NULL), eglDisplay(NULL), eglContext(NULL),
+    framebuffer(0), colorBuffer(0), depthBuffer(0) {
+}
+
+HeadlessContext::~HeadlessContext() {
+    if (framebuffer != 0) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+#ifdef AQUARIUM_EGL
+    if (eglContext != NULL) {
+        eglMakeCurrent((EGLDisplay)eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)eglDisplay, (EGLContext)eglContext);
+    }
+    if (eglDisplay != NULL) {
+        eglTerminate((EGLDisplay)eglDisplay);
+    }
+#endif
+    if (window != NULL) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+bool HeadlessContext::createEglContext() {
+#ifdef AQUARIUM_EGL
+    // Surfaceless platform first (no window system at all), then whatever the default display is
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExtensions != NULL && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != NULL) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "EGL: cannot initialize display" << std::endl;
+        return false;
+    }
+    eglDisplay = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL: desktop OpenGL is not supported" << std::endl;
+        return false;
+    }
+
+    // Nothing is drawn to an EGL surface; the config only has to support desktop GL
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "EGL: no OpenGL config" << std::endl;
+        return false;
+    }
+
+    // Default attributes, like glfwCreateWindow: newest compatibility profile the driver has
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "EGL: cannot create context" << std::endl;
+        return false;
+    }
+    eglContext = context;
+
+    // EGL_KHR_surfaceless_context: current without any draw or read surface
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "EGL: cannot make the context current without a surface" << std::endl;
+        eglDestroyContext(display, context);
+        eglContext = NULL;
+        return false;
+    }
+
+    std::cout << "EGL " << major << "." << minor << " (" << eglQueryString(display, EGL_VENDOR) << ")" << std::endl;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HeadlessContext::createGlfwContext() {
+    if (!glfwInit()) {
+        std::cerr << "Cannot initialize GLFW (headless GLFW mode still needs a display, e.g. Xvfb)" << std::endl;
+        return false;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(width, height, "Aquarium (headless)", NULL, NULL);
+    if (window == NULL) {
+        std::cerr << "Cannot create hidden window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    return true;
+}
+
+bool HeadlessContext::createContext() {
+    if (createEglContext()) return true;
+#ifdef AQUARIUM_EGL
+    std::cerr << "EGL context unavailable, falling back to a hidden GLFW window" << std::endl;
+#endif
+    return createGlfwContext();
+}
+
+bool HeadlessContext::createFramebuffer() {
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Headless framebuffer is incomplete" << std::endl;
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void HeadlessContext::readPixels(std::vector<unsigned char>& rgba) const {
+    const size_t rowSize = (size_t)width * 4;
+    std::vector<unsigned char> bottomUp(rowSize * height);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, bottomUp.data());
+
+    // OpenGL rows start at the bottom, PNG rows at the top
+    rgba.resize(bottomUp.size());
+    for (int y = 0; y < height; ++y) {
+        memcpy(&rgba[(size_t)y * rowSize], &bottomUp[(size_t)(height - 1 - y) * rowSize], rowSize);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+
+// OpenGL context without a visible window, for benchmarks and CI.
+// Built with AQUARIUM_EGL the context comes from EGL on Mesa's surfaceless
+// platform: no X server or GPU needed (llvmpipe with LIBGL_ALWAYS_SOFTWARE=1).
+// Otherwise, or if EGL fails, GLFW creates a hidden window (needs a display,
+// e.g. Xvfb). Either way frames go to an offscreen framebuffer of the requested
+// size, so the resolution doesn't depend on a window and nothing waits for vsync.
+class HeadlessContext {
+private:
+    int width, height;
+
+    GLFWwindow* window; // hidden window (GLFW path)
+    void* eglDisplay;   // EGLDisplay / EGLContext (EGL path), kept opaque so
+    void* eglContext;   // this header doesn't pull in EGL and X11 headers
+
+    // Offscreen render target
+    GLuint framebuffer, colorBuffer, depthBuffer;
+
+    bool createEglContext();
+    bool createGlfwContext();
+
+public:
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Create a context and make it current; false if neither backend works
+    bool createContext();
+
+    // Create the offscreen framebuffer (after glewInit) and bind it
+    bool createFramebuffer();
+
+    bool usesEgl() const { return eglContext != NULL; }
+    const char* getBackend() const { return usesEgl() ? "EGL surfaceless" : "hidden GLFW window"; }
+
+    // NULL on the EGL path
+    GLFWwindow* getWindow() const { return window; }
+
+    GLuint getFramebuffer() const { return framebuffer; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Read the offscreen color buffer as RGBA8, top row first (ready for lodepng::encode)
+    void readPixels(std::vector<unsigned char>& rgba) const;
+};
+
+#endif // HEADLESS_CONTEXT_H
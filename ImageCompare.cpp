@@ -0,0 +1,215 @@
+#include "ImageCompare.h"
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGE_COMPARE_SSE2 1
+#endif
+
+static const int SSIM_BLOCK = 8;
+
+// Luma weights (sum 256, so 8-bit in, 8-bit out)
+static const int LUMA_R = 77, LUMA_G = 150, LUMA_B = 29;
+
+namespace {
+
+struct RowStats {
+    uint64_t errorSum;
+    int maxError;
+    size_t pixelsOver;
+};
+
+inline uint8_t lumaOf(const uint8_t* pixel) {
+    return (uint8_t)((pixel[0] * LUMA_R + pixel[1] * LUMA_G + pixel[2] * LUMA_B) >> 8);
+}
+
+void diffPixelsScalar(const uint8_t* a, const uint8_t* b, int begin, int end, int tolerance,
+    uint8_t* pixelDiff, uint8_t* lumaA, uint8_t* lumaB, RowStats& stats) {
+    for (int x = begin; x < end; ++x) {
+        int largest = 0;
+        for (int c = 0; c < 4; ++c) {
+            int d = std::abs((int)a[x * 4 + c] - (int)b[x * 4 + c]);
+            stats.errorSum += d;
+            largest = std::max(largest, d);
+        }
+        pixelDiff[x] = (uint8_t)largest;
+        stats.maxError = std::max(stats.maxError, largest);
+        if (largest > tolerance) stats.pixelsOver++;
+        lumaA[x] = lumaOf(a + x * 4);
+        lumaB[x] = lumaOf(b + x * 4);
+    }
+}
+
+#ifdef IMAGE_COMPARE_SSE2
+// Luma of 4 RGBA pixels as 4 int32 lanes
+inline __m128i luma4(__m128i pixels) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(LUMA_R, LUMA_G, LUMA_B, 0, LUMA_R, LUMA_G, LUMA_B, 0);
+    __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);  // p0 rg, p0 b, p1 rg, p1 b
+    __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights); // p2 rg, p2 b, p3 rg, p3 b
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_srli_epi32(_mm_add_epi32(even, odd), 8);
+}
+
+// 4 int32 lanes (0-255) -> 4 bytes
+inline void store4(uint8_t* out, __m128i lanes) {
+    lanes = _mm_packs_epi32(lanes, lanes);
+    lanes = _mm_packus_epi16(lanes, lanes);
+    int32_t packed = _mm_cvtsi128_si32(lanes);
+    memcpy(out, &packed, 4);
+}
+
+// 4 pixels per iteration: |a - b| per channel with saturating subtracts, sums with SAD
+int diffPixelsSse2(const uint8_t* a, const uint8_t* b, int width, int tolerance,
+    uint8_t* pixelDiff, uint8_t* lumaA, uint8_t* lumaB, RowStats& stats) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi32(0xFF);
+    const __m128i limit = _mm_set1_epi32(tolerance);
+    __m128i sum = _mm_setzero_si128();
+    __m128i largest = _mm_setzero_si128();
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pa = _mm_loadu_si128((const __m128i*)(a + x * 4));
+        __m128i pb = _mm_loadu_si128((const __m128i*)(b + x * 4));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(d, zero));
+        largest = _mm_max_epu8(largest, d);
+
+        // Largest channel of each pixel in the low byte of its 32-bit lane
+        __m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+        m = _mm_and_si128(_mm_max_epu8(m, _mm_srli_epi32(m, 16)), lowByte);
+        int over = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(m, limit)));
+        stats.pixelsOver += (over & 1) + ((over >> 1) & 1) + ((over >> 2) & 1) + ((over >> 3) & 1);
+
+        store4(pixelDiff + x, m);
+        store4(lumaA + x, luma4(pa));
+        store4(lumaB + x, luma4(pb));
+    }
+
+    uint64_t sums[2];
+    _mm_storeu_si128((__m128i*)sums, sum);
+    stats.errorSum += sums[0] + sums[1];
+
+    uint8_t bytes[16];
+    _mm_storeu_si128((__m128i*)bytes, largest);
+    for (int i = 0; i < 16; ++i) {
+        stats.maxError = std::max(stats.maxError, (int)bytes[i]);
+    }
+    return x;
+}
+#endif
+
+struct BlockSums {
+    int32_t a, b, aa, bb, ab;
+};
+
+// Sums over one 8x8 luma block
+BlockSums blockSums(const uint8_t* lumaA, const uint8_t* lumaB, int stride) {
+    BlockSums sums = { 0, 0, 0, 0, 0 };
+#ifdef IMAGE_COMPARE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sumA = zero, sumB = zero, sumAA = zero, sumBB = zero, sumAB = zero;
+    for (int y = 0; y < SSIM_BLOCK; ++y) {
+        __m128i rowA = _mm_loadl_epi64((const __m128i*)(lumaA + y * stride));
+        __m128i rowB = _mm_loadl_epi64((const __m128i*)(lumaB + y * stride));
+        sumA = _mm_add_epi32(sumA, _mm_sad_epu8(rowA, zero));
+        sumB = _mm_add_epi32(sumB, _mm_sad_epu8(rowB, zero));
+        __m128i wideA = _mm_unpacklo_epi8(rowA, zero);
+        __m128i wideB = _mm_unpacklo_epi8(rowB, zero);
+        sumAA = _mm_add_epi32(sumAA, _mm_madd_epi16(wideA, wideA));
+        sumBB = _mm_add_epi32(sumBB, _mm_madd_epi16(wideB, wideB));
+        sumAB = _mm_add_epi32(sumAB, _mm_madd_epi16(wideA, wideB));
+    }
+    int32_t lanes[4];
+    sums.a = _mm_cvtsi128_si32(sumA);
+    sums.b = _mm_cvtsi128_si32(sumB);
+    _mm_storeu_si128((__m128i*)lanes, sumAA);
+    sums.aa = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_si128((__m128i*)lanes, sumBB);
+    sums.bb = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_si128((__m128i*)lanes, sumAB);
+    sums.ab = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+    for (int y = 0; y < SSIM_BLOCK; ++y) {
+        for (int x = 0; x < SSIM_BLOCK; ++x) {
+            int32_t va = lumaA[y * stride + x];
+            int32_t vb = lumaB[y * stride + x];
+            sums.a += va;
+            sums.b += vb;
+            sums.aa += va * va;
+            sums.bb += vb * vb;
+            sums.ab += va * vb;
+        }
+    }
+#endif
+    return sums;
+}
+
+double blockSsim(const BlockSums& s) {
+    const double n = SSIM_BLOCK * SSIM_BLOCK;
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    double meanA = s.a / n;
+    double meanB = s.b / n;
+    double varianceA = s.aa / n - meanA * meanA;
+    double varianceB = s.bb / n - meanB * meanB;
+    double covariance = s.ab / n - meanA * meanB;
+    return ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) /
+        ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+}
+
+} // namespace
+
+ImageDiff ImageCompare::compare(const unsigned char* reference, const unsigned char* image,
+    int width, int height, int tolerance, std::vector<unsigned char>* heatmap) {
+    const size_t pixelCount = (size_t)width * height;
+    std::vector<uint8_t> pixelDiff(pixelCount), lumaA(pixelCount), lumaB(pixelCount);
+
+    RowStats stats = { 0, 0, 0 };
+    for (int y = 0; y < height; ++y) {
+        const size_t row = (size_t)y * width;
+        const uint8_t* a = reference + row * 4;
+        const uint8_t* b = image + row * 4;
+        int x = 0;
+#ifdef IMAGE_COMPARE_SSE2
+        x = diffPixelsSse2(a, b, width, tolerance, &pixelDiff[row], &lumaA[row], &lumaB[row], stats);
+#endif
+        diffPixelsScalar(a, b, x, width, tolerance, &pixelDiff[row], &lumaA[row], &lumaB[row], stats);
+    }
+
+    ImageDiff diff;
+    diff.meanError = pixelCount > 0 ? (double)stats.errorSum / (pixelCount * 4) : 0.0;
+    diff.maxError = stats.maxError;
+    diff.pixelsOver = stats.pixelsOver;
+
+    // Partial blocks at the right and bottom edges are left to the per-pixel metrics
+    double ssimSum = 0.0;
+    int blocks = 0;
+    for (int by = 0; by + SSIM_BLOCK <= height; by += SSIM_BLOCK) {
+        for (int bx = 0; bx + SSIM_BLOCK <= width; bx += SSIM_BLOCK) {
+            size_t offset = (size_t)by * width + bx;
+            ssimSum += blockSsim(blockSums(&lumaA[offset], &lumaB[offset], width));
+            blocks++;
+        }
+    }
+    diff.ssim = blocks > 0 ? ssimSum / blocks : (diff.maxError == 0 ? 1.0 : 0.0);
+
+    if (heatmap != NULL) {
+        heatmap->resize(pixelCount * 4);
+        for (size_t i = 0; i < pixelCount; ++i) {
+            // Differences within the tolerance stay dark red, anything over it is bright red to yellow
+            int d = pixelDiff[i];
+            int heat = d > tolerance ? 128 + std::min(127, d) : d * 128 / (tolerance + 1);
+            int base = lumaA[i] / 4;
+            unsigned char* out = &(*heatmap)[i * 4];
+            out[0] = (unsigned char)std::min(255, base + 2 * heat);
+            out[1] = (unsigned char)std::min(255, base + std::max(0, 2 * heat - 255));
+            out[2] = (unsigned char)base;
+            out[3] = 255;
+        }
+    }
+    return diff;
+}
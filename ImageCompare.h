@@ -0,0 +1,27 @@
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+#include <stddef.h>
+#include <vector>
+
+// Difference metrics of two RGBA8 images of the same size
+struct ImageDiff {
+    double meanError;    // mean absolute channel difference (0-255)
+    int maxError;        // largest channel difference
+    size_t pixelsOver;   // pixels whose largest channel difference exceeds the tolerance
+    double ssim;         // mean structural similarity of the luma over 8x8 blocks (1 = identical)
+};
+
+// Fast image comparison for golden-image tests.
+// The per-pixel pass handles 4 pixels per SSE2 instruction (scalar elsewhere) and
+// also produces the luma planes; SSIM is then computed on non-overlapping 8x8
+// blocks from integer sums, so a 1080p frame compares in a few milliseconds.
+class ImageCompare {
+public:
+    // Compare two images. If heatmap is not NULL it receives an RGBA8 image
+    // of the differences (dimmed reference, hot colors where pixels differ).
+    static ImageDiff compare(const unsigned char* reference, const unsigned char* image,
+        int width, int height, int tolerance, std::vector<unsigned char>* heatmap = NULL);
+};
+
+#endif // IMAGE_COMPARE_H
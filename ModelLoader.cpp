@@ -1,10 +1,14 @@
 #include "ModelLoader.h"
 #include "lodepng.h"
+#include "Profiler.h"
+#include "TextureCache.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <map>
+#include <set>
 
 // ModelData implementation
 ModelData::ModelData() : VAO(0), texture(0), vertexCount(0) {
@@ -71,6 +75,7 @@ ModelData& ModelData::operator=(ModelData&& other) noexcept {
 
 // ModelLoader implementation
 std::unique_ptr<ModelData> ModelLoader::loadModel(const std::string& objPath, const std::string& texturePath) {
+    PROFILE_SCOPE("ModelLoader::loadModel");
     auto modelData = std::make_unique<ModelData>();
 
     if (!parseOBJ(objPath, modelData->vertices, modelData->normals, modelData->texCoords)) {
@@ -88,6 +93,7 @@ std::unique_ptr<ModelData> ModelLoader::loadModel(const std::string& objPath, co
 }
 
 std::unique_ptr<ModelData> ModelLoader::loadModel(const std::string& objPath) {
+    PROFILE_SCOPE("ModelLoader::loadModel");
     auto modelData = std::make_unique<ModelData>();
 
     if (!parseOBJ(objPath, modelData->vertices, modelData->normals, modelData->texCoords)) {
@@ -99,10 +105,32 @@ std::unique_ptr<ModelData> ModelLoader::loadModel(const std::string& objPath) {
     return modelData;
 }
 
+std::shared_ptr<ModelData> ModelLoader::loadShared(const std::string& objPath, const std::string& texturePath) {
+    static std::map<std::string, std::weak_ptr<ModelData>> cache;
+    static std::set<std::string> failed;
+
+    std::string key = objPath + "|" + texturePath;
+    std::shared_ptr<ModelData> modelData = cache[key].lock();
+    if (modelData || failed.count(key)) {
+        return modelData;
+    }
+
+    ModelLoader loader;
+    modelData = loader.loadModel(objPath, texturePath);
+    if (modelData) {
+        cache[key] = modelData;
+    }
+    else {
+        failed.insert(key);
+    }
+    return modelData;
+}
+
 bool ModelLoader::parseOBJ(const std::string& filePath,
     std::vector<glm::vec3>& vertices,
     std::vector<glm::vec3>& normals,
     std::vector<glm::vec2>& texCoords) {
+    PROFILE_SCOPE("ModelLoader::parseOBJ");
 
     std::ifstream file(filePath);
     if (!file.is_open()) {
@@ -191,6 +219,7 @@ bool ModelLoader::parseOBJ(const std::string& filePath,
 }
 
 GLuint ModelLoader::loadTexture(const std::string& texturePath) {
+    PROFILE_SCOPE("ModelLoader::loadTexture");
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
@@ -201,13 +230,11 @@ GLuint ModelLoader::loadTexture(const std::string& texturePath) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Using lodepng (same as your existing texture loading)
-    std::vector<unsigned char> image;
+    // Using lodepng (same as your existing texture loading), usually preloaded
     unsigned width, height;
-    unsigned error = lodepng::decode(image, width, height, texturePath);
+    unsigned error = TextureCache::upload(texturePath, width, height);
 
-    if (!error && !image.empty()) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+    if (!error) {
         glGenerateMipmap(GL_TEXTURE_2D);
     }
     else {
@@ -39,6 +39,11 @@ public:
     // Load OBJ model without texture
     std::unique_ptr<ModelData> loadModel(const std::string& objPath);
 
+    // Load a model once and share it between all instances made from the same files.
+    // The cache only holds weak references, so GPU resources go away with the last
+    // instance; files that failed to load are remembered and not retried.
+    static std::shared_ptr<ModelData> loadShared(const std::string& objPath, const std::string& texturePath);
+
 private:
     // Parse OBJ file
     bool parseOBJ(const std::string& filePath,
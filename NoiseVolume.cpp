@@ -0,0 +1,90 @@
+#include "NoiseVolume.h"
+#include "constants.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+static const glm::vec3 NOISE_FREQUENCY(2.1f, 1.7f, 2.3f);
+
+NoiseVolume::NoiseVolume(int size) : texture(0), size(size) {
+    PROFILE_SCOPE("NoiseVolume bake");
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<float> data(static_cast<size_t>(size) * size * size);
+
+    // Bake on all cores, one contiguous range of z slices per thread
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, static_cast<unsigned>(size));
+    std::vector<std::thread> workers;
+    int slicesPerThread = (size + threadCount - 1) / threadCount;
+
+    for (unsigned t = 0; t < threadCount; ++t) {
+        int zBegin = t * slicesPerThread;
+        int zEnd = std::min(size, zBegin + slicesPerThread);
+        if (zBegin >= zEnd) break;
+        workers.emplace_back(&NoiseVolume::bakeSlices, this, std::ref(data), zBegin, zEnd);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, size, size, size, 0, GL_RED, GL_FLOAT, data.data());
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    std::cout << "Baked " << size << "^3 fog noise volume on " << workers.size()
+        << " threads in " << elapsed.count() << " ms" << std::endl;
+}
+
+NoiseVolume::~NoiseVolume() {
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+glm::vec3 NoiseVolume::getPeriod() {
+    return glm::vec3(2.0f * PI) / NOISE_FREQUENCY;
+}
+
+float NoiseVolume::fractalNoise3D(const glm::vec3& p) {
+    float value = 0.0f;
+    float amplitude = 1.0f;
+    float frequency = 1.0f;
+
+    for (int i = 0; i < 4; i++) {
+        glm::vec3 q = p * frequency;
+        value += amplitude * std::sin(q.x * NOISE_FREQUENCY.x) * std::cos(q.y * NOISE_FREQUENCY.y) * std::sin(q.z * NOISE_FREQUENCY.z);
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+
+    return value;
+}
+
+void NoiseVolume::bakeSlices(std::vector<float>& data, int zBegin, int zEnd) const {
+    Profiler::setThreadName("Noise bake");
+    PROFILE_SCOPE("NoiseVolume::bakeSlices");
+    glm::vec3 texelSize = getPeriod() / static_cast<float>(size);
+
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int y = 0; y < size; ++y) {
+            float* row = &data[(static_cast<size_t>(z) * size + y) * size];
+            for (int x = 0; x < size; ++x) {
+                // Sample at texel centers so GL_LINEAR reproduces the function between them
+                glm::vec3 p = (glm::vec3(x, y, z) + 0.5f) * texelSize;
+                row[x] = fractalNoise3D(p);
+            }
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef NOISE_VOLUME_H
+#define NOISE_VOLUME_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Tileable 3D texture with the water fog's fractal noise baked into it.
+// noise3D() in f_water_fog.glsl is sin(2.1x) * cos(1.7y) * sin(2.3z) and every
+// octave doubles the frequency, so fractalNoise3D() repeats exactly every
+// (2*PI/2.1, 2*PI/1.7, 2*PI/2.3). One period is baked once at startup and the
+// shader samples it with GL_REPEAT instead of evaluating 4 octaves of sin/cos.
+class NoiseVolume {
+private:
+    GLuint texture;
+    int size;
+
+    // CPU copy of fractalNoise3D() from f_water_fog.glsl
+    static float fractalNoise3D(const glm::vec3& p);
+
+    // Fill z slices [zBegin, zEnd) of the volume
+    void bakeSlices(std::vector<float>& data, int zBegin, int zEnd) const;
+
+public:
+    explicit NoiseVolume(int size = 64);
+    ~NoiseVolume();
+
+    NoiseVolume(const NoiseVolume&) = delete;
+    NoiseVolume& operator=(const NoiseVolume&) = delete;
+
+    GLuint getTexture() const { return texture; }
+    int getSize() const { return size; }
+
+    // World-space period of the noise (texture covers exactly one period)
+    static glm::vec3 getPeriod();
+};
+
+#endif // NOISE_VOLUME_H
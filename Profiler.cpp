@@ -0,0 +1,150 @@
+#include "Profiler.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+bool Profiler::enabled = true;
+
+namespace {
+
+// Reference point for tick -> nanosecond conversion
+const std::chrono::steady_clock::time_point epochTime = std::chrono::steady_clock::now();
+const int64_t epochTicks = Profiler::now();
+
+static_assert((Profiler::EVENTS_PER_THREAD & (Profiler::EVENTS_PER_THREAD - 1)) == 0,
+    "ring buffer size must be a power of two");
+
+struct ThreadBuffer {
+    Profiler::Event events[Profiler::EVENTS_PER_THREAD];
+    std::atomic<uint64_t> count; // events ever recorded, ring index = count % size
+    int id;
+    std::string name;
+};
+
+// Buffers outlive their threads (worker threads exit before a capture is written)
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+std::vector<ThreadBuffer*> tracks;
+thread_local ThreadBuffer* currentBuffer = nullptr;
+
+// Caller holds registryMutex
+ThreadBuffer* createBuffer() {
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->id = (int)registry.size() + 1;
+    registry.push_back(std::move(buffer));
+    return registry.back().get();
+}
+
+ThreadBuffer* threadBuffer() {
+    if (currentBuffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        currentBuffer = createBuffer();
+        currentBuffer->name = currentBuffer->id == 1 ? "Main" : "Thread " + std::to_string(currentBuffer->id);
+    }
+    return currentBuffer;
+}
+
+void append(ThreadBuffer* buffer, const char* name, int64_t start, int64_t end) {
+    uint64_t index = buffer->count.load(std::memory_order_relaxed);
+    Profiler::Event& event = buffer->events[index & (Profiler::EVENTS_PER_THREAD - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') fputc('\\', file);
+        fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+double nanosecondsPerTick() {
+#ifdef PROFILER_USE_RDTSC
+    // Calibrate the TSC rate over the whole run so far (invariant TSC assumed)
+    int64_t ticks = Profiler::now() - epochTicks;
+    double elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epochTime).count();
+    return ticks > 0 && elapsedNs > 0.0 ? elapsedNs / (double)ticks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+} // namespace
+
+double Profiler::ticksToNanoseconds(int64_t ticks) {
+    return (ticks - epochTicks) * nanosecondsPerTick();
+}
+
+int64_t Profiler::nanosecondsToTicks(double nanoseconds) {
+    return epochTicks + (int64_t)(nanoseconds / nanosecondsPerTick());
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t end) {
+    append(threadBuffer(), name, start, end);
+}
+
+int Profiler::createTrack(const char* name) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ThreadBuffer* buffer = createBuffer();
+    buffer->name = name;
+    tracks.push_back(buffer);
+    return (int)tracks.size() - 1;
+}
+
+void Profiler::recordOnTrack(int track, const char* name, int64_t start, int64_t end) {
+    ThreadBuffer* buffer;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer = tracks[track];
+    }
+    append(buffer, name, start, end);
+}
+
+void Profiler::setThreadName(const char* name) {
+    ThreadBuffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+bool Profiler::writeChromeTrace(const char* fileName) {
+    #pragma warning(suppress : 4996)
+    FILE* file = fopen(fileName, "w");
+    if (file == NULL) return false;
+
+    // One calibration for the whole capture
+    const double scale = nanosecondsPerTick();
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& buffer : registry) {
+        if (!first) fprintf(file, ",\n");
+        first = false;
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", buffer->id);
+        writeJsonString(file, buffer->name.c_str());
+        fprintf(file, "}}");
+
+        // Oldest surviving event first; a thread still recording may overwrite the oldest few
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t available = count < (uint64_t)EVENTS_PER_THREAD ? count : (uint64_t)EVENTS_PER_THREAD;
+        for (uint64_t i = count - available; i < count; i++) {
+            const Event& event = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+            fprintf(file, ",\n{\"name\":");
+            writeJsonString(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                buffer->id, (event.start - epochTicks) * scale / 1000.0, (event.end - event.start) * scale / 1000.0);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    return true;
+}
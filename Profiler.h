@@ -0,0 +1,125 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_USE_RDTSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILER_USE_RDTSC 1
+#endif
+
+// Lightweight CPU profiler with scoped timers.
+// Timestamps come from rdtsc on x86 (converted to nanoseconds against
+// steady_clock when a capture is written), steady_clock elsewhere.
+// Every thread records into its own ring buffer (no locks on the hot path), so
+// the profiler always holds the most recent few seconds of activity. A capture
+// writes those events as Chrome trace JSON, which opens in Perfetto or
+// chrome://tracing; nesting is reconstructed from the timestamps.
+//
+//     void drawSomething() {
+//         PROFILE_SCOPE("Draw something");
+//         ...
+//     }
+//
+// Scope names must be string literals (only the pointer is stored).
+class Profiler {
+public:
+    struct Event {
+        const char* name;
+        int64_t start; // ticks, see now()
+        int64_t end;
+    };
+
+    static const int EVENTS_PER_THREAD = 32768;
+
+    // Raw timestamp in ticks (TSC cycles or steady_clock nanoseconds)
+    static int64_t now() {
+#ifdef PROFILER_USE_RDTSC
+        return (int64_t)__rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Convert a now() value to nanoseconds since the profiler started
+    static double ticksToNanoseconds(int64_t ticks);
+
+    // Inverse of ticksToNanoseconds, for timestamps measured elsewhere (GPU)
+    static int64_t nanosecondsToTicks(double nanoseconds);
+
+    static void record(const char* name, int64_t start, int64_t end);
+
+    // Extra timeline not tied to a CPU thread (e.g. GPU passes). Each track
+    // must be written from one thread at a time; times are in ticks.
+    static int createTrack(const char* name);
+    static void recordOnTrack(int track, const char* name, int64_t start, int64_t end);
+
+    static void setEnabled(bool value) { enabled = value; }
+    static bool isEnabled() { return enabled; }
+
+    // Name shown for the calling thread in the trace (e.g. "Main", "Noise bake")
+    static void setThreadName(const char* name);
+
+    // Write every buffered event to a Chrome trace JSON file; returns false if the file can't be opened
+    static bool writeChromeTrace(const char* fileName);
+
+private:
+    static bool enabled;
+};
+
+// RAII timer behind PROFILE_SCOPE
+class ProfileScope {
+private:
+    const char* name;
+    int64_t start;
+
+public:
+    explicit ProfileScope(const char* name) : name(name), start(Profiler::isEnabled() ? Profiler::now() : -1) {}
+    ~ProfileScope() {
+        if (start >= 0) Profiler::record(name, start, Profiler::now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+// Times consecutive sections of one function without extra braces:
+//     ProfileSequence section("Update");
+//     ...
+//     section.next("Draw");   // ends "Update", starts "Draw"
+//     ...                     // "Draw" ends with the object
+class ProfileSequence {
+private:
+    const char* name;
+    int64_t start;
+
+public:
+    explicit ProfileSequence(const char* name) : name(name), start(Profiler::isEnabled() ? Profiler::now() : -1) {}
+    ~ProfileSequence() { end(); }
+
+    void next(const char* nextName) {
+        int64_t t = Profiler::isEnabled() ? Profiler::now() : -1;
+        if (start >= 0 && t >= 0) Profiler::record(name, start, t);
+        name = nextName;
+        start = t;
+    }
+
+    void end() {
+        if (start >= 0) Profiler::record(name, start, Profiler::now());
+        start = -1;
+    }
+
+    ProfileSequence(const ProfileSequence&) = delete;
+    ProfileSequence& operator=(const ProfileSequence&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif // PROFILER_H
@@ -0,0 +1,25 @@
+#include "Random.h"
+
+namespace {
+
+uint32_t currentSeed = std::random_device{}();
+
+std::mt19937& sharedEngine() {
+    static std::mt19937 engine(currentSeed);
+    return engine;
+}
+
+} // namespace
+
+std::mt19937& Random::engine() {
+    return sharedEngine();
+}
+
+void Random::seed(uint32_t value) {
+    currentSeed = value;
+    sharedEngine().seed(value);
+}
+
+uint32_t Random::getSeed() {
+    return currentSeed;
+}
@@ -0,0 +1,23 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <random>
+#include <stdint.h>
+
+// Shared random engine for scene generation and fish behaviour.
+// Seeded from std::random_device unless seed() is called first (--seed, headless
+// runs), in which case every stone, coral and fish is placed and moves the same
+// way on every run. Main thread only.
+class Random {
+public:
+    static std::mt19937& engine();
+
+    // Restart the sequence from a fixed seed
+    static void seed(uint32_t value);
+
+    // Seed of the current sequence (also when it came from random_device), so a
+    // run can be repeated, e.g. by storing it in a camera recording
+    static uint32_t getSeed();
+};
+
+#endif // RANDOM_H
@@ -0,0 +1,167 @@
+#include "ShaderLibrary.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Polling interval for the modification time fallback
+static const std::chrono::milliseconds POLL_INTERVAL(500);
+
+static long long fileModificationTime(const std::string& fileName) {
+    struct stat info;
+    if (stat(fileName.c_str(), &info) != 0) return -1;
+    return (long long)info.st_mtime;
+}
+
+static std::string directoryOf(const std::string& fileName) {
+    size_t slash = fileName.find_last_of("/\\");
+    return slash == std::string::npos ? "." : fileName.substr(0, slash);
+}
+
+ShaderLibrary::ShaderLibrary() : lastPoll(std::chrono::steady_clock::now()) {
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cout << "inotify unavailable, shader hot reload falls back to polling" << std::endl;
+    }
+#endif
+}
+
+ShaderLibrary::~ShaderLibrary() {
+    for (auto& entry : programs) {
+        delete entry.second;
+    }
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
+
+void ShaderLibrary::watchFile(const char* fileName) {
+    if (fileName == NULL || watchedFiles.count(fileName)) return;
+    watchedFiles[fileName] = fileModificationTime(fileName);
+
+#ifdef __linux__
+    // Watch the directory rather than the file: editors often save by writing a new file and renaming it
+    if (inotifyFd < 0) return;
+    std::string directory = directoryOf(fileName);
+    for (const auto& entry : watchedDirectories) {
+        if (entry.second == directory) return;
+    }
+    int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd >= 0) watchedDirectories[wd] = directory;
+#endif
+}
+
+void ShaderLibrary::collectChangedFiles(std::set<std::string>& changed) {
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        alignas(struct inotify_event) char buffer[4096];
+        for (;;) {
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) break; // EAGAIN: no more events
+
+            for (char* p = buffer; p < buffer + length;) {
+                struct inotify_event* event = (struct inotify_event*)p;
+                if (event->len > 0) {
+                    auto directory = watchedDirectories.find(event->wd);
+                    if (directory != watchedDirectories.end()) {
+                        std::string fileName = directory->second == "." ?
+                            std::string(event->name) : directory->second + "/" + event->name;
+                        if (watchedFiles.count(fileName)) changed.insert(fileName);
+                    }
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return;
+    }
+#endif
+
+    // Fallback: compare modification times a few times per second
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < POLL_INTERVAL) return;
+    lastPoll = now;
+
+    for (auto& entry : watchedFiles) {
+        long long modified = fileModificationTime(entry.first);
+        if (modified != entry.second && modified >= 0) {
+            entry.second = modified;
+            changed.insert(entry.first);
+        }
+    }
+}
+
+int ShaderLibrary::reloadChanged() {
+    std::set<std::string> changed;
+    collectChangedFiles(changed);
+    if (changed.empty()) return 0;
+
+    int reloaded = 0;
+    for (const std::string& fileName : changed) {
+        std::cout << "Shader source changed: " << fileName << std::endl;
+    }
+    for (auto& entry : programs) {
+        for (const std::string& fileName : changed) {
+            if (entry.second->usesFile(fileName)) {
+                if (entry.second->reload()) reloaded++;
+                break;
+            }
+        }
+    }
+    return reloaded;
+}
+
+std::string ShaderLibrary::normalizeDefines(const char* defines) {
+    if (defines == NULL) return "";
+
+    std::vector<std::string> flags;
+    std::istringstream stream(defines);
+    std::string flag;
+    while (stream >> flag) {
+        flags.push_back(flag);
+    }
+    std::sort(flags.begin(), flags.end());
+    flags.erase(std::unique(flags.begin(), flags.end()), flags.end());
+
+    std::string result;
+    for (const std::string& f : flags) {
+        if (!result.empty()) result += ' ';
+        result += f;
+    }
+    return result;
+}
+
+ShaderProgram* ShaderLibrary::get(const char* vertexShaderFile, const char* geometryShaderFile,
+    const char* fragmentShaderFile, const char* defines) {
+    std::string normalized = normalizeDefines(defines);
+    std::string key = std::string(vertexShaderFile) + "|" +
+        (geometryShaderFile != NULL ? geometryShaderFile : "") + "|" +
+        fragmentShaderFile + "|" + normalized;
+
+    auto found = programs.find(key);
+    if (found != programs.end()) {
+        return found->second;
+    }
+
+    ShaderProgram* program = new ShaderProgram(vertexShaderFile, geometryShaderFile, fragmentShaderFile,
+        normalized.empty() ? NULL : normalized.c_str());
+    programs[key] = program;
+
+    watchFile(vertexShaderFile);
+    watchFile(geometryShaderFile);
+    watchFile(fragmentShaderFile);
+    return program;
+}
+
+std::vector<ShaderProgram*> ShaderLibrary::all() const {
+    std::vector<ShaderProgram*> result;
+    result.reserve(programs.size());
+    for (const auto& entry : programs) {
+        result.push_back(entry.second);
+    }
+    return result;
+}
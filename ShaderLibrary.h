@@ -0,0 +1,54 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "shaderprogram.h"
+
+// Owns every shader program and builds permutations of one source file set
+// from #define feature flags (e.g. "FOG SWAY ALPHA_DISCARD").
+// Each (files, flags) combination is compiled once; asking for it again returns
+// the same program, so materials can select their variant freely.
+// Source files are watched (inotify on Linux, modification time polling elsewhere)
+// and programs built from a changed file are recompiled in place.
+class ShaderLibrary {
+private:
+    std::map<std::string, ShaderProgram*> programs;
+
+    // Hot reload: watched files and their last modification time (polling fallback)
+    std::map<std::string, long long> watchedFiles;
+    std::chrono::steady_clock::time_point lastPoll;
+#ifdef __linux__
+    int inotifyFd;
+    std::map<int, std::string> watchedDirectories; // watch descriptor -> directory
+#endif
+
+    void watchFile(const char* fileName);
+    void collectChangedFiles(std::set<std::string>& changed);
+
+    // Sorted, de-duplicated flags so "FOG SWAY" and "SWAY FOG" share one program
+    static std::string normalizeDefines(const char* defines);
+
+public:
+    ShaderLibrary();
+    ~ShaderLibrary();
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    // Returns the cached permutation or submits a new one (compiled asynchronously, see ShaderProgram::finalize)
+    ShaderProgram* get(const char* vertexShaderFile, const char* geometryShaderFile,
+        const char* fragmentShaderFile, const char* defines = NULL);
+
+    // Recompile programs whose source files changed on disk; call once per frame.
+    // Returns the number of programs swapped to a new version.
+    int reloadChanged();
+
+    std::vector<ShaderProgram*> all() const;
+    int size() const { return (int)programs.size(); }
+};
+
+#endif // SHADER_LIBRARY_H
@@ -1,17 +1,18 @@
 #include "Stone.h"
+#include "Random.h"
+#include "constants.h"
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>  // Add this line for glm::value_ptr
 
+// Stone types
+static const std::vector<std::string> stoneTypes = { "Rock01", "Rock02" };
+
 Stone::Stone(const std::string& objPath, const std::string& texturePath,
     glm::vec3 pos, glm::vec3 rot, glm::vec3 scl)
     : position(pos), rotation(rot), scale(scl) {
 
-    ModelLoader loader;
-    modelData = loader.loadModel(objPath, texturePath);
-
-    if (!modelData) {
-        std::cerr << "Failed to load stone model: " << objPath << std::endl;
-    }
+    // Loaded once per model file; a failed load is reported once by the loader
+    modelData = ModelLoader::loadShared(objPath, texturePath);
 }
 
 void Stone::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view, float time) {
@@ -20,12 +21,7 @@ void Stone::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::
     shader->use();
 
     // Create model matrix
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, position);
-    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::scale(model, scale);
+    glm::mat4 model = Transform::fromEulerDegrees(position, rotation, scale).matrix();
 
     // Send matrices to shader
     glUniformMatrix4fv(shader->u("P"), 1, false, glm::value_ptr(projection));
@@ -38,7 +34,9 @@ void Stone::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::
     if (modelData->texture != 0) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, modelData->texture);
-        glUniform1i(shader->u("stoneTexture"), 0);
+        // Sand material: the stone texture doubles as its height map
+        glUniform1i(shader->u("sandDiffuse"), 0);
+        glUniform1i(shader->u("sandDisplacement"), 0);
     }
 
     // Draw the stone
@@ -47,23 +45,49 @@ void Stone::draw(ShaderProgram* shader, const glm::mat4& projection, const glm::
     glBindVertexArray(0);
 }
 
-std::vector<std::unique_ptr<Stone>> Stone::createRandomStones() {
+void Stone::drawDepth(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view) {
+    if (!modelData || !shader) return;
+
+    shader->use();
+
+    glm::mat4 model = Transform::fromEulerDegrees(position, rotation, scale).matrix();
+
+    glUniformMatrix4fv(shader->u("P"), 1, false, glm::value_ptr(projection));
+    glUniformMatrix4fv(shader->u("V"), 1, false, glm::value_ptr(view));
+    glUniformMatrix4fv(shader->u("M"), 1, false, glm::value_ptr(model));
+
+    glBindVertexArray(modelData->VAO);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(modelData->vertexCount));
+    glBindVertexArray(0);
+}
+
+std::vector<std::string> Stone::textureFiles() {
+    std::vector<std::string> files;
+    for (const std::string& type : stoneTypes) {
+        files.push_back(type + ".png");
+    }
+    return files;
+}
+
+std::vector<std::unique_ptr<Stone>> Stone::createRandomStones(int count) {
     std::vector<std::unique_ptr<Stone>> stones;
 
     // Random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937& gen = Random::engine();
     std::uniform_real_distribution<float> xDist(-6.5f, 6.5f);  // Inside aquarium X bounds
     std::uniform_real_distribution<float> zDist(-4.5f, 4.5f);  // Inside aquarium Z bounds
     std::uniform_real_distribution<float> rotDist(0.0f, 360.0f);
     std::uniform_real_distribution<float> scaleDist(0.3f, 0.8f);
 
-    // Stone types
-    std::vector<std::string> stoneTypes = { "Rock01", "Rock02" };
+    // Create 6 stones (3 of each type) unless a count is given
+    const int typeCount = (int)stoneTypes.size();
+    const bool spaced = count <= MAX_SPACED_OBJECTS;
+    const bool logEach = count <= MAX_LOGGED_OBJECTS;
+    if (count > 0) stones.reserve(count);
 
-    // Create 4 stones: 2 of each type
-    for (int type = 0; type < 2; ++type) {
-        for (int i = 0; i < 3; ++i) {
+    for (int type = 0; type < typeCount; ++type) {
+        int stoneCount = count < 0 ? 3 : count / typeCount + (type < count % typeCount ? 1 : 0);
+        for (int i = 0; i < stoneCount; ++i) {
             // Generate random position on aquarium floor
             glm::vec3 position;
             bool validPosition = false;
@@ -79,6 +103,7 @@ std::vector<std::unique_ptr<Stone>> Stone::createRandomStones() {
 
                 // Check distance from existing stones
                 validPosition = true;
+                if (!spaced) break;
                 for (const auto& existingStone : stones) {
                     float distance = glm::length(position - existingStone->getPosition());
                     if (distance < 2.0f) { // Minimum 2 units apart
@@ -107,8 +132,10 @@ std::vector<std::unique_ptr<Stone>> Stone::createRandomStones() {
             auto stone = std::make_unique<Stone>(objPath, texPath, position, rotation, scale);
             stones.push_back(std::move(stone));
 
-            std::cout << "Created " << stoneTypes[type] << " at position ("
-                << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+            if (logEach) {
+                std::cout << "Created " << stoneTypes[type] << " at position ("
+                    << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+            }
         }
     }
 
@@ -3,6 +3,7 @@
 
 #include "ModelLoader.h"
 #include "shaderprogram.h"
+#include "Transform.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -10,7 +11,7 @@
 
 class Stone {
 private:
-    std::unique_ptr<ModelData> modelData;
+    std::shared_ptr<ModelData> modelData; // shared by all instances of the same model
     glm::vec3 position;
     glm::vec3 rotation;
     glm::vec3 scale;
@@ -20,13 +21,17 @@ public:
         glm::vec3 pos, glm::vec3 rot = glm::vec3(0.0f), glm::vec3 scl = glm::vec3(1.0f));
 
     void draw(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view, float time);
+    void drawDepth(ShaderProgram* shader, const glm::mat4& projection, const glm::mat4& view); // Depth pre-pass
 
     // Getters
     glm::vec3 getPosition() const { return position; }
     glm::vec3 getScale() const { return scale; }
 
-    // Static method to create random stones in aquarium
-    static std::vector<std::unique_ptr<Stone>> createRandomStones();
+    // Static method to create random stones in aquarium (count < 0: 3 of each type)
+    static std::vector<std::unique_ptr<Stone>> createRandomStones(int count = -1);
+
+    // Texture of every stone type (for preloading)
+    static std::vector<std::string> textureFiles();
 };
 
 #endif // STONE_H
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "TextureCache.h"
+#include "lodepng.h"
+#include "Profiler.h"
+#include <GL/glew.h>
+#include <fstream>
+#include <map>
+#include <string.h>
+#include <utility>
+
+static std::map<std::string, lodepng::DecodeJob> preloaded;
+static bool verifyChecksums = true;
+
+static void setChecksums(LodePNGState& state) {
+    state.decoder.ignore_crc = !verifyChecksums;
+    state.decoder.zlibsettings.ignore_adler32 = !verifyChecksums;
+}
+
+// Whether the PNG header (signature and IHDR chunk, the first 33 bytes) says the image is streamed
+static bool isStreamed(const std::string& path) {
+    unsigned char header[33];
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.read((char*)header, sizeof(header))) return false;
+
+    unsigned width, height;
+    lodepng::State state;
+    if (lodepng_inspect(&width, &height, &state, header, sizeof(header)) != 0) return false;
+    return (unsigned long long)width * height >= TextureCache::STREAM_PIXELS;
+}
+
+// Collects decoded rows into a band and uploads each full band into the bound texture
+struct StreamUpload {
+    lodepng::StreamDecoder decoder;
+    std::vector<unsigned char> band;
+    unsigned bandStart = 0;
+    unsigned bandRows = 0;
+
+    static void row(void* context, unsigned y, const unsigned char* pixels) {
+        StreamUpload& upload = *(StreamUpload*)context;
+        const unsigned width = upload.decoder.w;
+        const unsigned height = upload.decoder.h;
+        const size_t rowSize = (size_t)width * 4;
+        if (y == 0) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            upload.band.resize(rowSize * TextureCache::STREAM_BAND_ROWS);
+        }
+
+        memcpy(&upload.band[rowSize * upload.bandRows], pixels, rowSize);
+        upload.bandRows++;
+        if (upload.bandRows == TextureCache::STREAM_BAND_ROWS || y + 1 == height) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.bandStart, width, upload.bandRows, GL_RGBA, GL_UNSIGNED_BYTE, upload.band.data());
+            upload.bandStart = y + 1;
+            upload.bandRows = 0;
+        }
+    }
+};
+
+static unsigned uploadStreamed(const std::string& path, unsigned& width, unsigned& height) {
+    PROFILE_SCOPE("TextureCache::uploadStreamed");
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file) return 78; // failed to open file for reading
+
+    StreamUpload upload;
+    setChecksums(upload.decoder.state);
+    upload.decoder.row = StreamUpload::row;
+    upload.decoder.context = &upload;
+    std::vector<char> piece(65536);
+    unsigned error = 0;
+    while (!error && !upload.decoder.done && file) {
+        file.read(piece.data(), piece.size());
+        error = lodepng_stream_decoder_push(&upload.decoder, (const unsigned char*)piece.data(), (size_t)file.gcount());
+    }
+    if (!error && !upload.decoder.done) error = 30; // file ends in the middle of the PNG
+    width = upload.decoder.w;
+    height = upload.decoder.h;
+    return error;
+}
+
+void TextureCache::setVerifyChecksums(bool verify) {
+    verifyChecksums = verify;
+}
+
+void TextureCache::preload(const std::vector<std::string>& paths) {
+    PROFILE_SCOPE("TextureCache::preload");
+    std::vector<lodepng::DecodeJob> jobs;
+    for (const std::string& path : paths) {
+        if (preloaded.count(path) == 0 && !isStreamed(path)) {
+            jobs.push_back(lodepng::DecodeJob(path));
+            jobs.back().ignore_checksums = !verifyChecksums;
+        }
+    }
+
+    lodepng::decodeBatch(jobs);
+
+    for (lodepng::DecodeJob& job : jobs) {
+        std::string path = job.filename;
+        preloaded[path] = std::move(job);
+    }
+}
+
+unsigned TextureCache::decode(const std::string& path, std::vector<unsigned char>& image, unsigned& width, unsigned& height) {
+    auto found = preloaded.find(path);
+    if (found == preloaded.end()) {
+        // Not preloaded: overlap inflating and unfiltering of this one file at least
+        std::vector<unsigned char> png;
+        unsigned error = lodepng::load_file(png, path);
+        if (error) return error;
+        lodepng::State state;
+        setChecksums(state);
+        return lodepng::decodePipelined(image, width, height, state, png.data(), png.size());
+    }
+
+    lodepng::DecodeJob& job = found->second;
+    unsigned error = job.error;
+    image.swap(job.image);
+    width = job.w;
+    height = job.h;
+    preloaded.erase(found);
+    return error;
+}
+
+unsigned TextureCache::upload(const std::string& path, unsigned& width, unsigned& height) {
+    if (preloaded.count(path) == 0 && isStreamed(path)) {
+        return uploadStreamed(path, width, height);
+    }
+
+    std::vector<unsigned char> image;
+    unsigned error = decode(path, image, width, height);
+    if (!error) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+    }
+    return error;
+}
+
+void TextureCache::clear() {
+    preloaded.clear();
+}
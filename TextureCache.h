@@ -0,0 +1,35 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <vector>
+
+// Decoded RGBA8 images of the PNG textures.
+// preload() decodes all given files at once on a pool of threads (lodepng::decodeBatch),
+// so startup waits for the slowest file instead of the sum of all of them. decode() hands
+// out a preloaded image once and decodes files that weren't preloaded on the spot.
+// Textures of STREAM_PIXELS or more are never held in memory as a whole: preload() skips
+// them and upload() streams them from disk (lodepng::StreamDecoder) in bands of rows.
+// Used from the main thread only.
+class TextureCache {
+public:
+    static const unsigned STREAM_PIXELS = 4096 * 4096;
+    static const unsigned STREAM_BAND_ROWS = 64;
+
+    // Whether the CRC and Adler-32 checksums of the files are checked (default). Off for trusted
+    // files saves computing them; a damaged file then gives wrong pixels instead of an error.
+    static void setVerifyChecksums(bool verify);
+
+    static void preload(const std::vector<std::string>& paths);
+
+    // RGBA8 pixels of a PNG file, top row first; returns the lodepng error code
+    static unsigned decode(const std::string& path, std::vector<unsigned char>& image, unsigned& width, unsigned& height);
+
+    // Load a PNG file into level 0 of the bound GL_TEXTURE_2D as RGBA8; returns the lodepng error code
+    static unsigned upload(const std::string& path, unsigned& width, unsigned& height);
+
+    // Drop preloaded images nobody asked for
+    static void clear();
+};
+
+#endif // TEXTURE_CACHE_H
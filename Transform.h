@@ -0,0 +1,52 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+// Object placement stored as translation + rotation quaternion + scale.
+// Builds the model matrix and the normal matrix on the CPU once per draw,
+// so vertex shaders no longer need mat3(transpose(inverse(M))) per vertex.
+struct Transform {
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+
+    Transform(const glm::vec3& pos, const glm::quat& rot, const glm::vec3& scl)
+        : translation(pos), rotation(rot), scale(scl) {}
+
+    // Same rotation order as the old translate * rotX * rotY * rotZ * scale chain (angles in degrees)
+    static Transform fromEulerDegrees(const glm::vec3& pos, const glm::vec3& rotDeg, const glm::vec3& scl) {
+        glm::quat q = glm::angleAxis(glm::radians(rotDeg.x), glm::vec3(1.0f, 0.0f, 0.0f))
+            * glm::angleAxis(glm::radians(rotDeg.y), glm::vec3(0.0f, 1.0f, 0.0f))
+            * glm::angleAxis(glm::radians(rotDeg.z), glm::vec3(0.0f, 0.0f, 1.0f));
+        return Transform(pos, q, scl);
+    }
+
+    bool hasUniformScale() const {
+        return scale.x == scale.y && scale.y == scale.z;
+    }
+
+    glm::mat4 matrix() const {
+        glm::mat3 r = glm::mat3_cast(rotation);
+        glm::mat4 m(1.0f);
+        m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+        m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+        m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+        m[3] = glm::vec4(translation, 1.0f);
+        return m;
+    }
+
+    // Normal matrix for the vertex shader. With uniform scale the inverse-transpose is
+    // just the rotation (length is restored by normalize() in the fragment shaders).
+    glm::mat3 normalMatrix() const {
+        if (hasUniformScale()) {
+            return glm::mat3_cast(rotation);
+        }
+        return glm::inverseTranspose(glm::mat3(matrix()));
+    }
+};
+
+#endif // TRANSFORM_H
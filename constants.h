@@ -22,4 +22,8 @@ Place, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 const float PI = 3.141592653589793f;
 
+// Scene population limits (benchmark scenarios create up to millions of objects)
+const int MAX_SPACED_OBJECTS = 512; // above this, placement skips the pairwise spacing check
+const int MAX_LOGGED_OBJECTS = 32;  // above this, objects are created without a log line each
+
 #endif
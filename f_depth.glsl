@@ -0,0 +1,18 @@
+#version 330 core
+
+// Depth pre-pass: no color output, depth is written by fixed function.
+// ALPHA_DISCARD permutation: alpha tested geometry (same cutoff as f_model.glsl)
+
+#ifdef ALPHA_DISCARD
+in vec2 TexCoord;
+
+uniform sampler2D alphaTexture;
+#endif
+
+void main()
+{
+#ifdef ALPHA_DISCARD
+    if (texture(alphaTexture, TexCoord).a < 0.1)
+        discard;
+#endif
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+// Downsamples scene depth for the low resolution fog pass.
+// Alternates min/max in a checkerboard so both near and far surfaces
+// along silhouettes survive for the bilateral upsample.
+
+uniform sampler2D sceneDepth;
+uniform int downscale;
+
+void main()
+{
+    ivec2 base = ivec2(gl_FragCoord.xy) * downscale;
+    ivec2 maxCoord = textureSize(sceneDepth, 0) - 1;
+    bool useMax = ((int(gl_FragCoord.x) + int(gl_FragCoord.y)) & 1) == 1;
+
+    float depth = useMax ? 0.0 : 1.0;
+    for (int y = 0; y < downscale; y++) {
+        for (int x = 0; x < downscale; x++) {
+            float d = texelFetch(sceneDepth, min(base + ivec2(x, y), maxCoord), 0).r;
+            depth = useMax ? max(depth, d) : min(depth, d);
+        }
+    }
+
+    gl_FragDepth = depth;
+}
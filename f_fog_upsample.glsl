@@ -0,0 +1,48 @@
+#version 330 core
+
+out vec4 FragColor;
+
+// Depth-aware bilateral upsample of the low resolution fog (premultiplied alpha)
+
+uniform sampler2D fogColor;
+uniform sampler2D fogDepth;
+uniform sampler2D sceneDepth;
+uniform int downscale;
+uniform float nearPlane;
+uniform float farPlane;
+
+float linearDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * nearPlane * farPlane / (farPlane + nearPlane - z * (farPlane - nearPlane));
+}
+
+void main()
+{
+    float fullDepth = linearDepth(texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r);
+
+    // Position of this pixel in low resolution texel space
+    vec2 lowPos = gl_FragCoord.xy / float(downscale) - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - vec2(base);
+    ivec2 maxCoord = textureSize(fogColor, 0) - 1;
+
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            ivec2 coord = clamp(base + ivec2(x, y), ivec2(0), maxCoord);
+
+            // Bilinear weight scaled down by depth difference to the full resolution pixel
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float lowDepth = linearDepth(texelFetch(fogDepth, coord, 0).r);
+            float weight = bilinear / (0.001 + abs(lowDepth - fullDepth));
+
+            sum += texelFetch(fogColor, coord, 0) * weight;
+            weightSum += weight;
+        }
+    }
+
+    FragColor = sum / max(weightSum, 1e-6);
+}
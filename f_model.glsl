@@ -0,0 +1,52 @@
+// f_model.glsl - Fragment shader for OBJ models (fish, corals)
+// Permutation flags (ShaderLibrary):
+//   ALPHA_DISCARD  - alpha tested texture (cutoff 0.1, same as the depth pre-pass)
+//   FOG            - distance based underwater fog
+//   CORAL_LIGHTING - brighter ambient and lighter fog for colorful corals
+#version 330 core
+
+in vec2 TexCoord;
+in vec3 Normal;
+in vec3 FragPos;
+
+out vec4 FragColor;
+
+uniform sampler2D diffuseTexture;
+uniform vec3 cameraPos;
+
+#ifdef CORAL_LIGHTING
+const vec3 ambient = vec3(0.35, 0.4, 0.5); // Slightly brighter ambient for colorful corals
+const float fogDensity = 0.008;
+const vec3 fogColor = vec3(0.05, 0.1, 0.15);
+#else
+const vec3 ambient = vec3(0.3, 0.4, 0.5); // Underwater ambient
+const float fogDensity = 0.03;
+const vec3 fogColor = vec3(0.1, 0.2, 0.3);
+#endif
+
+void main() {
+    vec4 texColor = texture(diffuseTexture, TexCoord);
+    
+#ifdef ALPHA_DISCARD
+    if(texColor.a < 0.1)
+        discard;
+#endif
+    
+    vec3 norm = normalize(Normal);
+    
+    // Simple lighting without spotlights
+    vec3 lightDir = normalize(vec3(0.2, 1.0, 0.3));
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * vec3(1.0, 1.0, 1.0);
+    
+    vec3 result = (ambient + diffuse * 0.7) * texColor.rgb;
+    
+#ifdef FOG
+    // Subtle underwater fog effect
+    float distance = length(cameraPos - FragPos);
+    float fogFactor = exp(-distance * fogDensity);
+    result = mix(fogColor, result, fogFactor);
+#endif
+    
+    FragColor = vec4(result, texColor.a);
+}
@@ -7,6 +7,7 @@ in vec3 LocalPos;
 
 uniform float time;
 uniform vec3 cameraPos;
+uniform bool roomView; // true: bright room around the aquarium, false: underwater
 
 // Enhanced noise function for better water distortion
 float noise(vec3 p) {
@@ -40,7 +41,8 @@ vec3 waterDistortion(vec3 pos, float time) {
     return distorted;
 }
 
-void main()
+// Underwater view (camera inside the aquarium)
+vec3 underwaterSky()
 {
     vec3 pos = normalize(LocalPos);
     
@@ -132,5 +134,49 @@ void main()
     float vignette = 1.0 - length(distortedPos.xy) * 0.15;
     finalColor *= vignette;
     
-    FragColor = vec4(finalColor, 1.0);
+    return finalColor;
+}
+
+// Bright room view (camera outside the aquarium)
+vec3 roomSky()
+{
+    vec3 pos = normalize(LocalPos);
+    
+    // Bright room atmosphere - gradient from light walls to ceiling
+    vec3 wallColor = vec3(0.95, 0.95, 0.97);      // Light gray walls
+    vec3 ceilingColor = vec3(1.0, 1.0, 1.0);      // White ceiling
+    vec3 floorColor = vec3(0.85, 0.85, 0.9);      // Slightly darker floor area
+    
+    // Vertical gradient based on Y position
+    float heightFactor = pos.y * 0.5 + 0.5; // Convert from [-1,1] to [0,1]
+    
+    vec3 baseColor;
+    if (heightFactor > 0.7) {
+        // Upper area - ceiling
+        float ceilingBlend = (heightFactor - 0.7) / 0.3;
+        baseColor = mix(wallColor, ceilingColor, ceilingBlend);
+    } else if (heightFactor < 0.3) {
+        // Lower area - floor direction
+        float floorBlend = (0.3 - heightFactor) / 0.3;
+        baseColor = mix(wallColor, floorColor, floorBlend);
+    } else {
+        // Middle area - walls
+        baseColor = wallColor;
+    }
+    
+    // Add subtle room lighting variation
+    float lightVariation = 0.95 + 0.05 * sin(pos.x * 2.0) * cos(pos.z * 1.5);
+    baseColor *= lightVariation;
+    
+    // Subtle warm lighting
+    vec3 warmTint = vec3(1.02, 1.01, 0.99);
+    baseColor *= warmTint;
+    
+    return baseColor;
+}
+
+void main()
+{
+    // Dynamically uniform branch: one program serves both views without rebinding
+    FragColor = vec4(roomView ? roomSky() : underwaterSky(), 1.0);
 }
\ No newline at end of file
@@ -9,6 +9,11 @@ in float DistanceFromCamera;
 uniform float time;
 uniform vec3 cameraPos;
 
+// Baked copy of fractalNoise3D (one period, GL_REPEAT), see NoiseVolume.cpp
+uniform sampler3D noiseVolume;
+uniform vec3 noiseVolumeScale; // 1.0 / noise period
+// NOISE_VOLUME permutation (ShaderLibrary) samples it instead of evaluating fractalNoise3D
+
 // 3D noise function for volumetric fog
 float noise3D(vec3 p) {
     return sin(p.x * 2.1) * cos(p.y * 1.7) * sin(p.z * 2.3);
@@ -28,6 +33,14 @@ float fractalNoise3D(vec3 p) {
     return value;
 }
 
+float fogNoise(vec3 p) {
+#ifdef NOISE_VOLUME
+    return texture(noiseVolume, p * noiseVolumeScale).r;
+#else
+    return fractalNoise3D(p);
+#endif
+}
+
 void main()
 {
     // Base fog color - subtle blue-green underwater tint
@@ -37,9 +50,9 @@ void main()
     vec3 fogPos = WorldPos + vec3(time * 0.1, time * 0.05, time * 0.08);
     
     // Multiple layers of 3D noise for realistic fog volume
-    float fog1 = fractalNoise3D(fogPos * 0.8);
-    float fog2 = fractalNoise3D(fogPos * 1.2 + vec3(100.0));
-    float fog3 = fractalNoise3D(fogPos * 0.5 + vec3(200.0));
+    float fog1 = fogNoise(fogPos * 0.8);
+    float fog2 = fogNoise(fogPos * 1.2 + vec3(100.0));
+    float fog3 = fogNoise(fogPos * 0.5 + vec3(200.0));
     
     // Combine fog layers
     float fogDensity = (fog1 + fog2 * 0.7 + fog3 * 0.5) / 3.0;
@@ -35,13 +35,51 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 
 #ifdef LODEPNG_COMPILE_CPP
 #include <fstream>
+#include <new>
+#ifdef LODEPNG_COMPILE_THREADS
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#endif /*LODEPNG_COMPILE_THREADS*/
 #endif /*LODEPNG_COMPILE_CPP*/
 
+#ifdef LODEPNG_COMPILE_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+/*SSE2 is part of every x86-64 CPU. The SSSE3, AVX2 and PCLMUL functions are compiled for those instruction sets
+explicitly (LODEPNG_TARGET_...) and only called after the CPU was checked for them.*/
+#define LODEPNG_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif /*_MSC_VER*/
+#if defined(__GNUC__) || defined(__clang__)
+#define LODEPNG_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define LODEPNG_TARGET_AVX2 __attribute__((target("avx2")))
+#define LODEPNG_TARGET_PCLMUL __attribute__((target("pclmul")))
+#else /*Visual Studio compiles all instruction sets without flags*/
+#define LODEPNG_TARGET_SSSE3
+#define LODEPNG_TARGET_AVX2
+#define LODEPNG_TARGET_PCLMUL
+#endif
+#endif /*SSE2*/
+#endif /*LODEPNG_COMPILE_SIMD*/
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
 #endif /*_MSC_VER */
 
+/*for the small functions in the inner decoding loops; inline is not available in C90*/
+#if defined(__GNUC__) || defined(__clang__)
+#define LODEPNG_INLINE __inline__ __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define LODEPNG_INLINE __forceinline
+#else
+#define LODEPNG_INLINE
+#endif
+
 const char* LODEPNG_VERSION_STRING = "20160124";
 
 /*
@@ -251,6 +289,16 @@ static void ucvector_init(ucvector* p)
   p->data = NULL;
   p->size = p->allocsize = 0;
 }
+
+#ifdef LODEPNG_COMPILE_DECODER
+/*empty vector in a buffer of allocsize bytes from lodepng_malloc, e.g. from a LodePNGDecodeArena*/
+static void ucvector_init_reuse(ucvector* p, unsigned char* buffer, size_t allocsize)
+{
+  p->data = buffer;
+  p->size = 0;
+  p->allocsize = buffer ? allocsize : 0;
+}
+#endif /*LODEPNG_COMPILE_DECODER*/
 #endif /*LODEPNG_COMPILE_PNG*/
 
 #ifdef LODEPNG_COMPILE_ZLIB
@@ -344,6 +392,105 @@ static void lodepng_add32bitInt(ucvector* buffer, unsigned value)
 }
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
+#if (defined(LODEPNG_COMPILE_ZLIB) && defined(LODEPNG_COMPILE_DECODER)) || defined(LODEPNG_COMPILE_PNG)
+/*
+Word-at-a-time bit reader. The next input bits are kept in a 64-bit buffer that is refilled with whole
+8-byte loads, so reading a few bits is a shift and a mask instead of a shift per bit. Deflate packs bits
+starting at the lsb of each byte (readBits), sub-byte PNG pixels start at the msb (readBitsReversed); a
+reader is used with one of the two orders only.
+Past the end of the data, zeros are read. Instead of a bounds check per bit, callers compare bp with bitsize
+once per symbol, header or row: bp past bitsize means the input ended too early.
+*/
+typedef struct LodePNGBitReader
+{
+  const unsigned char* data;
+  size_t size; /*size of data in bytes*/
+  size_t bitsize; /*size of data in bits*/
+  size_t bp; /*position of the next bit to read, the first bit in buffer*/
+  unsigned long long buffer; /*the next bits of the input*/
+  unsigned numbits; /*number of valid bits in buffer*/
+} LodePNGBitReader;
+
+static void LodePNGBitReader_init(LodePNGBitReader* reader, const unsigned char* data, size_t size)
+{
+  reader->data = data;
+  reader->size = size;
+  reader->bitsize = size * 8;
+  reader->bp = 0;
+  reader->buffer = 0;
+  reader->numbits = 0;
+}
+
+#if defined(LODEPNG_COMPILE_ZLIB) && defined(LODEPNG_COMPILE_DECODER)
+/*continues reading at bit position bp, used by inflate to skip data that is not read through the reader*/
+static void LodePNGBitReader_seek(LodePNGBitReader* reader, size_t bp)
+{
+  reader->bp = bp;
+  reader->numbits = 0;
+}
+#endif /*defined(LODEPNG_COMPILE_ZLIB) && defined(LODEPNG_COMPILE_DECODER)*/
+#endif /*(defined(LODEPNG_COMPILE_ZLIB) && defined(LODEPNG_COMPILE_DECODER)) || defined(LODEPNG_COMPILE_PNG)*/
+
+#ifdef LODEPNG_SIMD_X86
+/*which of the instruction sets the kernels use beyond SSE2 the CPU has (PCLMULQDQ is carry-less multiplication)*/
+static void detectCpuFeatures(int* ssse3, int* avx2, int* pclmul)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  int maxleaf;
+  __cpuid(info, 0);
+  maxleaf = info[0];
+  __cpuid(info, 1);
+  *ssse3 = (info[2] >> 9) & 1;
+  *pclmul = (info[2] >> 1) & 1;
+  *avx2 = 0;
+  /*AVX2 also needs the OS to save the ymm registers (OSXSAVE and AVX set, XCR0 has the sse and avx state)*/
+  if(maxleaf >= 7 && ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6)
+  {
+    __cpuidex(info, 7, 0);
+    *avx2 = (info[1] >> 5) & 1;
+  }
+#else
+  __builtin_cpu_init();
+  *ssse3 = __builtin_cpu_supports("ssse3") != 0;
+  *avx2 = __builtin_cpu_supports("avx2") != 0; /*includes the check for OS support*/
+  *pclmul = __builtin_cpu_supports("pclmul") != 0;
+#endif
+}
+
+#define CPU_SSSE3 1
+#define CPU_AVX2 2
+#define CPU_PCLMUL 4
+#define CPU_DETECTED 8
+
+/*CPU_ flags of this CPU, 0 until detected. Decoding threads may detect at the same time: they store the same
+value, through atomic accesses so that this is not a data race*/
+static int cpuFeatures = 0;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+/*aligned int loads and stores are atomic on x86, volatile keeps them single accesses*/
+#define CPU_FEATURES_LOAD() (*(volatile int*)&cpuFeatures)
+#define CPU_FEATURES_STORE(value) (*(volatile int*)&cpuFeatures = (value))
+#else
+#define CPU_FEATURES_LOAD() __atomic_load_n(&cpuFeatures, __ATOMIC_RELAXED)
+#define CPU_FEATURES_STORE(value) __atomic_store_n(&cpuFeatures, (value), __ATOMIC_RELAXED)
+#endif
+
+/*the kernels look this up on each call instead of caching a pointer of their own*/
+static int getCpuFeatures(void)
+{
+  int features = CPU_FEATURES_LOAD();
+  if(!features)
+  {
+    int ssse3, avx2, pclmul;
+    detectCpuFeatures(&ssse3, &avx2, &pclmul);
+    features = CPU_DETECTED | (ssse3 ? CPU_SSSE3 : 0) | (avx2 ? CPU_AVX2 : 0) | (pclmul ? CPU_PCLMUL : 0);
+    CPU_FEATURES_STORE(features);
+  }
+  return features;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / File IO                                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -423,23 +570,62 @@ static void addBitsToStreamReversed(size_t* bitpointer, ucvector* bitstream, uns
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-#define READBIT(bitpointer, bitstream) ((bitstream[bitpointer >> 3] >> (bitpointer & 0x7)) & (unsigned char)1)
-
-static unsigned char readBitFromStream(size_t* bitpointer, const unsigned char* bitstream)
+/*
+Returns the input bits from bit position bp on, lsb first. Whole bytes are loaded, so at least 56 of the
+bits are valid. Takes the reader fields by value so that the reader itself can stay in registers.
+*/
+static unsigned long long loadBits(const unsigned char* data, size_t size, size_t bp)
 {
-  unsigned char result = (unsigned char)(READBIT(*bitpointer, bitstream));
-  ++(*bitpointer);
-  return result;
+  size_t p = bp >> 3;
+  unsigned long long result = 0;
+  if(p + 8 <= size)
+  {
+    /*written with a plain pointer so that compilers merge it into a single load on little endian CPUs*/
+    const unsigned char* bytes = &data[p];
+    result = (unsigned long long)bytes[0] | ((unsigned long long)bytes[1] << 8)
+           | ((unsigned long long)bytes[2] << 16) | ((unsigned long long)bytes[3] << 24)
+           | ((unsigned long long)bytes[4] << 32) | ((unsigned long long)bytes[5] << 40)
+           | ((unsigned long long)bytes[6] << 48) | ((unsigned long long)bytes[7] << 56);
+  }
+  else
+  {
+    unsigned i;
+    for(i = 0; i != 8 && p + i < size; ++i) result |= (unsigned long long)data[p + i] << (8 * i);
+  }
+  return result >> (bp & 7);
 }
 
-static unsigned readBitsFromStream(size_t* bitpointer, const unsigned char* bitstream, size_t nbits)
+/*makes sure that at least nbits bits are in the buffer, nbits must be <= 56*/
+static LODEPNG_INLINE void ensureBits(LodePNGBitReader* reader, unsigned nbits)
 {
-  unsigned result = 0, i;
-  for(i = 0; i != nbits; ++i)
+  if(reader->numbits < nbits)
   {
-    result += ((unsigned)READBIT(*bitpointer, bitstream)) << i;
-    ++(*bitpointer);
+    reader->buffer = loadBits(reader->data, reader->size, reader->bp);
+    reader->numbits = 64 - (unsigned)(reader->bp & 7);
   }
+}
+
+/*returns the next nbits bits without consuming them, the buffer must have them (see ensureBits), nbits < 32*/
+static LODEPNG_INLINE unsigned peekBits(const LodePNGBitReader* reader, unsigned nbits)
+{
+  return (unsigned)reader->buffer & ((1u << nbits) - 1u);
+}
+
+/*consumes nbits bits of the buffer*/
+static LODEPNG_INLINE void advanceBits(LodePNGBitReader* reader, unsigned nbits)
+{
+  reader->buffer >>= nbits;
+  reader->numbits -= nbits;
+  reader->bp += nbits;
+}
+
+/*reads nbits bits, nbits must be < 32*/
+static LODEPNG_INLINE unsigned readBits(LodePNGBitReader* reader, unsigned nbits)
+{
+  unsigned result;
+  ensureBits(reader, nbits);
+  result = peekBits(reader, nbits);
+  advanceBits(reader, nbits);
   return result;
 }
 #endif /*LODEPNG_COMPILE_DECODER*/
@@ -456,6 +642,8 @@ static unsigned readBitsFromStream(size_t* bitpointer, const unsigned char* bits
 #define NUM_DISTANCE_SYMBOLS 32
 /*the code length codes. 0-15: code lengths, 16: copy previous 3-6 times, 17: 3-10 zeros, 18: 11-138 zeros*/
 #define NUM_CODE_LENGTH_CODES 19
+/*the longest length/distance match*/
+#define MAX_MATCH_LENGTH 258
 
 /*the base lengths represented by codes 257-285*/
 static const unsigned LENGTHBASE[29]
@@ -489,11 +677,13 @@ Huffman tree struct, containing multiple representations of the tree
 */
 typedef struct HuffmanTree
 {
-  unsigned* tree2d;
   unsigned* tree1d;
   unsigned* lengths; /*the lengths of the codes of the 1d-tree*/
   unsigned maxbitlen; /*maximum number of bits a single code can get*/
   unsigned numcodes; /*number of symbols in the alphabet = number of codes*/
+  /*the lookup tables of the decoder, see HuffmanTree_makeTable*/
+  unsigned char* table_len; /*code length of the entry, or the subtable bits for root entries of long codes*/
+  unsigned short* table_value; /*symbol of the entry, or the subtable position for root entries of long codes*/
 } HuffmanTree;
 
 /*function used for debug purposes to draw the tree in ascii art with C++*/
@@ -511,74 +701,123 @@ static void HuffmanTree_draw(HuffmanTree* tree)
 
 static void HuffmanTree_init(HuffmanTree* tree)
 {
-  tree->tree2d = 0;
   tree->tree1d = 0;
   tree->lengths = 0;
+  tree->table_len = 0;
+  tree->table_value = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree)
 {
-  lodepng_free(tree->tree2d);
   lodepng_free(tree->tree1d);
   lodepng_free(tree->lengths);
+  lodepng_free(tree->table_len);
+  lodepng_free(tree->table_value);
+}
+
+/*
+The decoder looks codes up in tables instead of walking the tree bit by bit. The root table is indexed by the
+next FIRSTBITS input bits and decodes all codes of at most FIRSTBITS bits in one step. The root entries of
+longer codes point to a subtable that is indexed by the bits after the first FIRSTBITS.
+*/
+#define FIRSTBITS 9u
+/*table_len of entries that no code maps to (incomplete trees)*/
+#define INVALIDLENGTH 16u
+
+static unsigned reverseBits(unsigned bits, unsigned num)
+{
+  unsigned i, result = 0;
+  for(i = 0; i < num; ++i) result |= ((bits >> (num - i - 1u)) & 1u) << i;
+  return result;
 }
 
-/*the tree representation used by the decoder. return value is error*/
-static unsigned HuffmanTree_make2DTree(HuffmanTree* tree)
+/*
+Makes the lookup tables from tree1d and lengths. Deflate stores codes starting with their most significant
+bit while the input is read from the lsb, so the tables are indexed by the bit-reversed codes. A code shorter
+than its table fills every entry that starts with it. return value is error.
+*/
+static unsigned HuffmanTree_makeTable(HuffmanTree* tree)
 {
-  unsigned nodefilled = 0; /*up to which node it is filled*/
-  unsigned treepos = 0; /*position in the tree (1 of the numcodes columns)*/
-  unsigned n, i;
+  static const unsigned headsize = 1u << FIRSTBITS;
+  static const unsigned mask = (1u << FIRSTBITS) - 1u;
+  unsigned maxlens[1u << FIRSTBITS]; /*longest code per root entry, for the subtable sizes*/
+  unsigned kraft = 0; /*sum of 2^(15 - length), more than 2^15 means oversubscribed*/
+  size_t size, pointer;
+  unsigned i, j;
 
-  tree->tree2d = (unsigned*)lodepng_malloc(tree->numcodes * 2 * sizeof(unsigned));
-  if(!tree->tree2d) return 83; /*alloc fail*/
+  for(i = 0; i != tree->numcodes; ++i)
+  {
+    if(tree->lengths[i] > 15) return 55; /*oversubscribed, see comment in lodepng_error_text*/
+    if(tree->lengths[i] != 0) kraft += 1u << (15 - tree->lengths[i]);
+  }
+  if(kraft > 32768) return 55; /*oversubscribed: the canonical codes would not fit in their lengths*/
 
-  /*
-  convert tree1d[] to tree2d[][]. In the 2D array, a value of 32767 means
-  uninited, a value >= numcodes is an address to another bit, a value < numcodes
-  is a code. The 2 rows are the 2 possible bit values (0 or 1), there are as
-  many columns as codes - 1.
-  A good huffman tree has N * 2 - 1 nodes, of which N - 1 are internal nodes.
-  Here, the internal nodes are stored (what their 0 and 1 option point to).
-  There is only memory for such good tree currently, if there are more nodes
-  (due to too long length codes), error 55 will happen
-  */
-  for(n = 0; n < tree->numcodes * 2; ++n)
+  for(i = 0; i != headsize; ++i) maxlens[i] = 0;
+  for(i = 0; i != tree->numcodes; ++i)
+  {
+    unsigned l = tree->lengths[i];
+    unsigned index;
+    if(l <= FIRSTBITS) continue;
+    index = reverseBits(tree->tree1d[i] >> (l - FIRSTBITS), FIRSTBITS);
+    if(l > maxlens[index]) maxlens[index] = l;
+  }
+
+  size = headsize;
+  for(i = 0; i != headsize; ++i)
   {
-    tree->tree2d[n] = 32767; /*32767 here means the tree2d isn't filled there yet*/
+    if(maxlens[i] > FIRSTBITS) size += (size_t)1u << (maxlens[i] - FIRSTBITS);
   }
 
-  for(n = 0; n < tree->numcodes; ++n) /*the codes*/
+  tree->table_len = (unsigned char*)lodepng_malloc(size * sizeof(*tree->table_len));
+  tree->table_value = (unsigned short*)lodepng_malloc(size * sizeof(*tree->table_value));
+  if(!tree->table_len || !tree->table_value) return 83; /*alloc fail*/
+
+  for(i = 0; i != size; ++i)
+  {
+    tree->table_len[i] = INVALIDLENGTH;
+    tree->table_value[i] = 0;
+  }
+
+  pointer = headsize;
+  for(i = 0; i != headsize; ++i)
   {
-    for(i = 0; i != tree->lengths[n]; ++i) /*the bits for this code*/
+    if(maxlens[i] <= FIRSTBITS) continue;
+    tree->table_len[i] = maxlens[i];
+    tree->table_value[i] = (unsigned short)pointer;
+    pointer += (size_t)1u << (maxlens[i] - FIRSTBITS);
+  }
+
+  for(i = 0; i != tree->numcodes; ++i)
+  {
+    unsigned l = tree->lengths[i];
+    unsigned reverse, num;
+    if(l == 0) continue;
+    reverse = reverseBits(tree->tree1d[i], l);
+    if(l <= FIRSTBITS)
     {
-      unsigned char bit = (unsigned char)((tree->tree1d[n] >> (tree->lengths[n] - i - 1)) & 1);
-      /*oversubscribed, see comment in lodepng_error_text*/
-      if(treepos > 2147483647 || treepos + 2 > tree->numcodes) return 55;
-      if(tree->tree2d[2 * treepos + bit] == 32767) /*not yet filled in*/
+      num = 1u << (FIRSTBITS - l);
+      for(j = 0; j != num; ++j)
       {
-        if(i + 1 == tree->lengths[n]) /*last bit*/
-        {
-          tree->tree2d[2 * treepos + bit] = n; /*put the current code in it*/
-          treepos = 0;
-        }
-        else
-        {
-          /*put address of the next step in here, first that address has to be found of course
-          (it's just nodefilled + 1)...*/
-          ++nodefilled;
-          /*addresses encoded with numcodes added to it*/
-          tree->tree2d[2 * treepos + bit] = nodefilled + tree->numcodes;
-          treepos = nodefilled;
-        }
+        unsigned index = reverse | (j << l);
+        tree->table_len[index] = l;
+        tree->table_value[index] = i;
+      }
+    }
+    else
+    {
+      /*the root entry of this code already points to its subtable*/
+      unsigned root = reverse & mask;
+      unsigned subbits = tree->table_len[root] - FIRSTBITS;
+      unsigned start = tree->table_value[root];
+      unsigned rest = l - FIRSTBITS;
+      num = 1u << (subbits - rest);
+      for(j = 0; j != num; ++j)
+      {
+        unsigned index = start + ((reverse >> FIRSTBITS) | (j << rest));
+        tree->table_len[index] = l;
+        tree->table_value[index] = i;
       }
-      else treepos = tree->tree2d[2 * treepos + bit] - tree->numcodes;
     }
-  }
-
-  for(n = 0; n < tree->numcodes * 2; ++n)
-  {
-    if(tree->tree2d[n] == 32767) tree->tree2d[n] = 0; /*remove possible remaining 32767's*/
   }
 
   return 0;
@@ -625,7 +864,7 @@ static unsigned HuffmanTree_makeFromLengths2(HuffmanTree* tree)
   uivector_cleanup(&blcount);
   uivector_cleanup(&nextcode);
 
-  if(!error) return HuffmanTree_make2DTree(tree);
+  if(!error) return HuffmanTree_makeTable(tree);
   else return error;
 }
 
@@ -905,27 +1144,39 @@ static unsigned generateFixedDistanceTree(HuffmanTree* tree)
 #ifdef LODEPNG_COMPILE_DECODER
 
 /*
-returns the code, or (unsigned)(-1) if error happened
-inbitlength is the length of the complete buffer, in bits (so its byte length times 8)
+Decodes the symbol at the start of bits (the next input bits, lsb first, at least 15 of them valid).
+Returns the symbol and sets *length to its code length, or returns (unsigned)(-1) if no code matches.
 */
-static unsigned huffmanDecodeSymbol(const unsigned char* in, size_t* bp,
-                                    const HuffmanTree* codetree, size_t inbitlength)
+static LODEPNG_INLINE unsigned huffmanDecodeBits(unsigned long long bits, unsigned* length, const HuffmanTree* codetree)
 {
-  unsigned treepos = 0, ct;
-  for(;;)
+  unsigned index = (unsigned)bits & ((1u << FIRSTBITS) - 1u);
+  unsigned l = codetree->table_len[index];
+  unsigned value = codetree->table_value[index];
+  if(l <= FIRSTBITS)
   {
-    if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
-    /*
-    decode the symbol from the tree. The "readBitFromStream" code is inlined in
-    the expression below because this is the biggest bottleneck while decoding
-    */
-    ct = codetree->tree2d[(treepos << 1) + READBIT(*bp, in)];
-    ++(*bp);
-    if(ct < codetree->numcodes) return ct; /*the symbol is decoded, return it*/
-    else treepos = ct - codetree->numcodes; /*symbol not yet decoded, instead move tree position*/
-
-    if(treepos >= codetree->numcodes) return (unsigned)(-1); /*error: it appeared outside the codetree*/
+    *length = l;
+    return value;
   }
+  if(l == INVALIDLENGTH) return (unsigned)(-1); /*error: no code starts with these bits*/
+
+  /*long code: look up the remaining bits in the subtable of the root entry*/
+  index = value + ((unsigned)(bits >> FIRSTBITS) & ((1u << (l - FIRSTBITS)) - 1u));
+  l = codetree->table_len[index];
+  if(l == INVALIDLENGTH) return (unsigned)(-1);
+  *length = l;
+  return codetree->table_value[index];
+}
+
+/*
+returns the code, or (unsigned)(-1) if no code matches. The buffer of the reader must hold the longest code
+of the tree (see ensureBits), the caller checks reader->bp against the input size.
+*/
+static unsigned huffmanDecodeSymbol(LodePNGBitReader* reader, const HuffmanTree* codetree)
+{
+  unsigned length;
+  unsigned code = huffmanDecodeBits(reader->buffer, &length, codetree);
+  if(code != (unsigned)(-1)) advanceBits(reader, length);
+  return code;
 }
 #endif /*LODEPNG_COMPILE_DECODER*/
 
@@ -945,12 +1196,11 @@ static void getTreeInflateFixed(HuffmanTree* tree_ll, HuffmanTree* tree_d)
 
 /*get the tree of a deflated block with dynamic tree, the tree itself is also Huffman compressed with a known tree*/
 static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
-                                      const unsigned char* in, size_t* bp, size_t inlength)
+                                      LodePNGBitReader* reader)
 {
   /*make sure that length values that aren't filled in will be 0, or a wrong tree will be generated*/
   unsigned error = 0;
   unsigned n, HLIT, HDIST, HCLEN, i;
-  size_t inbitlength = inlength * 8;
 
   /*see comments in deflateDynamic for explanation of the context and these variables, it is analogous*/
   unsigned* bitlen_ll = 0; /*lit,len code lengths*/
@@ -959,16 +1209,16 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   unsigned* bitlen_cl = 0;
   HuffmanTree tree_cl; /*the code tree for code length codes (the huffman tree for compressed huffman trees)*/
 
-  if((*bp) + 14 > (inlength << 3)) return 49; /*error: the bit pointer is or will go past the memory*/
+  if(reader->bp + 14 > reader->bitsize) return 49; /*error: the bit pointer is or will go past the memory*/
 
   /*number of literal/length codes + 257. Unlike the spec, the value 257 is added to it here already*/
-  HLIT =  readBitsFromStream(bp, in, 5) + 257;
+  HLIT =  readBits(reader, 5) + 257;
   /*number of distance codes. Unlike the spec, the value 1 is added to it here already*/
-  HDIST = readBitsFromStream(bp, in, 5) + 1;
+  HDIST = readBits(reader, 5) + 1;
   /*number of code length codes. Unlike the spec, the value 4 is added to it here already*/
-  HCLEN = readBitsFromStream(bp, in, 4) + 4;
+  HCLEN = readBits(reader, 4) + 4;
 
-  if((*bp) + HCLEN * 3 > (inlength << 3)) return 50; /*error: the bit pointer is or will go past the memory*/
+  if(reader->bp + HCLEN * 3 > reader->bitsize) return 50; /*error: the bit pointer is or will go past the memory*/
 
   HuffmanTree_init(&tree_cl);
 
@@ -981,7 +1231,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 
     for(i = 0; i != NUM_CODE_LENGTH_CODES; ++i)
     {
-      if(i < HCLEN) bitlen_cl[CLCL_ORDER[i]] = readBitsFromStream(bp, in, 3);
+      if(i < HCLEN) bitlen_cl[CLCL_ORDER[i]] = readBits(reader, 3);
       else bitlen_cl[CLCL_ORDER[i]] = 0; /*if not, it must stay 0*/
     }
 
@@ -999,7 +1249,10 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
     i = 0;
     while(i < HLIT + HDIST)
     {
-      unsigned code = huffmanDecodeSymbol(in, bp, &tree_cl, inbitlength);
+      unsigned code;
+      /*enough bits for the longest code length code and its extra bits (7+7), checked against the size below*/
+      ensureBits(reader, 14);
+      code = huffmanDecodeSymbol(reader, &tree_cl);
       if(code <= 15) /*a length code*/
       {
         if(i < HLIT) bitlen_ll[i] = code;
@@ -1013,8 +1266,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 
         if(i == 0) ERROR_BREAK(54); /*can't repeat previous if i is 0*/
 
-        if((*bp + 2) > inbitlength) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
-        replength += readBitsFromStream(bp, in, 2);
+        replength += readBits(reader, 2);
 
         if(i < HLIT + 1) value = bitlen_ll[i - 1];
         else value = bitlen_d[i - HLIT - 1];
@@ -1030,8 +1282,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
       else if(code == 17) /*repeat "0" 3-10 times*/
       {
         unsigned replength = 3; /*read in the bits that indicate repeat length*/
-        if((*bp + 3) > inbitlength) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
-        replength += readBitsFromStream(bp, in, 3);
+        replength += readBits(reader, 3);
 
         /*repeat this value in the next lengths*/
         for(n = 0; n < replength; ++n)
@@ -1046,8 +1297,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
       else if(code == 18) /*repeat "0" 11-138 times*/
       {
         unsigned replength = 11; /*read in the bits that indicate repeat length*/
-        if((*bp + 7) > inbitlength) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
-        replength += readBitsFromStream(bp, in, 7);
+        replength += readBits(reader, 7);
 
         /*repeat this value in the next lengths*/
         for(n = 0; n < replength; ++n)
@@ -1063,13 +1313,13 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
       {
         if(code == (unsigned)(-1))
         {
-          /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
-          (10=no endcode, 11=wrong jump outside of tree)*/
-          error = (*bp) > inbitlength ? 10 : 11;
+          /*return error code 10 or 11 depending on whether the input ended (10=no endcode, 11=invalid code)*/
+          error = reader->bp >= reader->bitsize ? 10 : 11;
         }
         else error = 16; /*unexisting code, this can never happen*/
         break;
       }
+      if(reader->bp > reader->bitsize) ERROR_BREAK(50); /*error, bit pointer jumped past memory*/
     }
     if(error) break;
 
@@ -1091,29 +1341,110 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
+/*
+Lets the caller watch the output of inflate while it grows (the pipelined PNG decoder unfilters the scanlines
+that are complete). The caller reserves max_size + MAX_MATCH_LENGTH bytes of output up front, and inflate fails
+with error 91 instead of writing past max_size, so the output buffer never moves. report is called from the
+inflating thread each time at least step more bytes are decoded, and once more at the end.
+*/
+typedef struct InflateProgress
+{
+  size_t max_size; /*the predicted output size*/
+  size_t step;
+  size_t next; /*report when the output grows past this*/
+  void (*report)(void* context, size_t size);
+  void* context;
+} InflateProgress;
+
+/*lowest output size at which the progress needs attention, the fast path only compares against this*/
+static size_t inflateProgressLimit(const InflateProgress* progress)
+{
+  if(!progress) return (size_t)(-1);
+  return progress->next < progress->max_size ? progress->next : progress->max_size;
+}
+
+static unsigned updateInflateProgress(InflateProgress* progress, size_t pos)
+{
+  if(pos > progress->max_size) return 91; /*decompressed size doesn't match prediction*/
+  if(progress->report) progress->report(progress->context, pos);
+  progress->next = pos + progress->step;
+  return 0;
+}
+
+/*writes the length bytes of a match that starts distance bytes back (distance <= pos) at data[pos]*/
+static LODEPNG_INLINE void copyMatch(unsigned char* data, size_t pos, size_t distance, size_t length)
+{
+  size_t forward;
+  if(distance == 1)
+  {
+    memset(data + pos, data[pos - 1], length);
+  }
+  else if(distance < length)
+  {
+    /*the match repeats the last distance bytes: copy them once, then keep doubling the copied part*/
+    memcpy(data + pos, data + pos - distance, distance);
+    for(forward = distance; forward < length; forward += forward)
+    {
+      size_t count = length - forward < forward ? length - forward : forward;
+      memcpy(data + pos + forward, data + pos, count);
+    }
+  }
+  else
+  {
+    memcpy(data + pos, data + pos - distance, length);
+  }
+}
+
 /*inflate a block with dynamic of fixed Huffman tree*/
-static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size_t* bp,
-                                    size_t* pos, size_t inlength, unsigned btype)
+static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* blockreader, size_t* pos, unsigned btype,
+                                    InflateProgress* progress)
 {
   unsigned error = 0;
+  size_t limit = inflateProgressLimit(progress);
+  /*
+  the symbols are read with a local copy of the reader: bytes written to out->data may alias anything, so
+  through the pointer the bit buffer would be stored and loaded again around every output byte
+  */
+  LodePNGBitReader reader;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
-  size_t inbitlength = inlength * 8;
 
   HuffmanTree_init(&tree_ll);
   HuffmanTree_init(&tree_d);
 
   if(btype == 1) getTreeInflateFixed(&tree_ll, &tree_d);
-  else if(btype == 2) error = getTreeInflateDynamic(&tree_ll, &tree_d, in, bp, inlength);
+  else if(btype == 2) error = getTreeInflateDynamic(&tree_ll, &tree_d, blockreader);
+  reader = *blockreader;
 
   while(!error) /*decode all symbols until end reached, breaks at end code*/
   {
-    /*code_ll is literal, length or end code*/
-    unsigned code_ll = huffmanDecodeSymbol(in, bp, &tree_ll, inbitlength);
+    unsigned numbits;
+    unsigned code_ll; /*code_ll is literal, length or end code*/
+    if(*pos > limit)
+    {
+      error = updateInflateProgress(progress, *pos);
+      if(error) break;
+      limit = inflateProgressLimit(progress);
+    }
+    /*
+    enough bits for a whole length/distance pair: the longest length code with its extra bits and the
+    longest distance code with its extra bits (15+5+15+13). The input size is checked once per symbol.
+    */
+    ensureBits(&reader, 48);
+    code_ll = huffmanDecodeBits(reader.buffer, &numbits, &tree_ll);
+    if(code_ll == (unsigned)(-1))
+    {
+      /*return error code 10 or 11 depending on whether the input ended (10=no endcode, 11=invalid code)*/
+      error = reader.bp >= reader.bitsize ? 10 : 11;
+      break;
+    }
+    advanceBits(&reader, numbits);
+    if(reader.bp > reader.bitsize) ERROR_BREAK(10); /*error: end of input memory reached without endcode*/
+
     if(code_ll <= 255) /*literal symbol*/
     {
-      /*ucvector_push_back would do the same, but for some reason the two lines below run 10% faster*/
-      if(!ucvector_resize(out, (*pos) + 1)) ERROR_BREAK(83 /*alloc fail*/);
+      /*the buffer grows by whole matches (see below), so usually there is room already*/
+      if(!ucvector_reserve(out, (*pos) + MAX_MATCH_LENGTH)) ERROR_BREAK(83 /*alloc fail*/);
       out->data[*pos] = (unsigned char)code_ll;
       ++(*pos);
     }
@@ -1121,126 +1452,125 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
     {
       unsigned code_d, distance;
       unsigned numextrabits_l, numextrabits_d; /*extra bits for length and distance*/
-      size_t start, forward, backward, length;
+      size_t start, length;
 
       /*part 1: get length base*/
       length = LENGTHBASE[code_ll - FIRST_LENGTH_CODE_INDEX];
 
       /*part 2: get extra bits and add the value of that to length*/
       numextrabits_l = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
-      if((*bp + numextrabits_l) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      length += readBitsFromStream(bp, in, numextrabits_l);
+      length += peekBits(&reader, numextrabits_l);
+      advanceBits(&reader, numextrabits_l);
 
       /*part 3: get distance code*/
-      code_d = huffmanDecodeSymbol(in, bp, &tree_d, inbitlength);
+      code_d = huffmanDecodeBits(reader.buffer, &numbits, &tree_d);
       if(code_d > 29)
       {
-        if(code_ll == (unsigned)(-1)) /*huffmanDecodeSymbol returns (unsigned)(-1) in case of error*/
+        if(code_d == (unsigned)(-1)) /*huffmanDecodeBits returns (unsigned)(-1) in case of error*/
         {
-          /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
-          (10=no endcode, 11=wrong jump outside of tree)*/
-          error = (*bp) > inlength * 8 ? 10 : 11;
+          /*return error code 10 or 11 depending on whether the input ended (10=no endcode, 11=invalid code)*/
+          error = reader.bp >= reader.bitsize ? 10 : 11;
         }
         else error = 18; /*error: invalid distance code (30-31 are never used)*/
         break;
       }
+      advanceBits(&reader, numbits);
       distance = DISTANCEBASE[code_d];
 
       /*part 4: get extra bits from distance*/
       numextrabits_d = DISTANCEEXTRA[code_d];
-      if((*bp + numextrabits_d) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      distance += readBitsFromStream(bp, in, numextrabits_d);
+      distance += peekBits(&reader, numextrabits_d);
+      advanceBits(&reader, numextrabits_d);
+      if(reader.bp > reader.bitsize) ERROR_BREAK(51); /*error, bit pointer jumped past memory*/
 
       /*part 5: fill in all the out[n] values based on the length and dist*/
       start = (*pos);
       if(distance > start) ERROR_BREAK(52); /*too long backward distance*/
-      backward = start - distance;
 
-      if(!ucvector_resize(out, (*pos) + length)) ERROR_BREAK(83 /*alloc fail*/);
-      if (distance < length) {
-        for(forward = 0; forward < length; ++forward)
-        {
-          out->data[(*pos)++] = out->data[backward++];
-        }
-      } else {
-        memcpy(out->data + *pos, out->data + backward, length);
-        *pos += length;
-      }
+      if(!ucvector_reserve(out, (*pos) + MAX_MATCH_LENGTH)) ERROR_BREAK(83 /*alloc fail*/);
+      copyMatch(out->data, start, distance, length);
+      *pos += length;
     }
     else if(code_ll == 256)
     {
       break; /*end code, break the loop*/
     }
-    else /*if(code == (unsigned)(-1))*/ /*huffmanDecodeSymbol returns (unsigned)(-1) in case of error*/
+    else /*code 286 or 287, these are never used*/
     {
-      /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
-      (10=no endcode, 11=wrong jump outside of tree)*/
-      error = ((*bp) > inlength * 8) ? 10 : 11;
+      error = 11;
       break;
     }
   }
 
+  /*the loop writes into the reserved space past out->size, only pos counts the decoded bytes*/
+  out->size = *pos;
+  *blockreader = reader;
+
   HuffmanTree_cleanup(&tree_ll);
   HuffmanTree_cleanup(&tree_d);
 
   return error;
 }
 
-static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, size_t* bp, size_t* pos, size_t inlength)
+static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader, size_t* pos,
+                                     InflateProgress* progress)
 {
   size_t p;
-  unsigned LEN, NLEN, n, error = 0;
+  unsigned LEN, NLEN;
 
   /*go to first boundary of byte*/
-  while(((*bp) & 0x7) != 0) ++(*bp);
-  p = (*bp) / 8; /*byte position*/
+  p = (reader->bp + 7) >> 3; /*byte position*/
 
   /*read LEN (2 bytes) and NLEN (2 bytes)*/
-  if(p + 4 >= inlength) return 52; /*error, bit pointer will jump past memory*/
-  LEN = in[p] + 256u * in[p + 1]; p += 2;
-  NLEN = in[p] + 256u * in[p + 1]; p += 2;
+  if(p + 4 >= reader->size) return 52; /*error, bit pointer will jump past memory*/
+  LEN = reader->data[p] + 256u * reader->data[p + 1]; p += 2;
+  NLEN = reader->data[p] + 256u * reader->data[p + 1]; p += 2;
 
   /*check if 16-bit NLEN is really the one's complement of LEN*/
   if(LEN + NLEN != 65535) return 21; /*error: NLEN is not one's complement of LEN*/
+  if(progress && (*pos) + LEN > progress->max_size) return 91; /*decompressed size doesn't match prediction*/
 
   if(!ucvector_resize(out, (*pos) + LEN)) return 83; /*alloc fail*/
 
   /*read the literal data: LEN bytes are now stored in the out buffer*/
-  if(p + LEN > inlength) return 23; /*error: reading outside of in buffer*/
-  for(n = 0; n < LEN; ++n) out->data[(*pos)++] = in[p++];
+  if(p + LEN > reader->size) return 23; /*error: reading outside of in buffer*/
+  if(LEN != 0) memcpy(out->data + *pos, reader->data + p, LEN);
+  *pos += LEN;
+  if(progress && *pos > progress->next) updateInflateProgress(progress, *pos);
 
-  (*bp) = p * 8;
+  LodePNGBitReader_seek(reader, (p + LEN) * 8);
 
-  return error;
+  return 0;
 }
 
 static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
-                                 const LodePNGDecompressSettings* settings)
+                                 const LodePNGDecompressSettings* settings, InflateProgress* progress)
 {
-  /*bit pointer in the "in" data, current byte is bp >> 3, current bit is bp & 0x7 (from lsb to msb of the byte)*/
-  size_t bp = 0;
+  LodePNGBitReader reader;
   unsigned BFINAL = 0;
   size_t pos = 0; /*byte position in the out buffer*/
   unsigned error = 0;
 
   (void)settings;
 
+  LodePNGBitReader_init(&reader, in, insize);
+
   while(!BFINAL)
   {
     unsigned BTYPE;
-    if(bp + 2 >= insize * 8) return 52; /*error, bit pointer will jump past memory*/
-    BFINAL = readBitFromStream(&bp, in);
-    BTYPE = 1u * readBitFromStream(&bp, in);
-    BTYPE += 2u * readBitFromStream(&bp, in);
+    if(reader.bp + 2 >= reader.bitsize) return 52; /*error, bit pointer will jump past memory*/
+    BFINAL = readBits(&reader, 1);
+    BTYPE = readBits(&reader, 2);
 
     if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
-    else if(BTYPE == 0) error = inflateNoCompression(out, in, &bp, &pos, insize); /*no compression*/
-    else error = inflateHuffmanBlock(out, in, &bp, &pos, insize, BTYPE); /*compression, BTYPE 01 or 10*/
+    else if(BTYPE == 0) error = inflateNoCompression(out, &reader, &pos, progress); /*no compression*/
+    else error = inflateHuffmanBlock(out, &reader, &pos, BTYPE, progress); /*compression, BTYPE 01 or 10*/
 
     if(error) return error;
   }
 
+  if(progress) error = updateInflateProgress(progress, pos);
   return error;
 }
 
@@ -1251,7 +1581,7 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
   unsigned error;
   ucvector v;
   ucvector_init_buffer(&v, *out, *outsize);
-  error = lodepng_inflatev(&v, in, insize, settings);
+  error = lodepng_inflatev(&v, in, insize, settings, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
@@ -1340,11 +1670,33 @@ typedef struct Hash
   int* headz; /*similar to head, but for chainz*/
   unsigned short* chainz; /*those with same amount of zeros*/
   unsigned short* zeros; /*length of zeros streak, used as a second hash chain*/
+
+  /*the compression levels use these instead of the above: hash to the last position with it, and position to
+  the previous one with the same hash (levels 2 to 9). Positions are indices in the input, -1 for none*/
+  int* levelhead;
+  int* levelprev;
 } Hash;
 
-static unsigned hash_init(Hash* hash, unsigned windowsize)
+/*see encodeLZ77Level*/
+#define LEVEL_HASH_BITS 15
+#define LEVEL_WINDOW 32768
+#define LEVEL_FAST_INSERT 32
+
+static unsigned hash_init(Hash* hash, unsigned windowsize, unsigned level)
 {
   unsigned i;
+  hash->head = hash->val = hash->headz = 0;
+  hash->chain = hash->chainz = hash->zeros = 0;
+  hash->levelhead = hash->levelprev = 0;
+  if(level != 0)
+  {
+    hash->levelhead = (int*)lodepng_malloc(sizeof(int) << LEVEL_HASH_BITS);
+    if(level >= 2) hash->levelprev = (int*)lodepng_malloc(sizeof(int) * LEVEL_WINDOW);
+    if(!hash->levelhead || (level >= 2 && !hash->levelprev)) return 83; /*alloc fail*/
+    for(i = 0; i != (1u << LEVEL_HASH_BITS); ++i) hash->levelhead[i] = -1;
+    return 0;
+  }
+
   hash->head = (int*)lodepng_malloc(sizeof(int) * HASH_NUM_VALUES);
   hash->val = (int*)lodepng_malloc(sizeof(int) * windowsize);
   hash->chain = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
@@ -1378,6 +1730,9 @@ static void hash_cleanup(Hash* hash)
   lodepng_free(hash->zeros);
   lodepng_free(hash->headz);
   lodepng_free(hash->chainz);
+
+  lodepng_free(hash->levelhead);
+  lodepng_free(hash->levelprev);
 }
 
 
@@ -1612,6 +1967,222 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   return error;
 }
 
+/*
+The match finder of the compression levels (LodePNGCompressSettings.level), which doesn't use the settings of
+encodeLZ77. Level 1 keeps only the last position of each hash of 4 bytes and takes the match there, if any, or
+a literal: one probe per position, and only the positions inside short matches are hashed. Levels 2 to 9 keep
+hash chains of 3-byte hashes over the whole 32 KB window, insert every position and follow a chain for at most
+a fixed number of probes. From level 4 on a match is only taken if the next position doesn't start a longer one
+(lazy matching).
+*/
+typedef struct LZ77Level
+{
+  unsigned lazy; /*look for a longer match at the next position if the match is shorter than this, 0: greedy*/
+  unsigned good; /*if the pending match is this long, follow only a quarter of the chain at the next position*/
+  unsigned nice; /*stop following the chain at a match of this length*/
+  unsigned chain; /*maximum number of positions tried*/
+} LZ77Level;
+
+static const LZ77Level LZ77_LEVELS[10] = {
+  {0, 0, 0, 0}, /*level 0 uses encodeLZ77*/
+  {0, 0, 258, 1},
+  {0, 4, 16, 8},
+  {0, 4, 32, 32},
+  {4, 4, 16, 16},
+  {16, 8, 32, 32},
+  {16, 8, 128, 128},
+  {32, 8, 128, 256},
+  {128, 32, 258, 1024},
+  {258, 32, 258, 4096}
+};
+
+static LODEPNG_INLINE unsigned levelHash(unsigned bytes)
+{
+  return ((bytes * 2654435761u) & 0xffffffffu) >> (32 - LEVEL_HASH_BITS);
+}
+
+static LODEPNG_INLINE unsigned read24(const unsigned char* data)
+{
+  return data[0] | ((unsigned)data[1] << 8) | ((unsigned)data[2] << 16);
+}
+
+/*length of the common prefix of a and b, up to end (of b), a word at a time*/
+static LODEPNG_INLINE unsigned matchLength(const unsigned char* a, const unsigned char* b, const unsigned char* end)
+{
+  const unsigned char* start = b;
+  while((size_t)(end - b) >= sizeof(size_t))
+  {
+    size_t x, y;
+    memcpy(&x, a, sizeof(size_t));
+    memcpy(&y, b, sizeof(size_t));
+    if(x != y) break;
+    a += sizeof(size_t);
+    b += sizeof(size_t);
+  }
+  while(b != end && *a == *b)
+  {
+    ++a;
+    ++b;
+  }
+  return (unsigned)(b - start);
+}
+
+/*a length 3 match far back costs about as many bits as its 3 literals, as in encodeLZ77*/
+static LODEPNG_INLINE unsigned worthMatch(unsigned length, unsigned offset)
+{
+  return length > 3 || (length == 3 && offset <= 4096);
+}
+
+static unsigned encodeLZ77Fast(uivector* out, Hash* hash, const unsigned char* in, size_t inpos, size_t insize)
+{
+  size_t pos = inpos;
+  while(pos < insize)
+  {
+    unsigned length = 0, offset = 0;
+    if(insize - pos >= 4)
+    {
+      unsigned h = levelHash(read24(&in[pos]) | ((unsigned)in[pos + 3] << 24));
+      int candidate = hash->levelhead[h];
+      hash->levelhead[h] = (int)pos;
+      if(candidate >= 0 && pos - (size_t)candidate < LEVEL_WINDOW)
+      {
+        const unsigned char* end = &in[insize - pos > MAX_SUPPORTED_DEFLATE_LENGTH ?
+                                       pos + MAX_SUPPORTED_DEFLATE_LENGTH : insize];
+        offset = (unsigned)(pos - (size_t)candidate);
+        length = matchLength(&in[candidate], &in[pos], end);
+      }
+    }
+    if(worthMatch(length, offset))
+    {
+      size_t i, end = pos + length;
+      addLengthDistance(out, length, offset);
+      /*hashing inside short matches finds much more, long ones are mostly runs*/
+      if(length <= LEVEL_FAST_INSERT)
+      {
+        for(i = pos + 1; i < end && insize - i >= 4; ++i)
+        {
+          hash->levelhead[levelHash(read24(&in[i]) | ((unsigned)in[i + 3] << 24))] = (int)i;
+        }
+      }
+      pos += length;
+    }
+    else
+    {
+      if(!uivector_push_back(out, in[pos])) return 83; /*alloc fail*/
+      ++pos;
+    }
+  }
+  return 0;
+}
+
+/*adds the position to the hash chains; the last 2 bytes of the input have no hash of 3 bytes*/
+static LODEPNG_INLINE void levelInsert(Hash* hash, const unsigned char* in, size_t pos, size_t insize)
+{
+  if(insize - pos >= 3)
+  {
+    unsigned h = levelHash(read24(&in[pos]));
+    hash->levelprev[pos & (LEVEL_WINDOW - 1)] = hash->levelhead[h];
+    hash->levelhead[h] = (int)pos;
+  }
+}
+
+/*the longest match for pos (already inserted) along its hash chain*/
+static void levelFindMatch(unsigned* length, unsigned* offset, const Hash* hash,
+                           const unsigned char* in, size_t pos, size_t insize, unsigned chain, unsigned nice)
+{
+  size_t maxlength = insize - pos > MAX_SUPPORTED_DEFLATE_LENGTH ? MAX_SUPPORTED_DEFLATE_LENGTH : insize - pos;
+  const unsigned char* end = &in[pos + maxlength];
+  int candidate = insize - pos >= 3 ? hash->levelprev[pos & (LEVEL_WINDOW - 1)] : -1;
+  unsigned best = 0;
+  *length = *offset = 0;
+  /*chain entries are older positions, unless a slot was overwritten by a position a whole window later*/
+  while(candidate >= 0 && (size_t)candidate < pos && pos - (size_t)candidate < LEVEL_WINDOW && chain-- > 0)
+  {
+    const unsigned char* match = &in[candidate];
+    /*only a candidate that also matches the byte after the best length so far can be longer*/
+    if(match[best] == in[pos + best] && match[0] == in[pos])
+    {
+      unsigned current = matchLength(match, &in[pos], end);
+      if(current > best)
+      {
+        best = current;
+        *length = current;
+        *offset = (unsigned)(pos - (size_t)candidate);
+        if(current >= nice || current == maxlength) break;
+      }
+    }
+    {
+      int next = hash->levelprev[candidate & (LEVEL_WINDOW - 1)];
+      if(next >= candidate) break;
+      candidate = next;
+    }
+  }
+}
+
+static unsigned encodeLZ77Level(uivector* out, Hash* hash, const unsigned char* in, size_t inpos, size_t insize,
+                                unsigned level)
+{
+  const LZ77Level* params = &LZ77_LEVELS[level];
+  size_t pos = inpos;
+  size_t i;
+  /*with lazy matching: the match found at pos - 1, taken if pos has no longer one*/
+  unsigned lazy = 0, lazylength = 0, lazyoffset = 0;
+
+  if(level == 1) return encodeLZ77Fast(out, hash, in, inpos, insize);
+
+  while(pos < insize)
+  {
+    unsigned length = 0, offset = 0;
+    levelInsert(hash, in, pos, insize);
+    if(!lazy || lazylength < params->lazy)
+    {
+      unsigned chain = lazy && lazylength >= params->good ? params->chain >> 2 : params->chain;
+      levelFindMatch(&length, &offset, hash, in, pos, insize, chain, params->nice);
+      if(!worthMatch(length, offset)) length = 0;
+    }
+
+    if(lazy && length <= lazylength)
+    {
+      /*the pending match from pos - 1 wins, pos is inserted already*/
+      addLengthDistance(out, lazylength, lazyoffset);
+      for(i = pos + 1; i < pos - 1 + lazylength; ++i) levelInsert(hash, in, i, insize);
+      pos += lazylength - 1;
+      lazy = 0;
+    }
+    else if(length != 0 && params->lazy != 0)
+    {
+      /*the match at pos replaces the pending one, pos - 1 becomes a literal*/
+      if(lazy && !uivector_push_back(out, in[pos - 1])) return 83; /*alloc fail*/
+      lazy = 1;
+      lazylength = length;
+      lazyoffset = offset;
+      ++pos;
+    }
+    else if(length != 0)
+    {
+      addLengthDistance(out, length, offset);
+      for(i = pos + 1; i < pos + length; ++i) levelInsert(hash, in, i, insize);
+      pos += length;
+    }
+    else
+    {
+      if(!uivector_push_back(out, in[pos])) return 83; /*alloc fail*/
+      ++pos;
+    }
+  }
+  /*a pending match always ends before insize, so it was emitted in the loop*/
+  return 0;
+}
+
+/*LZ77 with the match finder the settings ask for*/
+static unsigned encodeLZ77Settings(uivector* out, Hash* hash, const unsigned char* in, size_t inpos, size_t insize,
+                                   const LodePNGCompressSettings* settings)
+{
+  if(settings->level != 0) return encodeLZ77Level(out, hash, in, inpos, insize, settings->level);
+  return encodeLZ77(out, hash, in, inpos, insize, settings->windowsize,
+                    settings->minmatch, settings->nicematch, settings->lazymatching);
+}
+
 /* /////////////////////////////////////////////////////////////////////////// */
 
 static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize)
@@ -1746,8 +2317,7 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
   {
     if(settings->use_lz77)
     {
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
+      error = encodeLZ77Settings(&lz77_encoded, hash, data, datapos, dataend, settings);
       if(error) break;
     }
     else
@@ -1956,8 +2526,7 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
   {
     uivector lz77_encoded;
     uivector_init(&lz77_encoded);
-    error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                       settings->minmatch, settings->nicematch, settings->lazymatching);
+    error = encodeLZ77Settings(&lz77_encoded, hash, data, datapos, dataend, settings);
     if(!error) writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
     uivector_cleanup(&lz77_encoded);
   }
@@ -1978,6 +2547,16 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
   return error;
 }
 
+/*size of the dynamic deflate blocks for insize bytes of input*/
+static size_t dynamicBlockSize(size_t insize)
+{
+  /*on PNGs, deflate blocks of 65-262k seem to give most dense encoding*/
+  size_t blocksize = insize / 8 + 8;
+  if(blocksize < 65536) blocksize = 65536;
+  if(blocksize > 262144) blocksize = 262144;
+  return blocksize;
+}
+
 static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
                                  const LodePNGCompressSettings* settings)
 {
@@ -1989,19 +2568,18 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   if(settings->btype > 2) return 61;
   else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
   else if(settings->btype == 1) blocksize = insize;
-  else /*if(settings->btype == 2)*/
-  {
-    /*on PNGs, deflate blocks of 65-262k seem to give most dense encoding*/
-    blocksize = insize / 8 + 8;
-    if(blocksize < 65536) blocksize = 65536;
-    if(blocksize > 262144) blocksize = 262144;
-  }
+  else /*if(settings->btype == 2)*/ blocksize = dynamicBlockSize(insize);
 
   numdeflateblocks = (insize + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
 
-  error = hash_init(&hash, settings->windowsize);
-  if(error) return error;
+  if(settings->level > 9) return 98; /*invalid compression level*/
+  error = hash_init(&hash, settings->windowsize, settings->level);
+  if(error)
+  {
+    hash_cleanup(&hash);
+    return error;
+  }
 
   for(i = 0; i != numdeflateblocks && !error; ++i)
   {
@@ -2052,7 +2630,7 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                  */
 /* ////////////////////////////////////////////////////////////////////////// */
 
-static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len)
+static unsigned update_adler32_scalar(unsigned adler, const unsigned char* data, unsigned len)
 {
    unsigned s1 = adler & 0xffff;
    unsigned s2 = (adler >> 16) & 0xffff;
@@ -2075,6 +2653,110 @@ static unsigned update_adler32(unsigned adler, const unsigned char* data, unsign
   return (s2 << 16) | s1;
 }
 
+#ifdef LODEPNG_SIMD_X86
+/*
+SIMD Adler-32 over blocks of 32 bytes, the scalar code does the rest. Per block s1 grows by the sum of the bytes
+(sad) and s2 by 32 times s1 before the block plus the bytes weighted 32 down to 1 (maddubs). ADLER32_BLOCKS
+blocks (5536 bytes) are summed before the modulo, like the 5550 bytes of the scalar code.
+*/
+#define ADLER32_BLOCKS 173
+
+LODEPNG_TARGET_SSSE3 static unsigned update_adler32_ssse3(unsigned adler, const unsigned char* data, unsigned len)
+{
+  const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+  const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  unsigned s1 = adler & 0xffff;
+  unsigned s2 = (adler >> 16) & 0xffff;
+  unsigned blocks = len / 32;
+  len -= blocks * 32;
+
+  while(blocks > 0)
+  {
+    unsigned n = blocks > ADLER32_BLOCKS ? ADLER32_BLOCKS : blocks;
+    __m128i vs1 = zero;
+    __m128i vs2 = _mm_cvtsi32_si128((int)s2);
+    __m128i vps = _mm_cvtsi32_si128((int)(s1 * n)); /*s1 of the blocks, times 32 at the end*/
+    blocks -= n;
+    while(n > 0)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i*)data);
+      __m128i b = _mm_loadu_si128((const __m128i*)(data + 16));
+      vps = _mm_add_epi32(vps, vs1);
+      vs1 = _mm_add_epi32(vs1, _mm_add_epi32(_mm_sad_epu8(a, zero), _mm_sad_epu8(b, zero)));
+      vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(a, tap1), ones));
+      vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(b, tap2), ones));
+      data += 32;
+      --n;
+    }
+    vs2 = _mm_add_epi32(vs2, _mm_slli_epi32(vps, 5));
+    /*sad leaves its sums in lanes 0 and 2, madd in all four*/
+    vs1 = _mm_add_epi32(vs1, _mm_shuffle_epi32(vs1, _MM_SHUFFLE(1, 0, 3, 2)));
+    vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, _MM_SHUFFLE(1, 0, 3, 2)));
+    vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, _MM_SHUFFLE(2, 3, 0, 1)));
+    s1 = (s1 + (unsigned)_mm_cvtsi128_si32(vs1)) % 65521;
+    s2 = (unsigned)_mm_cvtsi128_si32(vs2) % 65521;
+  }
+
+  return update_adler32_scalar((s2 << 16) | s1, data, len);
+}
+
+LODEPNG_TARGET_AVX2 static unsigned update_adler32_avx2(unsigned adler, const unsigned char* data, unsigned len)
+{
+  const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                       16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  unsigned s1 = adler & 0xffff;
+  unsigned s2 = (adler >> 16) & 0xffff;
+  unsigned blocks = len / 32;
+  len -= blocks * 32;
+
+  while(blocks > 0)
+  {
+    unsigned n = blocks > ADLER32_BLOCKS ? ADLER32_BLOCKS : blocks;
+    __m256i vs1 = zero;
+    __m256i vs2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+    __m256i vps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+    __m128i sum1, sum2;
+    blocks -= n;
+    while(n > 0)
+    {
+      __m256i a = _mm256_loadu_si256((const __m256i*)data);
+      vps = _mm256_add_epi32(vps, vs1);
+      vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(a, zero));
+      vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(a, tap), ones));
+      data += 32;
+      --n;
+    }
+    vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vps, 5));
+    sum1 = _mm_add_epi32(_mm256_castsi256_si128(vs1), _mm256_extracti128_si256(vs1, 1));
+    sum2 = _mm_add_epi32(_mm256_castsi256_si128(vs2), _mm256_extracti128_si256(vs2, 1));
+    sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+    s1 = (s1 + (unsigned)_mm_cvtsi128_si32(sum1)) % 65521;
+    s2 = (unsigned)_mm_cvtsi128_si32(sum2) % 65521;
+  }
+
+  return update_adler32_scalar((s2 << 16) | s1, data, len);
+}
+
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len)
+{
+  int features = getCpuFeatures();
+  if(features & CPU_AVX2) return update_adler32_avx2(adler, data, len);
+  if(features & CPU_SSSE3) return update_adler32_ssse3(adler, data, len);
+  return update_adler32_scalar(adler, data, len);
+}
+#else /*LODEPNG_SIMD_X86*/
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len)
+{
+  return update_adler32_scalar(adler, data, len);
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 /*Return the adler32 of the bytes data[0..len-1]*/
 static unsigned adler32(const unsigned char* data, unsigned len)
 {
@@ -2087,10 +2769,8 @@ static unsigned adler32(const unsigned char* data, unsigned len)
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                 size_t insize, const LodePNGDecompressSettings* settings)
+static unsigned zlib_checkHeader(const unsigned char* in, size_t insize)
 {
-  unsigned error = 0;
   unsigned CM, CINFO, FDICT;
 
   if(insize < 2) return 53; /*error, size of zlib data too small*/
@@ -2119,6 +2799,15 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const uns
     return 26;
   }
 
+  return 0;
+}
+
+unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error = zlib_checkHeader(in, insize);
+  if(error) return error;
+
   error = inflate(out, outsize, in + 2, insize - 2, settings);
   if(error) return error;
 
@@ -2145,23 +2834,352 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   }
 }
 
-#endif /*LODEPNG_COMPILE_DECODER*/
-
-#ifdef LODEPNG_COMPILE_ENCODER
-
-unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                               size_t insize, const LodePNGCompressSettings* settings)
+#ifdef LODEPNG_COMPILE_PNG
+/*lodepng_zlib_decompress with the built in inflate, into a ucvector the caller has reserved*/
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in, size_t insize,
+                                 const LodePNGDecompressSettings* settings, InflateProgress* progress)
 {
-  /*initially, *out must be NULL and outsize 0, if you just give some random *out
-  that's pointing to a non allocated buffer, this'll crash*/
-  ucvector outv;
-  size_t i;
-  unsigned error;
-  unsigned char* deflatedata = 0;
-  size_t deflatesize = 0;
+  unsigned error = zlib_checkHeader(in, insize);
+  if(error) return error;
 
-  /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
-  unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
+  error = lodepng_inflatev(out, in + 2, insize - 2, settings, progress);
+  if(error) return error;
+
+  if(!settings->ignore_adler32)
+  {
+    unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
+    unsigned checksum = adler32(out->data, (unsigned)out->size);
+    if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
+  }
+
+  return 0; /*no error*/
+}
+
+/*
+Zlib decompression of data that arrives in pieces, for the streaming PNG decoder. Only the last 32 KB of output,
+the window that matches refer back to, stay in memory: the rest is passed on to the output callback as soon as it
+is decoded. A step (block header, symbol, stored bytes, checksum) is only taken once all of its input is there;
+the rest of a piece waits for the next one. Once no more input can come ("last"), missing input is an error as
+in lodepng_zlib_decompress.
+*/
+
+/*the largest match distance*/
+#define INFLATE_WINDOW_SIZE 32768u
+/*the output buffer holds the window and at least this much new output, when it is full the window moves back*/
+#define INFLATE_STREAM_OUT 32768u
+/*the input is consumed in parts of at most this size, so that the buffered input stays small*/
+#define INFLATE_STREAM_IN 16384u
+/*enough input for any block header, valid or not: 3 + 14 + 19 * 3 bits, then at most 288 + 32 code lengths
+of at most 7 + 7 bits each*/
+#define INFLATE_HEADER_BITS (3u + 14u + 19u * 3u + 320u * 14u)
+/*enough input for a literal or for a length/distance pair: 15 + 5 + 15 + 13 bits*/
+#define INFLATE_SYMBOL_BITS 48u
+
+typedef enum InflateStreamMode
+{
+  INFLATE_ZLIB_HEADER,
+  INFLATE_BLOCK_HEADER,
+  INFLATE_STORED, /*copying the bytes of a stored block*/
+  INFLATE_HUFFMAN, /*decoding the symbols of a huffman block*/
+  INFLATE_ADLER32,
+  INFLATE_DONE
+} InflateStreamMode;
+
+typedef struct InflateStream
+{
+  InflateStreamMode mode;
+  unsigned final; /*BFINAL of the current block*/
+  HuffmanTree tree_ll; /*trees of the current huffman block*/
+  HuffmanTree tree_d;
+  size_t stored; /*bytes of the current stored block still to copy*/
+  ucvector in; /*input that isn't consumed yet*/
+  size_t bp; /*bit position of the next input bit in in*/
+  unsigned char* out; /*the window, followed by the new output*/
+  size_t pos; /*bytes in out*/
+  size_t flushed; /*bytes of out already passed on*/
+  unsigned adler; /*checksum of the output passed on*/
+  const LodePNGDecompressSettings* settings;
+  /*receives the output in order, an error it returns stops the decompression*/
+  unsigned (*output)(void* context, const unsigned char* data, size_t size);
+  void* context;
+} InflateStream;
+
+static unsigned InflateStream_init(InflateStream* stream, const LodePNGDecompressSettings* settings,
+                                   unsigned (*output)(void*, const unsigned char*, size_t), void* context)
+{
+  stream->mode = INFLATE_ZLIB_HEADER;
+  stream->final = 0;
+  HuffmanTree_init(&stream->tree_ll);
+  HuffmanTree_init(&stream->tree_d);
+  stream->stored = 0;
+  ucvector_init(&stream->in);
+  stream->bp = 0;
+  stream->pos = stream->flushed = 0;
+  stream->adler = 1u;
+  stream->settings = settings;
+  stream->output = output;
+  stream->context = context;
+  stream->out = (unsigned char*)lodepng_malloc(INFLATE_WINDOW_SIZE + INFLATE_STREAM_OUT);
+  return stream->out ? 0 : 83; /*alloc fail*/
+}
+
+static void InflateStream_cleanup(InflateStream* stream)
+{
+  HuffmanTree_cleanup(&stream->tree_ll);
+  HuffmanTree_cleanup(&stream->tree_d);
+  ucvector_cleanup(&stream->in);
+  lodepng_free(stream->out);
+  stream->out = 0;
+}
+
+/*passes the output decoded since the last flush on*/
+static unsigned InflateStream_flush(InflateStream* stream)
+{
+  size_t size = stream->pos - stream->flushed;
+  if(size == 0) return 0;
+  if(!stream->settings->ignore_adler32)
+  {
+    stream->adler = update_adler32(stream->adler, stream->out + stream->flushed, (unsigned)size);
+  }
+  stream->flushed = stream->pos;
+  return stream->output(stream->context, stream->out + stream->pos - size, size);
+}
+
+/*makes room for a whole match: when the buffer is full, the new output is passed on and the window moves back*/
+static unsigned InflateStream_makeRoom(InflateStream* stream)
+{
+  unsigned error;
+  if(stream->pos + MAX_MATCH_LENGTH <= INFLATE_WINDOW_SIZE + INFLATE_STREAM_OUT) return 0;
+  error = InflateStream_flush(stream);
+  memmove(stream->out, stream->out + stream->pos - INFLATE_WINDOW_SIZE, INFLATE_WINDOW_SIZE);
+  stream->pos = stream->flushed = INFLATE_WINDOW_SIZE;
+  return error;
+}
+
+/*
+decodes the symbols of a huffman block like inflateHuffmanBlock, until its end code or until the input runs out
+before a symbol (then the mode stays INFLATE_HUFFMAN)
+*/
+static unsigned InflateStream_symbols(InflateStream* stream, LodePNGBitReader* streamreader, unsigned last)
+{
+  unsigned error = 0;
+  LodePNGBitReader reader = *streamreader; /*a local copy for the same reason as in inflateHuffmanBlock*/
+
+  while(!error)
+  {
+    unsigned numbits;
+    unsigned code_ll;
+    if(!last && reader.bitsize - reader.bp < INFLATE_SYMBOL_BITS) break; /*wait for more input*/
+    error = InflateStream_makeRoom(stream);
+    if(error) break;
+
+    ensureBits(&reader, 48);
+    code_ll = huffmanDecodeBits(reader.buffer, &numbits, &stream->tree_ll);
+    if(code_ll == (unsigned)(-1))
+    {
+      error = reader.bp >= reader.bitsize ? 10 : 11; /*see inflateHuffmanBlock*/
+      break;
+    }
+    advanceBits(&reader, numbits);
+    if(reader.bp > reader.bitsize) ERROR_BREAK(10); /*error: end of input memory reached without endcode*/
+
+    if(code_ll <= 255) /*literal symbol*/
+    {
+      stream->out[stream->pos++] = (unsigned char)code_ll;
+    }
+    else if(code_ll >= FIRST_LENGTH_CODE_INDEX && code_ll <= LAST_LENGTH_CODE_INDEX) /*length code*/
+    {
+      unsigned code_d, distance;
+      size_t length = LENGTHBASE[code_ll - FIRST_LENGTH_CODE_INDEX];
+      unsigned numextrabits = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
+      length += peekBits(&reader, numextrabits);
+      advanceBits(&reader, numextrabits);
+
+      code_d = huffmanDecodeBits(reader.buffer, &numbits, &stream->tree_d);
+      if(code_d > 29)
+      {
+        if(code_d == (unsigned)(-1)) error = reader.bp >= reader.bitsize ? 10 : 11;
+        else error = 18; /*error: invalid distance code (30-31 are never used)*/
+        break;
+      }
+      advanceBits(&reader, numbits);
+      distance = DISTANCEBASE[code_d];
+      numextrabits = DISTANCEEXTRA[code_d];
+      distance += peekBits(&reader, numextrabits);
+      advanceBits(&reader, numextrabits);
+      if(reader.bp > reader.bitsize) ERROR_BREAK(51); /*error, bit pointer jumped past memory*/
+
+      if(distance > stream->pos) ERROR_BREAK(52); /*too long backward distance*/
+      copyMatch(stream->out, stream->pos, distance, length);
+      stream->pos += length;
+    }
+    else if(code_ll == 256) /*end code*/
+    {
+      stream->mode = stream->final ? INFLATE_ADLER32 : INFLATE_BLOCK_HEADER;
+      break;
+    }
+    else ERROR_BREAK(11); /*code 286 or 287, these are never used*/
+  }
+
+  *streamreader = reader;
+  return error;
+}
+
+/*decodes as much of the buffered input as possible*/
+static unsigned InflateStream_run(InflateStream* stream, unsigned last)
+{
+  unsigned error = 0;
+  LodePNGBitReader reader;
+
+  LodePNGBitReader_init(&reader, stream->in.data, stream->in.size);
+  LodePNGBitReader_seek(&reader, stream->bp);
+
+  while(!error && stream->mode != INFLATE_DONE)
+  {
+    size_t available = reader.bitsize - reader.bp;
+    if(stream->mode == INFLATE_ZLIB_HEADER)
+    {
+      if(available < 16)
+      {
+        if(last) error = 53; /*error, size of zlib data too small*/
+        break;
+      }
+      error = zlib_checkHeader(&reader.data[reader.bp >> 3], 2);
+      LodePNGBitReader_seek(&reader, reader.bp + 16);
+      stream->mode = INFLATE_BLOCK_HEADER;
+    }
+    else if(stream->mode == INFLATE_BLOCK_HEADER)
+    {
+      unsigned BTYPE;
+      if(!last && available < INFLATE_HEADER_BITS) break; /*wait for more input*/
+      if(reader.bp + 2 >= reader.bitsize) ERROR_BREAK(52); /*error, bit pointer will jump past memory*/
+      stream->final = readBits(&reader, 1);
+      BTYPE = readBits(&reader, 2);
+
+      if(BTYPE == 3) ERROR_BREAK(20); /*error: invalid BTYPE*/
+      if(BTYPE == 0) /*no compression, see inflateNoCompression*/
+      {
+        size_t p = (reader.bp + 7) >> 3;
+        unsigned LEN, NLEN;
+        if(p + 4 > reader.size) ERROR_BREAK(52); /*error, bit pointer will jump past memory*/
+        LEN = reader.data[p] + 256u * reader.data[p + 1];
+        NLEN = reader.data[p + 2] + 256u * reader.data[p + 3];
+        if(LEN + NLEN != 65535) ERROR_BREAK(21); /*error: NLEN is not one's complement of LEN*/
+        stream->stored = LEN;
+        LodePNGBitReader_seek(&reader, (p + 4) * 8);
+        stream->mode = INFLATE_STORED;
+      }
+      else
+      {
+        HuffmanTree_cleanup(&stream->tree_ll);
+        HuffmanTree_cleanup(&stream->tree_d);
+        HuffmanTree_init(&stream->tree_ll);
+        HuffmanTree_init(&stream->tree_d);
+        if(BTYPE == 1) getTreeInflateFixed(&stream->tree_ll, &stream->tree_d);
+        else error = getTreeInflateDynamic(&stream->tree_ll, &stream->tree_d, &reader);
+        stream->mode = INFLATE_HUFFMAN;
+      }
+    }
+    else if(stream->mode == INFLATE_STORED)
+    {
+      size_t p = reader.bp >> 3; /*stored bytes start on a byte boundary*/
+      size_t size = stream->stored;
+      if(size == 0)
+      {
+        stream->mode = stream->final ? INFLATE_ADLER32 : INFLATE_BLOCK_HEADER;
+        continue;
+      }
+      if(p == reader.size)
+      {
+        if(last) error = 23; /*error: reading outside of in buffer*/
+        break;
+      }
+      error = InflateStream_makeRoom(stream);
+      if(error) break;
+      if(size > reader.size - p) size = reader.size - p;
+      if(size > INFLATE_WINDOW_SIZE + INFLATE_STREAM_OUT - stream->pos)
+      {
+        size = INFLATE_WINDOW_SIZE + INFLATE_STREAM_OUT - stream->pos;
+      }
+      memcpy(stream->out + stream->pos, reader.data + p, size);
+      stream->pos += size;
+      stream->stored -= size;
+      LodePNGBitReader_seek(&reader, (p + size) * 8);
+    }
+    else if(stream->mode == INFLATE_HUFFMAN)
+    {
+      error = InflateStream_symbols(stream, &reader, last);
+      if(stream->mode == INFLATE_HUFFMAN) break; /*error, or waiting for more input*/
+    }
+    else /*INFLATE_ADLER32, it follows on a byte boundary*/
+    {
+      size_t p = (reader.bp + 7) >> 3;
+      if(p + 4 > reader.size)
+      {
+        if(last) error = 52; /*error, bit pointer will jump past memory*/
+        break;
+      }
+      error = InflateStream_flush(stream); /*updates the checksum*/
+      if(!error && !stream->settings->ignore_adler32 && lodepng_read32bitInt(&reader.data[p]) != stream->adler)
+      {
+        error = 58; /*error, adler checksum not correct, data must be corrupted*/
+      }
+      LodePNGBitReader_seek(&reader, (p + 4) * 8);
+      stream->mode = INFLATE_DONE;
+    }
+  }
+
+  stream->bp = reader.bp;
+  if(!error) error = InflateStream_flush(stream);
+  return error;
+}
+
+/*
+decompresses the next piece of the zlib data, last is 1 if no more will follow. Input after the end of the zlib
+stream is ignored.
+*/
+static unsigned InflateStream_push(InflateStream* stream, const unsigned char* in, size_t insize, unsigned last)
+{
+  unsigned error = 0;
+  do
+  {
+    size_t size = insize < INFLATE_STREAM_IN ? insize : INFLATE_STREAM_IN;
+    size_t consumed = stream->bp >> 3;
+    size_t keep = stream->in.size - consumed;
+
+    if(stream->mode == INFLATE_DONE) break;
+    /*the input not consumed yet moves to the front, followed by the new part*/
+    if(consumed != 0) memmove(stream->in.data, stream->in.data + consumed, keep);
+    stream->bp &= 7u;
+    if(!ucvector_resize(&stream->in, keep + size)) return 83; /*alloc fail*/
+    if(size != 0) memcpy(stream->in.data + keep, in, size);
+    in += size;
+    insize -= size;
+
+    error = InflateStream_run(stream, last && insize == 0);
+  }
+  while(!error && insize != 0);
+  return error;
+}
+#endif /*LODEPNG_COMPILE_PNG*/
+
+#endif /*LODEPNG_COMPILE_DECODER*/
+
+#ifdef LODEPNG_COMPILE_ENCODER
+
+unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                               size_t insize, const LodePNGCompressSettings* settings)
+{
+  /*initially, *out must be NULL and outsize 0, if you just give some random *out
+  that's pointing to a non allocated buffer, this'll crash*/
+  ucvector outv;
+  size_t i;
+  unsigned error;
+  unsigned char* deflatedata = 0;
+  size_t deflatesize = 0;
+
+  /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
+  unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
   unsigned FLEVEL = 0;
   unsigned FDICT = 0;
   unsigned CMFFLG = 256 * CMF + FDICT * 32 + FLEVEL * 64;
@@ -2243,13 +3261,14 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings)
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->level = 0;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0, 0};
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -2283,52 +3302,399 @@ const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0,
 
 
 #ifndef LODEPNG_NO_COMPILE_CRC
-/* CRC polynomial: 0xedb88320 */
-static unsigned lodepng_crc32_table[256] = {
-           0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
-   249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
-   498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
-   325883990u, 1684777152u, 4251122042u, 2321926636u,  335633487u, 1661365465u, 4195302755u, 2366115317u,
-   997073096u, 1281953886u, 3579855332u, 2724688242u, 1006888145u, 1258607687u, 3524101629u, 2768942443u,
-   901097722u, 1119000684u, 3686517206u, 2898065728u,  853044451u, 1172266101u, 3705015759u, 2882616665u,
-   651767980u, 1373503546u, 3369554304u, 3218104598u,  565507253u, 1454621731u, 3485111705u, 3099436303u,
-   671266974u, 1594198024u, 3322730930u, 2970347812u,  795835527u, 1483230225u, 3244367275u, 3060149565u,
-  1994146192u,   31158534u, 2563907772u, 4023717930u, 1907459465u,  112637215u, 2680153253u, 3904427059u,
-  2013776290u,  251722036u, 2517215374u, 3775830040u, 2137656763u,  141376813u, 2439277719u, 3865271297u,
-  1802195444u,  476864866u, 2238001368u, 4066508878u, 1812370925u,  453092731u, 2181625025u, 4111451223u,
-  1706088902u,  314042704u, 2344532202u, 4240017532u, 1658658271u,  366619977u, 2362670323u, 4224994405u,
-  1303535960u,  984961486u, 2747007092u, 3569037538u, 1256170817u, 1037604311u, 2765210733u, 3554079995u,
-  1131014506u,  879679996u, 2909243462u, 3663771856u, 1141124467u,  855842277u, 2852801631u, 3708648649u,
-  1342533948u,  654459306u, 3188396048u, 3373015174u, 1466479909u,  544179635u, 3110523913u, 3462522015u,
-  1591671054u,  702138776u, 2966460450u, 3352799412u, 1504918807u,  783551873u, 3082640443u, 3233442989u,
-  3988292384u, 2596254646u,   62317068u, 1957810842u, 3939845945u, 2647816111u,   81470997u, 1943803523u,
-  3814918930u, 2489596804u,  225274430u, 2053790376u, 3826175755u, 2466906013u,  167816743u, 2097651377u,
-  4027552580u, 2265490386u,  503444072u, 1762050814u, 4150417245u, 2154129355u,  426522225u, 1852507879u,
-  4275313526u, 2312317920u,  282753626u, 1742555852u, 4189708143u, 2394877945u,  397917763u, 1622183637u,
-  3604390888u, 2714866558u,  953729732u, 1340076626u, 3518719985u, 2797360999u, 1068828381u, 1219638859u,
-  3624741850u, 2936675148u,  906185462u, 1090812512u, 3747672003u, 2825379669u,  829329135u, 1181335161u,
-  3412177804u, 3160834842u,  628085408u, 1382605366u, 3423369109u, 3138078467u,  570562233u, 1426400815u,
-  3317316542u, 2998733608u,  733239954u, 1555261956u, 3268935591u, 3050360625u,  752459403u, 1541320221u,
-  2607071920u, 3965973030u, 1969922972u,   40735498u, 2617837225u, 3943577151u, 1913087877u,   83908371u,
-  2512341634u, 3803740692u, 2075208622u,  213261112u, 2463272603u, 3855990285u, 2094854071u,  198958881u,
-  2262029012u, 4057260610u, 1759359992u,  534414190u, 2176718541u, 4139329115u, 1873836001u,  414664567u,
-  2282248934u, 4279200368u, 1711684554u,  285281116u, 2405801727u, 4167216745u, 1634467795u,  376229701u,
-  2685067896u, 3608007406u, 1308918612u,  956543938u, 2808555105u, 3495958263u, 1231636301u, 1047427035u,
-  2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
-  3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
-  3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+/*
+CRC polynomial: 0xedb88320. lodepng_crc32_table[0] is the table of the byte-wise CRC, table k has the CRC of a
+byte followed by k zero bytes, for slicing-by-8: 8 bytes per step with 8 independent lookups.
+*/
+static const unsigned lodepng_crc32_table[8][256] = {
+  {
+             0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
+     249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
+     498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
+     325883990u, 1684777152u, 4251122042u, 2321926636u,  335633487u, 1661365465u, 4195302755u, 2366115317u,
+     997073096u, 1281953886u, 3579855332u, 2724688242u, 1006888145u, 1258607687u, 3524101629u, 2768942443u,
+     901097722u, 1119000684u, 3686517206u, 2898065728u,  853044451u, 1172266101u, 3705015759u, 2882616665u,
+     651767980u, 1373503546u, 3369554304u, 3218104598u,  565507253u, 1454621731u, 3485111705u, 3099436303u,
+     671266974u, 1594198024u, 3322730930u, 2970347812u,  795835527u, 1483230225u, 3244367275u, 3060149565u,
+    1994146192u,   31158534u, 2563907772u, 4023717930u, 1907459465u,  112637215u, 2680153253u, 3904427059u,
+    2013776290u,  251722036u, 2517215374u, 3775830040u, 2137656763u,  141376813u, 2439277719u, 3865271297u,
+    1802195444u,  476864866u, 2238001368u, 4066508878u, 1812370925u,  453092731u, 2181625025u, 4111451223u,
+    1706088902u,  314042704u, 2344532202u, 4240017532u, 1658658271u,  366619977u, 2362670323u, 4224994405u,
+    1303535960u,  984961486u, 2747007092u, 3569037538u, 1256170817u, 1037604311u, 2765210733u, 3554079995u,
+    1131014506u,  879679996u, 2909243462u, 3663771856u, 1141124467u,  855842277u, 2852801631u, 3708648649u,
+    1342533948u,  654459306u, 3188396048u, 3373015174u, 1466479909u,  544179635u, 3110523913u, 3462522015u,
+    1591671054u,  702138776u, 2966460450u, 3352799412u, 1504918807u,  783551873u, 3082640443u, 3233442989u,
+    3988292384u, 2596254646u,   62317068u, 1957810842u, 3939845945u, 2647816111u,   81470997u, 1943803523u,
+    3814918930u, 2489596804u,  225274430u, 2053790376u, 3826175755u, 2466906013u,  167816743u, 2097651377u,
+    4027552580u, 2265490386u,  503444072u, 1762050814u, 4150417245u, 2154129355u,  426522225u, 1852507879u,
+    4275313526u, 2312317920u,  282753626u, 1742555852u, 4189708143u, 2394877945u,  397917763u, 1622183637u,
+    3604390888u, 2714866558u,  953729732u, 1340076626u, 3518719985u, 2797360999u, 1068828381u, 1219638859u,
+    3624741850u, 2936675148u,  906185462u, 1090812512u, 3747672003u, 2825379669u,  829329135u, 1181335161u,
+    3412177804u, 3160834842u,  628085408u, 1382605366u, 3423369109u, 3138078467u,  570562233u, 1426400815u,
+    3317316542u, 2998733608u,  733239954u, 1555261956u, 3268935591u, 3050360625u,  752459403u, 1541320221u,
+    2607071920u, 3965973030u, 1969922972u,   40735498u, 2617837225u, 3943577151u, 1913087877u,   83908371u,
+    2512341634u, 3803740692u, 2075208622u,  213261112u, 2463272603u, 3855990285u, 2094854071u,  198958881u,
+    2262029012u, 4057260610u, 1759359992u,  534414190u, 2176718541u, 4139329115u, 1873836001u,  414664567u,
+    2282248934u, 4279200368u, 1711684554u,  285281116u, 2405801727u, 4167216745u, 1634467795u,  376229701u,
+    2685067896u, 3608007406u, 1308918612u,  956543938u, 2808555105u, 3495958263u, 1231636301u, 1047427035u,
+    2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
+    3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
+    3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+  },
+  {
+             0u,  421212481u,  842424962u,  724390851u, 1684849924u, 2105013317u, 1448781702u, 1329698503u,
+    3369699848u, 3519200073u, 4210026634u, 3824474571u, 2897563404u, 3048111693u, 2659397006u, 2274893007u,
+    1254232657u, 1406739216u, 2029285587u, 1643069842u,  783210325u,  934667796u,  479770071u,   92505238u,
+    2182846553u, 2600511768u, 2955803355u, 2838940570u, 3866582365u, 4285295644u, 3561045983u, 3445231262u,
+    2508465314u, 2359236067u, 2813478432u, 3198777185u, 4058571174u, 3908292839u, 3286139684u, 3670389349u,
+    1566420650u, 1145479147u, 1869335592u, 1987116393u,  959540142u,  539646703u,  185010476u,  303839341u,
+    3745920755u, 3327985586u, 3983561841u, 4100678960u, 3140154359u, 2721170102u, 2300350837u, 2416418868u,
+     396344571u,  243568058u,  631889529u, 1018359608u, 1945336319u, 1793607870u, 1103436669u, 1490954812u,
+    4034481925u, 3915546180u, 3259968903u, 3679722694u, 2484439553u, 2366552896u, 2787371139u, 3208174018u,
+     950060301u,  565965900u,  177645455u,  328046286u, 1556873225u, 1171730760u, 1861902987u, 2011255754u,
+    3132841300u, 2745199637u, 2290958294u, 2442530455u, 3738671184u, 3352078609u, 3974232786u, 4126854035u,
+    1919080284u, 1803150877u, 1079293406u, 1498383519u,  370020952u,  253043481u,  607678682u, 1025720731u,
+    1711106983u, 2095471334u, 1472923941u, 1322268772u,   26324643u,  411738082u,  866634785u,  717028704u,
+    2904875439u, 3024081134u, 2668790573u, 2248782444u, 3376948395u, 3495106026u, 4219356713u, 3798300520u,
+     792689142u,  908347575u,  487136116u,   68299317u, 1263779058u, 1380486579u, 2036719216u, 1618931505u,
+    3890672638u, 4278043327u, 3587215740u, 3435896893u, 2206873338u, 2593195963u, 2981909624u, 2829542713u,
+     998479947u,  580430090u,  162921161u,  279890824u, 1609522511u, 1190423566u, 1842954189u, 1958874764u,
+    4082766403u, 3930137346u, 3245109441u, 3631694208u, 2536953671u, 2385372678u, 2768287173u, 3155920004u,
+    1900120602u, 1750776667u, 1131931800u, 1517083097u,  355290910u,  204897887u,  656092572u, 1040194781u,
+    3113746450u, 2692952403u, 2343461520u, 2461357009u, 3723805974u, 3304059991u, 4022511508u, 4141455061u,
+    2919742697u, 3072101800u, 2620513899u, 2234183466u, 3396041197u, 3547351212u, 4166851439u, 3779471918u,
+    1725839073u, 2143618976u, 1424512099u, 1307796770u,   45282277u,  464110244u,  813994343u,  698327078u,
+    3838160568u, 4259225593u, 3606301754u, 3488152955u, 2158586812u, 2578602749u, 2996767038u, 2877569151u,
+     740041904u,  889656817u,  506086962u,  120682355u, 1215357364u, 1366020341u, 2051441462u, 1667084919u,
+    3422213966u, 3538019855u, 4190942668u, 3772220557u, 2945847882u, 3062702859u, 2644537544u, 2226864521u,
+      52649286u,  439905287u,  823476164u,  672009861u, 1733269570u, 2119477507u, 1434057408u, 1281543041u,
+    2167981343u, 2552493150u, 3004082077u, 2853541596u, 3847487515u, 4233048410u, 3613549209u, 3464057816u,
+    1239502615u, 1358593622u, 2077699477u, 1657543892u,  764250643u,  882293586u,  532408465u,  111204816u,
+    1585378284u, 1197851309u, 1816695150u, 1968414767u,  974272232u,  587794345u,  136598634u,  289367339u,
+    2527558116u, 2411481253u, 2760973158u, 3179948583u, 4073438432u, 3956313505u, 3237863010u, 3655790371u,
+     347922877u,  229101820u,  646611775u, 1066513022u, 1892689081u, 1774917112u, 1122387515u, 1543337850u,
+    3697634229u, 3313392372u, 3998419255u, 4148705398u, 3087642289u, 2702352368u, 2319436851u, 2468674930u
+  },
+  {
+             0u,   29518391u,   59036782u,   38190681u,  118073564u,  114017003u,   76381362u,   89069189u,
+     236147128u,  265370511u,  228034006u,  206958561u,  152762724u,  148411219u,  178138378u,  190596925u,
+     472294256u,  501532999u,  530741022u,  509615401u,  456068012u,  451764635u,  413917122u,  426358261u,
+     305525448u,  334993663u,  296822438u,  275991697u,  356276756u,  352202787u,  381193850u,  393929805u,
+     944588512u,  965684439u, 1003065998u,  973863097u, 1061482044u, 1049003019u, 1019230802u, 1023561829u,
+     912136024u,  933002607u,  903529270u,  874031361u,  827834244u,  815125939u,  852716522u,  856752605u,
+     611050896u,  631869351u,  669987326u,  640506825u,  593644876u,  580921211u,  551983394u,  556069653u,
+     712553512u,  733666847u,  704405574u,  675154545u,  762387700u,  749958851u,  787859610u,  792175277u,
+    1889177024u, 1901651959u, 1931368878u, 1927033753u, 2006131996u, 1985040171u, 1947726194u, 1976933189u,
+    2122964088u, 2135668303u, 2098006038u, 2093965857u, 2038461604u, 2017599123u, 2047123658u, 2076625661u,
+    1824272048u, 1836991623u, 1866005214u, 1861914857u, 1807058540u, 1786244187u, 1748062722u, 1777547317u,
+    1655668488u, 1668093247u, 1630251878u, 1625932113u, 1705433044u, 1684323811u, 1713505210u, 1742760333u,
+    1222101792u, 1226154263u, 1263738702u, 1251046777u, 1339974652u, 1310460363u, 1281013650u, 1301863845u,
+    1187289752u, 1191637167u, 1161842422u, 1149379777u, 1103966788u, 1074747507u, 1112139306u, 1133218845u,
+    1425107024u, 1429406311u, 1467333694u, 1454888457u, 1408811148u, 1379576507u, 1350309090u, 1371438805u,
+    1524775400u, 1528845279u, 1499917702u, 1487177649u, 1575719220u, 1546255107u, 1584350554u, 1605185389u,
+    3778354048u, 3774312887u, 3803303918u, 3816007129u, 3862737756u, 3892238699u, 3854067506u, 3833203973u,
+    4012263992u, 4007927823u, 3970080342u, 3982554209u, 3895452388u, 3924658387u, 3953866378u, 3932773565u,
+    4245928176u, 4241609415u, 4271336606u, 4283762345u, 4196012076u, 4225268251u, 4187931714u, 4166823541u,
+    4076923208u, 4072833919u, 4035198246u, 4047918865u, 4094247316u, 4123732899u, 4153251322u, 4132437965u,
+    3648544096u, 3636082519u, 3673983246u, 3678331705u, 3732010428u, 3753090955u, 3723829714u, 3694611429u,
+    3614117080u, 3601426159u, 3572488374u, 3576541825u, 3496125444u, 3516976691u, 3555094634u, 3525581405u,
+    3311336976u, 3298595879u, 3336186494u, 3340255305u, 3260503756u, 3281337595u, 3251864226u, 3222399125u,
+    3410866088u, 3398419871u, 3368647622u, 3372945905u, 3427010420u, 3448139075u, 3485520666u, 3456284973u,
+    2444203584u, 2423127159u, 2452308526u, 2481530905u, 2527477404u, 2539934891u, 2502093554u, 2497740997u,
+    2679949304u, 2659102159u, 2620920726u, 2650438049u, 2562027300u, 2574714131u, 2603727690u, 2599670141u,
+    2374579504u, 2353749767u, 2383274334u, 2412743529u, 2323684844u, 2336421851u, 2298759554u, 2294686645u,
+    2207933576u, 2186809023u, 2149495014u, 2178734801u, 2224278612u, 2236720739u, 2266437690u, 2262135309u,
+    2850214048u, 2820717207u, 2858812622u, 2879680249u, 2934667388u, 2938704459u, 2909776914u, 2897069605u,
+    2817622296u, 2788420399u, 2759153014u, 2780249921u, 2700618180u, 2704950259u, 2742877610u, 2730399645u,
+    3049550800u, 3020298727u, 3057690558u, 3078802825u, 2999835404u, 3004150075u, 2974355298u, 2961925461u,
+    3151438440u, 3121956959u, 3092510214u, 3113327665u, 3168701108u, 3172786307u, 3210370778u, 3197646061u
+  },
+  {
+             0u, 3099354981u, 2852767883u,  313896942u, 2405603159u,  937357362u,  627793884u, 2648127673u,
+    3316918511u, 2097696650u, 1874714724u, 3607201537u, 1255587768u, 4067088605u, 3772741427u, 1482887254u,
+    1343838111u, 3903140090u, 4195393300u, 1118632049u, 3749429448u, 1741137837u, 1970407491u, 3452858150u,
+    2511175536u,  756094997u, 1067759611u, 2266550430u,  449832999u, 2725482306u, 2965774508u,  142231497u,
+    2687676222u,  412010587u,  171665333u, 2995192016u,  793786473u, 2548850444u, 2237264098u, 1038456711u,
+    1703315409u, 3711623348u, 3482275674u, 1999841343u, 3940814982u, 1381529571u, 1089329165u, 4166106984u,
+    4029413537u, 1217896388u, 1512189994u, 3802027855u, 2135519222u, 3354724499u, 3577784189u, 1845280792u,
+     899665998u, 2367928107u, 2677414085u,  657096608u, 3137160985u,   37822588u,  284462994u, 2823350519u,
+    2601801789u,  598228824u,  824021174u, 2309093331u,  343330666u, 2898962447u, 3195996129u,  113467524u,
+    1587572946u, 3860600759u, 4104763481u, 1276501820u, 3519211397u, 1769898208u, 2076913422u, 3279374443u,
+    3406630818u, 1941006535u, 1627703081u, 3652755532u, 1148164341u, 4241751952u, 3999682686u, 1457141531u,
+     247015245u, 3053797416u, 2763059142u,  470583459u, 2178658330u,  963106687u,  735213713u, 2473467892u,
+     992409347u, 2207944806u, 2435792776u,  697522413u, 3024379988u,  217581361u,  508405983u, 2800865210u,
+    4271038444u, 1177467017u, 1419450215u, 3962007554u, 1911572667u, 3377213406u, 3690561584u, 1665525589u,
+    1799331996u, 3548628985u, 3241568279u, 2039091058u, 3831314379u, 1558270126u, 1314193216u, 4142438437u,
+    2928380019u,  372764438u,   75645176u, 3158189981u,  568925988u, 2572515393u, 2346768303u,  861712586u,
+    3982079547u, 1441124702u, 1196457648u, 4293663189u, 1648042348u, 3666298377u, 3358779879u, 1888390786u,
+     686661332u, 2421291441u, 2196002399u,  978858298u, 2811169155u,  523464422u,  226935048u, 3040519789u,
+    3175145892u,  100435649u,  390670639u, 2952089162u,  841119475u, 2325614998u, 2553003640u,  546822429u,
+    2029308235u, 3225988654u, 3539796416u, 1782671013u, 4153826844u, 1328167289u, 1570739863u, 3844338162u,
+    1298864389u, 4124540512u, 3882013070u, 1608431339u, 3255406162u, 2058742071u, 1744848601u, 3501990332u,
+    2296328682u,  811816591u,  584513889u, 2590678532u,  129869501u, 3204563416u, 2914283062u,  352848211u,
+     494030490u, 2781751807u, 3078325777u,  264757620u, 2450577869u,  715964072u,  941166918u, 2158327331u,
+    3636881013u, 1618608400u, 1926213374u, 3396585883u, 1470427426u, 4011365959u, 4255988137u, 1158766284u,
+    1984818694u, 3471935843u, 3695453837u, 1693991400u, 4180638033u, 1100160564u, 1395044826u, 3952793279u,
+    3019491049u,  189112716u,  435162722u, 2706139399u, 1016811966u, 2217162459u, 2526189877u,  774831696u,
+     643086745u, 2666061564u, 2354934034u,  887166583u, 2838900430u,  294275499u,   54519365u, 3145957664u,
+    3823145334u, 1532818963u, 1240029693u, 4048895640u, 1820460577u, 3560857924u, 3331051178u, 2117577167u,
+    3598663992u, 1858283101u, 2088143283u, 3301633750u, 1495127663u, 3785470218u, 4078182116u, 1269332353u,
+     332098007u, 2876706482u, 3116540252u,   25085497u, 2628386432u,  605395429u,  916469259u, 2384220526u,
+    2254837415u, 1054503362u,  745528876u, 2496903497u,  151290352u, 2981684885u, 2735556987u,  464596510u,
+    1137851976u, 4218313005u, 3923506883u, 1365741990u, 3434129695u, 1946996346u, 1723425172u, 3724871409u
+  },
+  {
+             0u, 1029712304u, 2059424608u, 1201699536u, 4118849216u, 3370159984u, 2403399072u, 2988497936u,
+     812665793u,  219177585u, 1253054625u, 2010132753u, 3320900865u, 4170237105u, 3207642721u, 2186319825u,
+    1625331586u, 1568718386u,  438355170u,  658566482u, 2506109250u, 2818578674u, 4020265506u, 3535817618u,
+    1351670851u, 1844508147u,  709922595u,  389064339u, 2769320579u, 2557498163u, 3754961379u, 3803185235u,
+    3250663172u, 4238411444u, 3137436772u, 2254525908u,  876710340u,  153198708u, 1317132964u, 1944187668u,
+    4054934725u, 3436268917u, 2339452837u, 3054575125u,   70369797u,  961670069u, 2129760613u, 1133623509u,
+    2703341702u, 2621542710u, 3689016294u, 3867263574u, 1419845190u, 1774270454u,  778128678u,  318858390u,
+    2438067015u, 2888948471u, 3952189479u, 3606153623u, 1691440519u, 1504803895u,  504432359u,  594620247u,
+    1492342857u, 1704161785u,  573770537u,  525542041u, 2910060169u, 2417219385u, 3618876905u, 3939730521u,
+    1753420680u, 1440954936u,  306397416u,  790849880u, 2634265928u, 2690882808u, 3888375336u, 3668168600u,
+     940822475u,   91481723u, 1121164459u, 2142483739u, 3448989963u, 4042473659u, 3075684971u, 2318603227u,
+     140739594u,  889433530u, 1923340138u, 1338244826u, 4259521226u, 3229813626u, 2267247018u, 3124975642u,
+    2570221389u, 2756861693u, 3824297005u, 3734113693u, 1823658381u, 1372780605u,  376603373u,  722643805u,
+    2839690380u, 2485261628u, 3548540908u, 4007806556u, 1556257356u, 1638052860u,  637716780u,  459464860u,
+    4191346895u, 3300051327u, 2199040943u, 3195181599u,  206718479u,  825388991u, 1989285231u, 1274166495u,
+    3382881038u, 4106388158u, 3009607790u, 2382549470u, 1008864718u,   21111934u, 1189240494u, 2072147742u,
+    2984685714u, 2357631266u, 3408323570u, 4131834434u, 1147541074u, 2030452706u, 1051084082u,   63335554u,
+    2174155603u, 3170292451u, 4216760371u, 3325460867u, 1947622803u, 1232499747u,  248909555u,  867575619u,
+    3506841360u, 3966111392u, 2881909872u, 2527485376u,  612794832u,  434546784u, 1581699760u, 1663499008u,
+    3782634705u, 3692447073u, 2612412337u, 2799048193u,  351717905u,  697754529u, 1849071985u, 1398190273u,
+    1881644950u, 1296545318u,  182963446u,  931652934u, 2242328918u, 3100053734u, 4284967478u, 3255255942u,
+    1079497815u, 2100821479u,  983009079u,  133672583u, 3050795671u, 2293717799u, 3474399735u, 4067887175u,
+     281479188u,  765927844u, 1778867060u, 1466397380u, 3846680276u, 3626469220u, 2676489652u, 2733102084u,
+     548881365u,  500656741u, 1517752501u, 1729575173u, 3577210133u, 3898068133u, 2952246901u, 2459410373u,
+    3910527195u, 3564487019u, 2480257979u, 2931134987u,  479546907u,  569730987u, 1716854139u, 1530213579u,
+    3647316762u, 3825568426u, 2745561210u, 2663766474u,  753206746u,  293940330u, 1445287610u, 1799716618u,
+    2314567513u, 3029685993u, 4080348217u, 3461678473u, 2088098201u, 1091956777u,  112560889u, 1003856713u,
+    3112514712u, 2229607720u, 3276105720u, 4263857736u, 1275433560u, 1902492648u,  918929720u,  195422344u,
+     685033439u,  364179055u, 1377080511u, 1869921551u, 3713294623u, 3761522863u, 2811507327u, 2599689167u,
+     413436958u,  633644462u, 1650777982u, 1594160846u, 3978570462u, 3494118254u, 2548332990u, 2860797966u,
+    1211387997u, 1968470509u,  854852413u,  261368461u, 3182753437u, 2161434413u, 3346310653u, 4195650637u,
+    2017729436u, 1160000044u,   42223868u, 1071931724u, 2378480988u, 2963576044u, 4144295484u, 3395602316u
+  },
+  {
+             0u, 3411858341u, 1304994059u, 2257875630u, 2609988118u, 1355649459u, 3596215069u,  486879416u,
+    3964895853u,  655315400u, 2711298918u, 1791488195u, 2009251963u, 3164476382u,  973758832u, 4048990933u,
+      64357019u, 3364540734u, 1310630800u, 2235723829u, 2554806413u, 1394316072u, 3582976390u,  517157411u,
+    4018503926u,  618222419u, 2722963965u, 1762783832u, 1947517664u, 3209171269u,  970744811u, 4068520014u,
+     128714038u, 3438335635u, 1248109629u, 2167961496u, 2621261600u, 1466012805u, 3522553387u,  447296910u,
+    3959392091u,  547575038u, 2788632144u, 1835791861u, 1886307661u, 3140622056u, 1034314822u, 4143626211u,
+      75106221u, 3475428360u, 1236444838u, 2196665603u, 2682996155u, 1421317662u, 3525567664u,  427767573u,
+    3895035328u,  594892389u, 2782995659u, 1857943406u, 1941489622u, 3101955187u, 1047553757u, 4113347960u,
+     257428076u, 3288652233u, 1116777319u, 2311878850u, 2496219258u, 1603640287u, 3640781169u,  308099796u,
+    3809183745u,  676813732u, 2932025610u, 1704983215u, 2023410199u, 3016104370u,  894593820u, 4262377657u,
+     210634999u, 3352484690u, 1095150076u, 2316991065u, 2535410401u, 1547934020u, 3671583722u,  294336591u,
+    3772615322u,  729897279u, 2903845777u, 1716123700u, 2068629644u, 2953845545u,  914647431u, 4258839074u,
+     150212442u, 3282623743u, 1161604689u, 2388688372u, 2472889676u, 1480171241u, 3735940167u,  368132066u,
+    3836185911u,  805002898u, 2842635324u, 1647574937u, 2134298401u, 3026852996u,  855535146u, 4188192143u,
+     186781121u, 3229539940u, 1189784778u, 2377547631u, 2427670487u, 1542429810u, 3715886812u,  371670393u,
+    3882979244u,  741170185u, 2864262823u, 1642462466u, 2095107514u, 3082559007u,  824732849u, 4201955092u,
+     514856152u, 3589064573u, 1400419795u, 2552522358u, 2233554638u, 1316849003u, 3370776517u,   62202976u,
+    4075001525u,  968836368u, 3207280574u, 1954014235u, 1769133219u, 2720925446u,  616199592u, 4024870413u,
+     493229635u, 3594175974u, 1353627464u, 2616354029u, 2264355925u, 1303087088u, 3409966430u,    6498043u,
+    4046820398u,  979978123u, 3170710821u, 2007099008u, 1789187640u, 2717386141u,  661419827u, 3962610838u,
+     421269998u, 3527459403u, 1423225061u, 2676515648u, 2190300152u, 1238466653u, 3477467891u,   68755798u,
+    4115633027u, 1041448998u, 3095868040u, 1943789869u, 1860096405u, 2776760880u,  588673182u, 3897205563u,
+     449450869u, 3516317904u, 1459794558u, 2623431131u, 2170245475u, 1242006214u, 3432247400u,  131015629u,
+    4137259288u, 1036337853u, 3142660115u, 1879958454u, 1829294862u, 2790523051u,  549483013u, 3952910752u,
+     300424884u, 3669282065u, 1545650111u, 2541513754u, 2323209378u, 1092980487u, 3350330793u,  216870412u,
+    4256931033u,  921128828u, 2960342482u, 2066738807u, 1714085583u, 2910195050u,  736264132u, 3770592353u,
+     306060335u, 3647131530u, 1610005796u, 2494197377u, 2309971513u, 1123257756u, 3295149874u,  255536279u,
+    4268596802u,  892423655u, 3013951305u, 2029645036u, 1711070292u, 2929725425u,  674528607u, 3815288570u,
+     373562242u, 3709388839u, 1535949449u, 2429577516u, 2379569556u, 1183418929u, 3223189663u,  188820282u,
+    4195850735u,  827017802u, 3084859620u, 2089020225u, 1636228089u, 2866415708u,  743340786u, 3876759895u,
+     361896217u, 3738094268u, 1482340370u, 2466671543u, 2382584591u, 1163888810u, 3284924932u,  144124321u,
+    4190215028u,  849168593u, 3020503679u, 2136336858u, 1649465698u, 2836138695u,  798521449u, 3838094284u
+  },
+  {
+             0u, 2792819636u, 2543784233u,  837294749u, 4098827283u, 1379413927u, 1674589498u, 3316072078u,
+     871321191u, 2509784531u, 2758827854u,   34034938u, 3349178996u, 1641505216u, 1346337629u, 4131942633u,
+    1742642382u, 3249117050u, 4030828007u, 1446413907u, 2475800797u,  904311657u,   68069876u, 2725880384u,
+    1412551337u, 4064729373u, 3283010432u, 1708771380u, 2692675258u,  101317902u,  937551763u, 2442587175u,
+    3485284764u, 1774858792u, 1478633653u, 4266992385u, 1005723023u, 2642744891u, 2892827814u,  169477906u,
+    4233263099u, 1512406095u, 1808623314u, 3451546982u,  136139752u, 2926205020u, 2676114113u,  972376437u,
+    2825102674u,  236236518u, 1073525883u, 2576072655u, 1546420545u, 4200303349u, 3417542760u, 1841601500u,
+    2609703733u, 1039917185u,  202635804u, 2858742184u, 1875103526u, 3384067218u, 4166835727u, 1579931067u,
+    1141601657u, 3799809741u, 3549717584u, 1977839588u, 2957267306u,  372464350u,  668680259u, 2175552503u,
+    2011446046u, 3516084394u, 3766168119u, 1175200131u, 2209029901u,  635180217u,  338955812u, 2990736784u,
+     601221559u, 2242044419u, 3024812190u,  306049834u, 3617246628u, 1911408144u, 1074125965u, 3866285881u,
+     272279504u, 3058543716u, 2275784441u,  567459149u, 3832906691u, 1107462263u, 1944752874u, 3583875422u,
+    2343980261u,  767641425u,  472473036u, 3126744696u, 2147051766u, 3649987394u, 3899029983u, 1309766251u,
+    3092841090u,  506333494u,  801510315u, 2310084639u, 1276520081u, 3932237093u, 3683203000u, 2113813516u,
+    3966292011u, 1243601823u, 2079834370u, 3716205238u,  405271608u, 3192979340u, 2411259153u,  701492901u,
+    3750207052u, 2045810168u, 1209569125u, 4000285905u,  734575199u, 2378150379u, 3159862134u,  438345922u,
+    2283203314u,  778166598u,  529136603u, 3120492655u, 2086260449u, 3660498261u, 3955679176u, 1303499900u,
+    3153699989u,  495890209u,  744928700u, 2316418568u, 1337360518u, 3921775410u, 3626602927u, 2120129051u,
+    4022892092u, 1237286280u, 2018993941u, 3726666913u,  461853231u, 3186645403u, 2350400262u,  711936178u,
+    3693557851u, 2052076527u, 1270360434u, 3989775046u,  677911624u, 2384402428u, 3220639073u,  427820757u,
+    1202443118u, 3789347034u, 3493118535u, 1984154099u, 3018127229u,  362020041u,  612099668u, 2181885408u,
+    1950653705u, 3526596285u, 3822816288u, 1168934804u, 2148251930u,  645706414u,  395618355u, 2984485767u,
+     544559008u, 2248295444u, 3085590153u,  295523645u, 3560598451u, 1917673479u, 1134918298u, 3855773998u,
+     328860103u, 3052210803u, 2214924526u,  577903450u, 3889505748u, 1101147744u, 1883911421u, 3594338121u,
+    3424493451u, 1785369663u, 1535282850u, 4260726038u,  944946072u, 2653270060u, 2949491377u,  163225861u,
+    4294103532u, 1501944408u, 1752023237u, 3457862513u,  196998655u, 2915761739u, 2619532502u,  978710370u,
+    2881684293u,  229902577u, 1012666988u, 2586515928u, 1603020630u, 4193987810u, 3356702335u, 1852063179u,
+    2553040162u, 1046169238u,  263412747u, 2848217023u, 1818454321u, 3390333573u, 4227627032u, 1569420204u,
+      60859927u, 2782375331u, 2487203646u,  843627658u, 4159668740u, 1368951216u, 1617990445u, 3322386585u,
+     810543216u, 2520310724u, 2815490393u,   27783917u, 3288386659u, 1652017111u, 1402985802u, 4125677310u,
+    1685994201u, 3255382381u, 4091620336u, 1435902020u, 2419138250u,  910562686u,  128847843u, 2715354199u,
+    1469150398u, 4058414858u, 3222168983u, 1719234083u, 2749255853u,   94984985u,  876691844u, 2453031472u
+  },
+  {
+             0u, 3433693342u, 1109723005u, 2391738339u, 2219446010u, 1222643300u, 3329165703u,  180685081u,
+    3555007413u,  525277995u, 2445286600u, 1567235158u, 1471092047u, 2600801745u,  361370162u, 3642757804u,
+    2092642603u, 2953916853u, 1050555990u, 4063508168u, 4176560081u,  878395215u, 3134470316u, 1987983410u,
+    2942184094u, 1676945920u, 3984272867u,  567356797u,  722740324u, 3887998202u, 1764827929u, 2778407815u,
+    4185285206u,  903635656u, 3142804779u, 2012833205u, 2101111980u, 2979425330u, 1058630609u, 4088621903u,
+     714308067u, 3862526333u, 1756790430u, 2753330688u, 2933487385u, 1651734407u, 3975966820u,  542535930u,
+    2244825981u, 1231508451u, 3353891840u,  188896414u,   25648519u, 3442302233u, 1134713594u, 2399689316u,
+    1445480648u, 2592229462u,  336416693u, 3634843435u, 3529655858u,  516441772u, 2420588879u, 1559052753u,
+     698204909u, 3845636723u, 1807271312u, 2803025166u, 2916600855u, 1635634313u, 4025666410u,  593021940u,
+    4202223960u,  919787974u, 3093159461u, 1962401467u, 2117261218u, 2996361020u, 1008193759u, 4038971457u,
+    1428616134u, 2576151384u,  386135227u, 3685348389u, 3513580860u,  499580322u, 2471098945u, 1608776415u,
+    2260985971u, 1248454893u, 3303468814u,  139259792u,   42591881u, 3458459159u, 1085071860u, 2349261162u,
+    3505103035u,  474062885u, 2463016902u, 1583654744u, 1419882049u, 2550902495u,  377792828u, 3660491170u,
+      51297038u, 3483679632u, 1093385331u, 2374089965u, 2269427188u, 1273935210u, 3311514249u,  164344343u,
+    2890961296u, 1627033870u, 4000683757u,  585078387u,  672833386u, 3836780532u, 1782552599u, 2794821769u,
+    2142603813u, 3005188795u, 1032883544u, 4047146438u, 4227826911u,  928351297u, 3118105506u, 1970307900u,
+    1396409818u, 2677114180u,  287212199u, 3719594553u, 3614542624u,  467372990u, 2505346141u, 1509854403u,
+    2162073199u, 1282711281u, 3271268626u,  240228748u,   76845205u, 3359543307u, 1186043880u, 2317064054u,
+     796964081u, 3811226735u, 1839575948u, 2702160658u, 2882189835u, 1734392469u, 3924802934u,  625327592u,
+    4234522436u,  818917338u, 3191908409u, 1927981223u, 2016387518u, 3028656416u,  973776579u, 4137723485u,
+    2857232268u, 1726474002u, 3899187441u,  616751215u,  772270454u, 3803048424u, 1814228491u, 2693328533u,
+    2041117753u, 3036871847u,  999160644u, 4146592730u, 4259508931u,  826864221u, 3217552830u, 1936586016u,
+    3606501031u,  442291769u, 2496909786u, 1484378436u, 1388107869u, 2652297411u,  278519584u, 3694387134u,
+      85183762u, 3384397196u, 1194773103u, 2342308593u, 2170143720u, 1307820918u, 3279733909u,  265733131u,
+    2057717559u, 3054258089u,  948125770u, 4096344276u, 4276898253u,  843467091u, 3167309488u, 1885556270u,
+    2839764098u, 1709792284u, 3949353983u,  667704161u,  755585656u, 3785577190u, 1865176325u, 2743489947u,
+     102594076u, 3401021058u, 1144549729u, 2291298815u, 2186770662u, 1325234296u, 3228729243u,  215514885u,
+    3589828009u,  424832311u, 2547870420u, 1534552650u, 1370645331u, 2635621325u,  328688686u, 3745342640u,
+    2211456353u, 1333405183u, 3254067740u,  224338562u,  127544219u, 3408931589u, 1170156774u, 2299866232u,
+    1345666772u, 2627681866u,  303053225u, 3736746295u, 3565105198u,  416624816u, 2522494803u, 1525692365u,
+    4285207626u,  868291796u, 3176010551u, 1910772649u, 2065767088u, 3079346734u,  956571085u, 4121828691u,
+     747507711u, 3760459617u, 1856702594u, 2717976604u, 2831417605u, 1684930971u, 3940615800u,  642451174u
+  }
 };
 
-/*Return the CRC of the bytes buf[0..len-1].*/
-unsigned lodepng_crc32(const unsigned char* data, size_t length)
+/*continues the CRC register r over data, for a CRC of data that is not in memory all at once*/
+static unsigned updateCRC32_slicing(unsigned r, const unsigned char* data, size_t length)
 {
-  unsigned r = 0xffffffffu;
-  size_t i;
-  for(i = 0; i < length; ++i)
+  while(length >= 8)
   {
-    r = lodepng_crc32_table[(r ^ data[i]) & 0xff] ^ (r >> 8);
+    unsigned a = r ^ (data[0] | ((unsigned)data[1] << 8) | ((unsigned)data[2] << 16) | ((unsigned)data[3] << 24));
+    r = lodepng_crc32_table[7][a & 0xff] ^ lodepng_crc32_table[6][(a >> 8) & 0xff]
+      ^ lodepng_crc32_table[5][(a >> 16) & 0xff] ^ lodepng_crc32_table[4][a >> 24]
+      ^ lodepng_crc32_table[3][data[4]] ^ lodepng_crc32_table[2][data[5]]
+      ^ lodepng_crc32_table[1][data[6]] ^ lodepng_crc32_table[0][data[7]];
+    data += 8;
+    length -= 8;
   }
-  return r ^ 0xffffffffu;
+  while(length > 0)
+  {
+    r = lodepng_crc32_table[0][(r ^ *data++) & 0xff] ^ (r >> 8);
+    --length;
+  }
+  return r;
+}
+
+#ifdef LODEPNG_SIMD_X86
+/*
+CRC with carry-less multiplication (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+Instruction"): four 128-bit lanes are folded forward over 64 bytes per step, then into one lane, which is
+reduced to 32 bits (Barrett). The constants are powers of x modulo the bit-reflected polynomial. Takes at least
+64 bytes, a multiple of 16.
+*/
+LODEPNG_TARGET_PCLMUL static unsigned updateCRC32_fold(unsigned r, const unsigned char* data, size_t length)
+{
+  const __m128i k1k2 = _mm_setr_epi32(0x54442bd4, 1, (int)0xc6e41596u, 1);
+  const __m128i k3k4 = _mm_setr_epi32(0x751997d0, 1, (int)0xccaa009eu, 0);
+  const __m128i k5 = _mm_setr_epi32(0x63cd6124, 1, 0, 0);
+  const __m128i poly = _mm_setr_epi32((int)0xdb710641u, 1, (int)0xf7011641u, 1);
+  const __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+  __m128i x1 = _mm_loadu_si128((const __m128i*)(data + 0));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 16));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 48));
+  __m128i t;
+
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)r));
+  data += 64;
+  length -= 64;
+
+  while(length >= 64)
+  {
+    __m128i t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    __m128i t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    __m128i t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    __m128i t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), t1);
+    x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), t2);
+    x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), t3);
+    x4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), t4);
+    x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)(data + 0)));
+    x2 = _mm_xor_si128(x2, _mm_loadu_si128((const __m128i*)(data + 16)));
+    x3 = _mm_xor_si128(x3, _mm_loadu_si128((const __m128i*)(data + 32)));
+    x4 = _mm_xor_si128(x4, _mm_loadu_si128((const __m128i*)(data + 48)));
+    data += 64;
+    length -= 64;
+  }
+
+  /*fold the four lanes into one, then the remaining 16-byte blocks into it*/
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t), x2);
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t), x3);
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t), x4);
+  while(length >= 16)
+  {
+    t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t);
+    x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)data));
+    data += 16;
+    length -= 16;
+  }
+
+  /*128 to 64 bits*/
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+  t = _mm_srli_si128(x1, 4);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00), t);
+
+  /*Barrett reduction to 32 bits*/
+  t = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+  return (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+static unsigned updateCRC32(unsigned r, const unsigned char* data, size_t length)
+{
+  if(length >= 64 && (getCpuFeatures() & CPU_PCLMUL))
+  {
+    size_t folded = length & ~(size_t)15;
+    r = updateCRC32_fold(r, data, folded);
+    data += folded;
+    length -= folded;
+  }
+  return updateCRC32_slicing(r, data, length);
+}
+#else /*LODEPNG_SIMD_X86*/
+static unsigned updateCRC32(unsigned r, const unsigned char* data, size_t length)
+{
+  return updateCRC32_slicing(r, data, length);
+}
+#endif /*LODEPNG_SIMD_X86*/
+
+/*Return the CRC of the bytes buf[0..len-1].*/
+unsigned lodepng_crc32(const unsigned char* data, size_t length)
+{
+  return updateCRC32(0xffffffffu, data, length) ^ 0xffffffffu;
 }
 #else /* !LODEPNG_NO_COMPILE_CRC */
 unsigned lodepng_crc32(const unsigned char* data, size_t length);
@@ -2356,6 +3722,46 @@ static unsigned readBitsFromReversedStream(size_t* bitpointer, const unsigned ch
   return result;
 }
 
+/*
+Returns the input bits from bit position bp on, msb first: the bit at bp is the msb of the result. As
+loadBits, at least 56 bits are valid and zeros are read past the end.
+*/
+static unsigned long long loadBitsReversed(const unsigned char* data, size_t size, size_t bp)
+{
+  size_t p = bp >> 3;
+  unsigned long long result = 0;
+  if(p + 8 <= size)
+  {
+    const unsigned char* bytes = &data[p];
+    result = ((unsigned long long)bytes[0] << 56) | ((unsigned long long)bytes[1] << 48)
+           | ((unsigned long long)bytes[2] << 40) | ((unsigned long long)bytes[3] << 32)
+           | ((unsigned long long)bytes[4] << 24) | ((unsigned long long)bytes[5] << 16)
+           | ((unsigned long long)bytes[6] << 8) | (unsigned long long)bytes[7];
+  }
+  else
+  {
+    unsigned i;
+    for(i = 0; i != 8 && p + i < size; ++i) result |= (unsigned long long)data[p + i] << (56 - 8 * i);
+  }
+  return result << (bp & 7);
+}
+
+/*reads nbits bits (1 to 16) msb first, for sub-byte pixels. See LodePNGBitReader*/
+static LODEPNG_INLINE unsigned readBitsReversed(LodePNGBitReader* reader, unsigned nbits)
+{
+  unsigned result;
+  if(reader->numbits < nbits)
+  {
+    reader->buffer = loadBitsReversed(reader->data, reader->size, reader->bp);
+    reader->numbits = 64 - (unsigned)(reader->bp & 7);
+  }
+  result = (unsigned)(reader->buffer >> (64 - nbits));
+  reader->buffer <<= nbits;
+  reader->numbits -= nbits;
+  reader->bp += nbits;
+  return result;
+}
+
 #ifdef LODEPNG_COMPILE_DECODER
 static void setBitOfReversedStream0(size_t* bitpointer, unsigned char* bitstream, unsigned char bit)
 {
@@ -3278,10 +4684,11 @@ static void getPixelColorsRGBA8(unsigned char* buffer, size_t numpixels,
     else
     {
       unsigned highest = ((1U << mode->bitdepth) - 1U); /*highest possible value for this bit depth*/
-      size_t j = 0;
+      LodePNGBitReader reader;
+      LodePNGBitReader_init(&reader, in, (numpixels * mode->bitdepth + 7) / 8);
       for(i = 0; i != numpixels; ++i, buffer += num_channels)
       {
-        unsigned value = readBitsFromReversedStream(&j, in, mode->bitdepth);
+        unsigned value = readBitsReversed(&reader, mode->bitdepth);
         buffer[0] = buffer[1] = buffer[2] = (value * 255) / highest;
         if(has_alpha) buffer[3] = mode->key_defined && value == mode->key_r ? 0 : 255;
       }
@@ -3317,11 +4724,12 @@ static void getPixelColorsRGBA8(unsigned char* buffer, size_t numpixels,
   else if(mode->colortype == LCT_PALETTE)
   {
     unsigned index;
-    size_t j = 0;
+    LodePNGBitReader reader;
+    LodePNGBitReader_init(&reader, in, (numpixels * mode->bitdepth + 7) / 8);
     for(i = 0; i != numpixels; ++i, buffer += num_channels)
     {
       if(mode->bitdepth == 8) index = in[i];
-      else index = readBitsFromReversedStream(&j, in, mode->bitdepth);
+      else index = readBitsReversed(&reader, mode->bitdepth);
 
       if(index >= mode->palettesize)
       {
@@ -3419,84 +4827,372 @@ static void getPixelColorRGBA16(unsigned short* r, unsigned short* g, unsigned s
   }
 }
 
-unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
-                         const LodePNGColorMode* mode_out, const LodePNGColorMode* mode_in,
-                         unsigned w, unsigned h)
+/*
+Fast paths of lodepng_convert for the conversions that decoding textures needs: RGB, grey, grey with alpha and
+palette to RGBA with 8 bits per channel, and 16 to 8 bits per channel for the same color type. These go over the
+pixels without testing the color type per pixel. Palettes, and grey with less than 8 bits or a color key, go
+through a table with the RGBA color of every index or grey value (lut), so there is no branch for indices past
+the palette either. Disjoint buffers only: out may not overlap in.
+*/
+
+typedef struct FastConvert FastConvert;
+
+typedef void (*FastConvertKernel)(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                  const FastConvert* convert);
+
+struct FastConvert
+{
+  FastConvertKernel kernel;
+  unsigned bitdepth; /*of the lut indices*/
+  unsigned channels; /*of the 16 to 8 bit conversion*/
+  unsigned char lut[256 * 4]; /*RGBA color of each index*/
+};
+
+static void convertRGB8ToRGBA8(unsigned char* out, const unsigned char* in, size_t numpixels,
+                               const FastConvert* convert)
 {
   size_t i;
-  ColorTree tree;
-  size_t numpixels = w * h;
+  (void)convert;
+  for(i = 0; i != numpixels; ++i, out += 4, in += 3)
+  {
+    out[0] = in[0];
+    out[1] = in[1];
+    out[2] = in[2];
+    out[3] = 255;
+  }
+}
 
-  if(lodepng_color_mode_equal(mode_out, mode_in))
+static void convertGrey8ToRGBA8(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                const FastConvert* convert)
+{
+  size_t i;
+  (void)convert;
+  for(i = 0; i != numpixels; ++i, out += 4)
   {
-    size_t numbytes = lodepng_get_raw_size(w, h, mode_in);
-    for(i = 0; i != numbytes; ++i) out[i] = in[i];
-    return 0;
+    out[0] = out[1] = out[2] = in[i];
+    out[3] = 255;
   }
+}
 
-  if(mode_out->colortype == LCT_PALETTE)
+static void convertGreyAlpha8ToRGBA8(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                     const FastConvert* convert)
+{
+  size_t i;
+  (void)convert;
+  for(i = 0; i != numpixels; ++i, out += 4, in += 2)
   {
-    size_t palettesize = mode_out->palettesize;
-    const unsigned char* palette = mode_out->palette;
-    size_t palsize = 1u << mode_out->bitdepth;
-    /*if the user specified output palette but did not give the values, assume
-    they want the values of the input color type (assuming that one is palette).
-    Note that we never create a new palette ourselves.*/
-    if(palettesize == 0)
-    {
-      palettesize = mode_in->palettesize;
-      palette = mode_in->palette;
-    }
-    if(palettesize < palsize) palsize = palettesize;
-    color_tree_init(&tree);
-    for(i = 0; i != palsize; ++i)
-    {
-      const unsigned char* p = &palette[i * 4];
-      color_tree_add(&tree, p[0], p[1], p[2], p[3], i);
-    }
+    out[0] = out[1] = out[2] = in[0];
+    out[3] = in[1];
   }
+}
 
-  if(mode_in->bitdepth == 16 && mode_out->bitdepth == 16)
+static void convertLut8(unsigned char* out, const unsigned char* in, size_t numpixels, const FastConvert* convert)
+{
+  size_t i;
+  for(i = 0; i != numpixels; ++i) memcpy(out + i * 4, &convert->lut[in[i] * 4], 4);
+}
+
+/*1, 2 or 4 bit indices, the first pixel in the high bits of a byte as in PNG*/
+static void convertLutBits(unsigned char* out, const unsigned char* in, size_t numpixels,
+                           const FastConvert* convert)
+{
+  unsigned bitdepth = convert->bitdepth;
+  unsigned perbyte = 8 / bitdepth;
+  unsigned mask = (1u << bitdepth) - 1u;
+  size_t i = 0;
+  while(i != numpixels)
   {
-    for(i = 0; i != numpixels; ++i)
+    unsigned value = *in++;
+    unsigned shift = 8;
+    unsigned j;
+    for(j = 0; j != perbyte && i != numpixels; ++j, ++i)
     {
-      unsigned short r = 0, g = 0, b = 0, a = 0;
-      getPixelColorRGBA16(&r, &g, &b, &a, in, i, mode_in);
-      rgba16ToPixel(out, i, mode_out, r, g, b, a);
+      shift -= bitdepth;
+      memcpy(out + i * 4, &convert->lut[((value >> shift) & mask) * 4], 4);
     }
   }
-  else if(mode_out->bitdepth == 8 && mode_out->colortype == LCT_RGBA)
+}
+
+/*16 to 8 bit: the high byte of every big endian channel*/
+static void convertHighBytes(unsigned char* out, const unsigned char* in, size_t numpixels,
+                             const FastConvert* convert)
+{
+  size_t i;
+  size_t numbytes = numpixels * convert->channels;
+  for(i = 0; i != numbytes; ++i) out[i] = in[i * 2];
+}
+
+/*one kernel per conversion, a set per instruction set*/
+typedef struct ConvertKernels
+{
+  FastConvertKernel rgb8, grey8, greyalpha8, lut8, highbytes;
+} ConvertKernels;
+
+#ifdef LODEPNG_SIMD_X86
+/*4 pixels per step, the 16 byte load reads 4 bytes past them so the loop stops 6 pixels before the end*/
+LODEPNG_TARGET_SSSE3 static void convertRGB8ToRGBA8Ssse3(unsigned char* out, const unsigned char* in,
+                                                         size_t numpixels, const FastConvert* convert)
+{
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000u);
+  size_t i = 0;
+  for(; i + 6 <= numpixels; i += 4)
   {
-    getPixelColorsRGBA8(out, numpixels, 1, in, mode_in);
+    __m128i x = _mm_loadu_si128((const __m128i*)(in + i * 3));
+    _mm_storeu_si128((__m128i*)(out + i * 4), _mm_or_si128(_mm_shuffle_epi8(x, shuffle), alpha));
   }
-  else if(mode_out->bitdepth == 8 && mode_out->colortype == LCT_RGB)
+  convertRGB8ToRGBA8(out + i * 4, in + i * 3, numpixels - i, convert);
+}
+
+static void convertGrey8ToRGBA8Sse2(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                    const FastConvert* convert)
+{
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000u);
+  size_t i = 0;
+  for(; i + 16 <= numpixels; i += 16)
   {
-    getPixelColorsRGBA8(out, numpixels, 0, in, mode_in);
+    __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+    __m128i lo = _mm_unpacklo_epi8(x, x);
+    __m128i hi = _mm_unpackhi_epi8(x, x);
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 0), _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 16), _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 32), _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 48), _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
   }
-  else
+  convertGrey8ToRGBA8(out + i * 4, in + i, numpixels - i, convert);
+}
+
+static void convertGreyAlpha8ToRGBA8Sse2(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                         const FastConvert* convert)
+{
+  const __m128i low = _mm_set1_epi16(0xff);
+  size_t i = 0;
+  for(; i + 8 <= numpixels; i += 8)
   {
-    unsigned char r = 0, g = 0, b = 0, a = 0;
-    for(i = 0; i != numpixels; ++i)
-    {
-      getPixelColorRGBA8(&r, &g, &b, &a, in, i, mode_in);
-      CERROR_TRY_RETURN(rgba8ToPixel(out, i, mode_out, &tree, r, g, b, a));
-    }
+    __m128i x = _mm_loadu_si128((const __m128i*)(in + i * 2)); /*grey, alpha per 16-bit lane*/
+    __m128i grey = _mm_and_si128(x, low);
+    grey = _mm_or_si128(grey, _mm_slli_epi16(grey, 8)); /*grey, grey*/
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 0), _mm_unpacklo_epi16(grey, x));
+    _mm_storeu_si128((__m128i*)(out + i * 4 + 16), _mm_unpackhi_epi16(grey, x));
   }
+  convertGreyAlpha8ToRGBA8(out + i * 4, in + i * 2, numpixels - i, convert);
+}
 
-  if(mode_out->colortype == LCT_PALETTE)
+/*8 table lookups in one gather*/
+LODEPNG_TARGET_AVX2 static void convertLut8Avx2(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                                const FastConvert* convert)
+{
+  const int* lut = (const int*)convert->lut;
+  size_t i = 0;
+  for(; i + 8 <= numpixels; i += 8)
   {
-    color_tree_cleanup(&tree);
+    __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+    _mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_i32gather_epi32(lut, index, 4));
   }
-
-  return 0; /*no error*/
+  convertLut8(out + i * 4, in + i, numpixels - i, convert);
 }
 
-#ifdef LODEPNG_COMPILE_ENCODER
-
-void lodepng_color_profile_init(LodePNGColorProfile* profile)
+/*the big endian high bytes are the low bytes of the 16-bit lanes, packus keeps those*/
+static void convertHighBytesSse2(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                 const FastConvert* convert)
 {
-  profile->colored = 0;
-  profile->key = 0;
+  const __m128i low = _mm_set1_epi16(0xff);
+  size_t numbytes = numpixels * convert->channels;
+  size_t i = 0;
+  for(; i + 16 <= numbytes; i += 16)
+  {
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 2)), low);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 2 + 16)), low);
+    _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(a, b));
+  }
+  i /= convert->channels; /*the tail restarts at a whole pixel, redoing at most two bytes*/
+  convertHighBytes(out + i * convert->channels, in + i * convert->channels * 2, numpixels - i, convert);
+}
+
+static const ConvertKernels convertKernelsSse2 = {
+  convertRGB8ToRGBA8, convertGrey8ToRGBA8Sse2, convertGreyAlpha8ToRGBA8Sse2, convertLut8, convertHighBytesSse2
+};
+
+static const ConvertKernels convertKernelsSsse3 = {
+  convertRGB8ToRGBA8Ssse3, convertGrey8ToRGBA8Sse2, convertGreyAlpha8ToRGBA8Sse2, convertLut8,
+  convertHighBytesSse2
+};
+
+static const ConvertKernels convertKernelsAvx2 = {
+  convertRGB8ToRGBA8Ssse3, convertGrey8ToRGBA8Sse2, convertGreyAlpha8ToRGBA8Sse2, convertLut8Avx2,
+  convertHighBytesSse2
+};
+
+static const ConvertKernels* getConvertKernels(void)
+{
+  int features = getCpuFeatures();
+  if(features & CPU_AVX2) return &convertKernelsAvx2;
+  if(features & CPU_SSSE3) return &convertKernelsSsse3;
+  return &convertKernelsSse2;
+}
+#else /*LODEPNG_SIMD_X86*/
+static const ConvertKernels convertKernelsC = {
+  convertRGB8ToRGBA8, convertGrey8ToRGBA8, convertGreyAlpha8ToRGBA8, convertLut8, convertHighBytes
+};
+
+static const ConvertKernels* getConvertKernels(void)
+{
+  return &convertKernelsC;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
+/*the lut for palette or grey input with at most 8 bits, colors like getPixelColorsRGBA8 gives them*/
+static void makeConvertLut(unsigned char* lut, const LodePNGColorMode* mode_in)
+{
+  unsigned i;
+  unsigned highest = (1u << mode_in->bitdepth) - 1u; /*highest grey value for this bit depth*/
+  for(i = 0; i != 256; ++i)
+  {
+    unsigned char* color = &lut[i * 4];
+    if(mode_in->colortype == LCT_PALETTE)
+    {
+      /*indices past the palette are black, see getPixelColorsRGBA8*/
+      if(i < mode_in->palettesize) memcpy(color, &mode_in->palette[i * 4], 4);
+      else
+      {
+        color[0] = color[1] = color[2] = 0;
+        color[3] = 255;
+      }
+    }
+    else
+    {
+      color[0] = color[1] = color[2] = i <= highest ? (i * 255) / highest : 0;
+      color[3] = mode_in->key_defined && i == mode_in->key_r ? 0 : 255;
+    }
+  }
+}
+
+/*prepares convert for the conversion and returns 1, or returns 0 if there's no fast path for it*/
+static unsigned fastConvertInit(FastConvert* convert, const LodePNGColorMode* mode_out,
+                                const LodePNGColorMode* mode_in)
+{
+  const ConvertKernels* kernels = getConvertKernels();
+  LodePNGColorType colortype = mode_in->colortype;
+  unsigned bitdepth = mode_in->bitdepth;
+
+  convert->kernel = 0;
+  convert->bitdepth = bitdepth;
+  convert->channels = lodepng_get_channels(mode_in);
+  if(colortype == mode_out->colortype && colortype != LCT_PALETTE && bitdepth == 16 && mode_out->bitdepth == 8)
+  {
+    /*the key of the input has no effect: without alpha channel in the output it's dropped by any conversion*/
+    convert->kernel = kernels->highbytes;
+  }
+  else if(mode_out->colortype == LCT_RGBA && mode_out->bitdepth == 8)
+  {
+    if(colortype == LCT_RGB && bitdepth == 8 && !mode_in->key_defined) convert->kernel = kernels->rgb8;
+    else if(colortype == LCT_GREY && bitdepth == 8 && !mode_in->key_defined) convert->kernel = kernels->grey8;
+    else if(colortype == LCT_GREY_ALPHA && bitdepth == 8) convert->kernel = kernels->greyalpha8;
+    else if(colortype == LCT_PALETTE || (colortype == LCT_GREY && bitdepth <= 8))
+    {
+      makeConvertLut(convert->lut, mode_in);
+      convert->kernel = bitdepth == 8 ? kernels->lut8 : convertLutBits;
+    }
+  }
+  return convert->kernel != 0;
+}
+
+#if defined(LODEPNG_COMPILE_DECODER) && defined(LODEPNG_COMPILE_ZLIB)
+/*converts w pixels with the fast path prepared in convert, or with lodepng_convert if there's none*/
+static unsigned convertRow(unsigned char* out, const unsigned char* in, const FastConvert* convert,
+                           const LodePNGColorMode* mode_out, const LodePNGColorMode* mode_in, unsigned w)
+{
+  if(!convert->kernel) return lodepng_convert(out, in, mode_out, mode_in, w, 1);
+  convert->kernel(out, in, w, convert);
+  return 0;
+}
+#endif /* defined(LODEPNG_COMPILE_DECODER) && defined(LODEPNG_COMPILE_ZLIB) */
+
+unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
+                         const LodePNGColorMode* mode_out, const LodePNGColorMode* mode_in,
+                         unsigned w, unsigned h)
+{
+  size_t i;
+  ColorTree tree;
+  FastConvert convert;
+  size_t numpixels = w * h;
+
+  if(lodepng_color_mode_equal(mode_out, mode_in))
+  {
+    size_t numbytes = lodepng_get_raw_size(w, h, mode_in);
+    for(i = 0; i != numbytes; ++i) out[i] = in[i];
+    return 0;
+  }
+
+  if(fastConvertInit(&convert, mode_out, mode_in))
+  {
+    convert.kernel(out, in, numpixels, &convert);
+    return 0;
+  }
+
+  if(mode_out->colortype == LCT_PALETTE)
+  {
+    size_t palettesize = mode_out->palettesize;
+    const unsigned char* palette = mode_out->palette;
+    size_t palsize = 1u << mode_out->bitdepth;
+    /*if the user specified output palette but did not give the values, assume
+    they want the values of the input color type (assuming that one is palette).
+    Note that we never create a new palette ourselves.*/
+    if(palettesize == 0)
+    {
+      palettesize = mode_in->palettesize;
+      palette = mode_in->palette;
+    }
+    if(palettesize < palsize) palsize = palettesize;
+    color_tree_init(&tree);
+    for(i = 0; i != palsize; ++i)
+    {
+      const unsigned char* p = &palette[i * 4];
+      color_tree_add(&tree, p[0], p[1], p[2], p[3], i);
+    }
+  }
+
+  if(mode_in->bitdepth == 16 && mode_out->bitdepth == 16)
+  {
+    for(i = 0; i != numpixels; ++i)
+    {
+      unsigned short r = 0, g = 0, b = 0, a = 0;
+      getPixelColorRGBA16(&r, &g, &b, &a, in, i, mode_in);
+      rgba16ToPixel(out, i, mode_out, r, g, b, a);
+    }
+  }
+  else if(mode_out->bitdepth == 8 && mode_out->colortype == LCT_RGBA)
+  {
+    getPixelColorsRGBA8(out, numpixels, 1, in, mode_in);
+  }
+  else if(mode_out->bitdepth == 8 && mode_out->colortype == LCT_RGB)
+  {
+    getPixelColorsRGBA8(out, numpixels, 0, in, mode_in);
+  }
+  else
+  {
+    unsigned char r = 0, g = 0, b = 0, a = 0;
+    for(i = 0; i != numpixels; ++i)
+    {
+      getPixelColorRGBA8(&r, &g, &b, &a, in, i, mode_in);
+      CERROR_TRY_RETURN(rgba8ToPixel(out, i, mode_out, &tree, r, g, b, a));
+    }
+  }
+
+  if(mode_out->colortype == LCT_PALETTE)
+  {
+    color_tree_cleanup(&tree);
+  }
+
+  return 0; /*no error*/
+}
+
+#ifdef LODEPNG_COMPILE_ENCODER
+
+void lodepng_color_profile_init(LodePNGColorProfile* profile)
+{
+  profile->colored = 0;
+  profile->key = 0;
   profile->alpha = 0;
   profile->key_r = profile->key_g = profile->key_b = 0;
   profile->numcolors = 0;
@@ -3896,6 +5592,279 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SIMD_X86
+/*
+SIMD unfiltering for x86. Up is independent per byte and is done 16 (SSE2) or 32 (AVX2) bytes at a time.
+Sub, Average and Paeth depend on the pixel to the left: Sub is a prefix sum, done on 4 (bpp 3) or 4 to 8
+(bpp 4) pixels per step, Average and Paeth go pixel by pixel with all channels of a pixel in one register.
+The kernels handle bytewidth 3 and 4 (8-bit RGB and RGBA), which is what the textures use; other formats and
+the first scanline (no precon) use the C code in unfilterScanline, which gives the same result.
+recon and scanline may be the same buffer: every byte of scanline is read before its recon byte is written.
+*/
+
+typedef void (*UnfilterKernel)(unsigned char* recon, const unsigned char* scanline,
+                               const unsigned char* precon, size_t length);
+
+/*one kernel per filter type and bytewidth, a set per instruction set (a NEON set would be another table)*/
+typedef struct UnfilterKernels
+{
+  UnfilterKernel sub3, sub4, up, average3, average4, paeth3, paeth4;
+} UnfilterKernels;
+
+static LODEPNG_INLINE __m128i load3(const unsigned char* p)
+{
+  int value = p[0] | (p[1] << 8) | (p[2] << 16);
+  return _mm_cvtsi32_si128(value);
+}
+
+static LODEPNG_INLINE __m128i load4(const unsigned char* p)
+{
+  int value;
+  memcpy(&value, p, 4);
+  return _mm_cvtsi32_si128(value);
+}
+
+static LODEPNG_INLINE void store3(unsigned char* p, __m128i v)
+{
+  int value = _mm_cvtsi128_si32(v);
+  p[0] = (unsigned char)value;
+  p[1] = (unsigned char)(value >> 8);
+  p[2] = (unsigned char)(value >> 16);
+}
+
+static LODEPNG_INLINE void store4(unsigned char* p, __m128i v)
+{
+  int value = _mm_cvtsi128_si32(v);
+  memcpy(p, &value, 4);
+}
+
+/*finishes a scanline from byte i on with the C code, for the bytes the kernels leave over*/
+static void unfilterTail(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                         size_t bytewidth, unsigned char filterType, size_t i, size_t length)
+{
+  /*precon is only read by filter types 2 to 4, Sub kernels also run for the first scanline*/
+  for(; i < length; ++i)
+  {
+    unsigned char left = i >= bytewidth ? recon[i - bytewidth] : 0;
+    switch(filterType)
+    {
+      case 1: recon[i] = scanline[i] + left; break;
+      case 2: recon[i] = scanline[i] + precon[i]; break;
+      case 3: recon[i] = scanline[i] + ((left + precon[i]) >> 1); break;
+      default: recon[i] = scanline[i] + paethPredictor(left, precon[i], i >= bytewidth ? precon[i - bytewidth] : 0);
+    }
+  }
+}
+
+static void unfilterSub3Sse2(unsigned char* recon, const unsigned char* scanline,
+                             const unsigned char* precon, size_t length)
+{
+  /*4 pixels (12 bytes) per step: prefix sum over the pixels, plus the last pixel of the previous step*/
+  __m128i carry = _mm_setzero_si128();
+  const __m128i mask = _mm_cvtsi32_si128(0xffffff);
+  size_t i = 0;
+  (void)precon;
+  for(; i + 16 <= length; i += 12)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+    x = _mm_add_epi8(x, carry);
+    _mm_storel_epi64((__m128i*)(recon + i), x);
+    store4(recon + i + 8, _mm_srli_si128(x, 8));
+    carry = _mm_and_si128(_mm_srli_si128(x, 9), mask);
+    carry = _mm_or_si128(carry, _mm_slli_si128(carry, 3));
+    carry = _mm_or_si128(carry, _mm_slli_si128(carry, 6));
+  }
+  unfilterTail(recon, scanline, precon, 3, 1, i, length);
+}
+
+static void unfilterSub4Sse2(unsigned char* recon, const unsigned char* scanline,
+                             const unsigned char* precon, size_t length)
+{
+  /*4 pixels per step: prefix sum over the pixels, plus the last pixel of the previous step*/
+  __m128i carry = _mm_setzero_si128();
+  size_t i = 0;
+  (void)precon;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, carry);
+    _mm_storeu_si128((__m128i*)(recon + i), x);
+    carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  unfilterTail(recon, scanline, precon, 4, 1, i, length);
+}
+
+static void unfilterUpSse2(unsigned char* recon, const unsigned char* scanline,
+                           const unsigned char* precon, size_t length)
+{
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(precon + i));
+    _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(x, b));
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+/*the average of a and b rounded down, _mm_avg_epu8 rounds up*/
+static LODEPNG_INLINE __m128i averageFloor(__m128i a, __m128i b)
+{
+  __m128i odd = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1));
+  return _mm_sub_epi8(_mm_avg_epu8(a, b), odd);
+}
+
+static void unfilterAverage3Sse2(unsigned char* recon, const unsigned char* scanline,
+                                 const unsigned char* precon, size_t length)
+{
+  __m128i a = _mm_setzero_si128(); /*the reconstructed pixel to the left*/
+  size_t i = 0;
+  /*4-byte loads: stop while the last pixel still has a byte after it*/
+  for(; i + 4 <= length; i += 3)
+  {
+    __m128i b = load4(precon + i);
+    a = _mm_add_epi8(load4(scanline + i), averageFloor(a, b));
+    store3(recon + i, a);
+  }
+  unfilterTail(recon, scanline, precon, 3, 3, i, length);
+}
+
+static void unfilterAverage4Sse2(unsigned char* recon, const unsigned char* scanline,
+                                 const unsigned char* precon, size_t length)
+{
+  __m128i a = _mm_setzero_si128();
+  size_t i = 0;
+  for(; i + 4 <= length; i += 4)
+  {
+    __m128i b = load4(precon + i);
+    a = _mm_add_epi8(load4(scanline + i), averageFloor(a, b));
+    store4(recon + i, a);
+  }
+  unfilterTail(recon, scanline, precon, 4, 3, i, length);
+}
+
+/*
+Paeth predictor of one pixel per register, channels as 16-bit lanes. abs is passed in so SSE2 and SSSE3
+share the code: a, b, c are the left, up and up-left pixels.
+*/
+#define PAETH_PREDICT(result, a, b, c, ABS)\
+{\
+  __m128i pa = ABS(_mm_sub_epi16(b, c));\
+  __m128i pb = ABS(_mm_sub_epi16(a, c));\
+  __m128i pc = ABS(_mm_add_epi16(_mm_sub_epi16(b, c), _mm_sub_epi16(a, c)));\
+  /*c if pc is smallest, else b if pb < pa, else a (the order of the C code)*/\
+  __m128i usec = _mm_and_si128(_mm_cmplt_epi16(pc, pa), _mm_cmplt_epi16(pc, pb));\
+  __m128i useb = _mm_andnot_si128(usec, _mm_cmplt_epi16(pb, pa));\
+  __m128i usea = _mm_andnot_si128(_mm_or_si128(usec, useb), _mm_set1_epi16(-1));\
+  result = _mm_or_si128(_mm_or_si128(_mm_and_si128(usec, c), _mm_and_si128(useb, b)), _mm_and_si128(usea, a));\
+}
+
+static LODEPNG_INLINE __m128i abs16Sse2(__m128i x)
+{
+  return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+#define PAETH_KERNEL(name, bpp, LOAD, STORE, ABS, TARGET)\
+TARGET static void name(unsigned char* recon, const unsigned char* scanline,\
+                        const unsigned char* precon, size_t length)\
+{\
+  const __m128i zero = _mm_setzero_si128();\
+  __m128i a = zero, c = zero; /*left and up-left, 16 bits per channel*/\
+  size_t i = 0;\
+  for(; i + 4 <= length; i += bpp)\
+  {\
+    __m128i b = _mm_unpacklo_epi8(LOAD(precon + i), zero);\
+    __m128i predictor, x;\
+    PAETH_PREDICT(predictor, a, b, c, ABS);\
+    x = _mm_add_epi8(LOAD(scanline + i), _mm_packus_epi16(predictor, predictor));\
+    STORE(recon + i, x);\
+    a = _mm_unpacklo_epi8(x, zero);\
+    c = b;\
+  }\
+  unfilterTail(recon, scanline, precon, bpp, 4, i, length);\
+}
+
+PAETH_KERNEL(unfilterPaeth3Sse2, 3, load4, store3, abs16Sse2, )
+PAETH_KERNEL(unfilterPaeth4Sse2, 4, load4, store4, abs16Sse2, )
+PAETH_KERNEL(unfilterPaeth3Ssse3, 3, load4, store3, _mm_abs_epi16, LODEPNG_TARGET_SSSE3)
+PAETH_KERNEL(unfilterPaeth4Ssse3, 4, load4, store4, _mm_abs_epi16, LODEPNG_TARGET_SSSE3)
+
+LODEPNG_TARGET_AVX2 static void unfilterUpAvx2(unsigned char* recon, const unsigned char* scanline,
+                                               const unsigned char* precon, size_t length)
+{
+  size_t i = 0;
+  for(; i + 32 <= length; i += 32)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(scanline + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(precon + i));
+    _mm256_storeu_si256((__m256i*)(recon + i), _mm256_add_epi8(x, b));
+  }
+  for(; i < length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+LODEPNG_TARGET_AVX2 static void unfilterSub4Avx2(unsigned char* recon, const unsigned char* scanline,
+                                                 const unsigned char* precon, size_t length)
+{
+  /*8 pixels per step: prefix sums in each 128-bit lane, then the low lane's last pixel into the high lane*/
+  __m256i carry = _mm256_setzero_si256();
+  size_t i = 0;
+  for(; i + 32 <= length; i += 32)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(scanline + i));
+    __m256i last;
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 8));
+    last = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    x = _mm256_add_epi8(x, _mm256_permute2x128_si256(last, last, 0x08)); /*low lane 0, high lane gets low*/
+    x = _mm256_add_epi8(x, carry);
+    _mm256_storeu_si256((__m256i*)(recon + i), x);
+    last = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    carry = _mm256_permute2x128_si256(last, last, 0x11); /*both lanes get the high lane*/
+  }
+  unfilterTail(recon, scanline, precon, 4, 1, i, length);
+}
+
+static const UnfilterKernels unfilterKernelsSse2 = {
+  unfilterSub3Sse2, unfilterSub4Sse2, unfilterUpSse2, unfilterAverage3Sse2, unfilterAverage4Sse2,
+  unfilterPaeth3Sse2, unfilterPaeth4Sse2
+};
+
+static const UnfilterKernels unfilterKernelsSsse3 = {
+  unfilterSub3Sse2, unfilterSub4Sse2, unfilterUpSse2, unfilterAverage3Sse2, unfilterAverage4Sse2,
+  unfilterPaeth3Ssse3, unfilterPaeth4Ssse3
+};
+
+static const UnfilterKernels unfilterKernelsAvx2 = {
+  unfilterSub3Sse2, unfilterSub4Avx2, unfilterUpAvx2, unfilterAverage3Sse2, unfilterAverage4Sse2,
+  unfilterPaeth3Ssse3, unfilterPaeth4Ssse3
+};
+
+static const UnfilterKernels* getUnfilterKernels(void)
+{
+  int features = getCpuFeatures();
+  if(features & CPU_AVX2) return &unfilterKernelsAvx2;
+  if(features & CPU_SSSE3) return &unfilterKernelsSsse3;
+  return &unfilterKernelsSse2;
+}
+
+/*returns the kernel for the filter type and bytewidth, or 0 if the C code handles it*/
+static UnfilterKernel selectUnfilterKernel(size_t bytewidth, unsigned char filterType, const unsigned char* precon)
+{
+  const UnfilterKernels* kernels = getUnfilterKernels();
+  if(filterType == 2) return precon ? kernels->up : 0;
+  if(bytewidth != 3 && bytewidth != 4) return 0;
+  if(filterType == 1) return bytewidth == 3 ? kernels->sub3 : kernels->sub4;
+  if(!precon) return 0;
+  if(filterType == 3) return bytewidth == 3 ? kernels->average3 : kernels->average4;
+  if(filterType == 4) return bytewidth == 3 ? kernels->paeth3 : kernels->paeth4;
+  return 0;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length)
 {
@@ -3909,6 +5878,14 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SIMD_X86
+  UnfilterKernel kernel = selectUnfilterKernel(bytewidth, filterType, precon);
+  if(kernel)
+  {
+    kernel(recon, scanline, precon, length);
+    return 0;
+  }
+#endif /*LODEPNG_SIMD_X86*/
   switch(filterType)
   {
     case 0:
@@ -4448,44 +6425,125 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
-/*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize)
+static unsigned checkPixelCount(unsigned w, unsigned h)
+{
+  size_t numpixels = (size_t)w * h;
+  /*multiplication overflow*/
+  if(h != 0 && numpixels / h != w) return 92;
+  /*multiplication overflow possible further below. Allows up to 2^31-1 pixel
+  bytes with 16-bit RGBA, the rest is room for filter bytes.*/
+  if(numpixels > 268435455) return 92;
+  return 0;
+}
+
+/*
+reads a chunk other than IDAT and IEND into state->info_png. critical_pos is where unknown chunks are remembered
+(1 = after IHDR, 2 = after PLTE, 3 = after IDAT), unknown is set to 1 at the first unknown chunk.
+*/
+static unsigned readChunk(LodePNGState* state, const unsigned char* chunk, unsigned* critical_pos, unsigned* unknown)
+{
+  unsigned error = 0;
+  unsigned chunkLength = lodepng_chunk_length(chunk);
+  const unsigned char* data = lodepng_chunk_data_const(chunk);
+#ifndef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+  (void)critical_pos;
+#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+
+  /*palette chunk (PLTE)*/
+  if(lodepng_chunk_type_equals(chunk, "PLTE"))
+  {
+    error = readChunk_PLTE(&state->info_png.color, data, chunkLength);
+#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+    *critical_pos = 2;
+#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+  }
+  /*palette transparency chunk (tRNS)*/
+  else if(lodepng_chunk_type_equals(chunk, "tRNS"))
+  {
+    error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
+  }
+#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+  /*background color chunk (bKGD)*/
+  else if(lodepng_chunk_type_equals(chunk, "bKGD"))
+  {
+    error = readChunk_bKGD(&state->info_png, data, chunkLength);
+  }
+  /*text chunk (tEXt)*/
+  else if(lodepng_chunk_type_equals(chunk, "tEXt"))
+  {
+    if(state->decoder.read_text_chunks)
+    {
+      error = readChunk_tEXt(&state->info_png, data, chunkLength);
+    }
+  }
+  /*compressed text chunk (zTXt)*/
+  else if(lodepng_chunk_type_equals(chunk, "zTXt"))
+  {
+    if(state->decoder.read_text_chunks)
+    {
+      error = readChunk_zTXt(&state->info_png, &state->decoder.zlibsettings, data, chunkLength);
+    }
+  }
+  /*international text chunk (iTXt)*/
+  else if(lodepng_chunk_type_equals(chunk, "iTXt"))
+  {
+    if(state->decoder.read_text_chunks)
+    {
+      error = readChunk_iTXt(&state->info_png, &state->decoder.zlibsettings, data, chunkLength);
+    }
+  }
+  else if(lodepng_chunk_type_equals(chunk, "tIME"))
+  {
+    error = readChunk_tIME(&state->info_png, data, chunkLength);
+  }
+  else if(lodepng_chunk_type_equals(chunk, "pHYs"))
+  {
+    error = readChunk_pHYs(&state->info_png, data, chunkLength);
+  }
+#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+  else /*it's not an implemented chunk type, so ignore it: skip over the data*/
+  {
+    /*error: unknown critical chunk (5th bit of first byte of chunk type is 0)*/
+    if(!lodepng_chunk_ancillary(chunk)) return 69;
+
+    *unknown = 1;
+#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+    if(state->decoder.remember_unknown_chunks)
+    {
+      error = lodepng_chunk_append(&state->info_png.unknown_chunks_data[*critical_pos - 1],
+                                   &state->info_png.unknown_chunks_size[*critical_pos - 1], chunk);
+    }
+#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+  }
+  return error;
+}
+
+/*
+read the header and all chunks of a PNG. zdata and zsize receive the zlib data: the data of the IDAT chunk
+itself when there is only one, else the data of all IDAT chunks concatenated in idat.
+*/
+static void decodeChunks(ucvector* idat, const unsigned char** zdata, size_t* zsize,
+                         unsigned* w, unsigned* h,
+                         LodePNGState* state,
+                         const unsigned char* in, size_t insize)
 {
   unsigned char IEND = 0;
   const unsigned char* chunk;
-  size_t i;
-  ucvector idat; /*the data from idat chunks*/
-  ucvector scanlines;
-  size_t predict;
-  size_t numpixels;
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
-
-  /*provide some proper output values if error will happen*/
-  *out = 0;
 
   state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
   if(state->error) return;
+  state->error = checkPixelCount(*w, *h);
+  if(state->error) return;
 
-  numpixels = *w * *h;
-
-  /*multiplication overflow*/
-  if(*h != 0 && numpixels / *h != *w) CERROR_RETURN(state->error, 92);
-  /*multiplication overflow possible further below. Allows up to 2^31-1 pixel
-  bytes with 16-bit RGBA, the rest is room for filter bytes.*/
-  if(numpixels > 268435455) CERROR_RETURN(state->error, 92);
-
-  ucvector_init(&idat);
   chunk = &in[33]; /*first byte of the first chunk after the header*/
+  *zdata = 0;
+  *zsize = 0;
 
-  /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk.
-  IDAT data is put at the start of the in buffer*/
+  /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk*/
   while(!IEND && !state->error)
   {
     unsigned chunkLength;
@@ -4509,187 +6567,557 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     /*IDAT chunk, containing compressed image data*/
     if(lodepng_chunk_type_equals(chunk, "IDAT"))
     {
-      size_t oldsize = idat.size;
-      if(!ucvector_resize(&idat, oldsize + chunkLength)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
-      for(i = 0; i != chunkLength; ++i) idat.data[oldsize + i] = data[i];
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+      if(*zsize == 0)
+      {
+        /*inflate reads the data in place unless more IDAT chunks follow*/
+        *zdata = data;
+        *zsize = chunkLength;
+      }
+      else
+      {
+        size_t oldsize = *zsize;
+        unsigned first = idat->size == 0; /*so far the first chunk was only referenced*/
+        if(!ucvector_resize(idat, oldsize + chunkLength)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+        if(first) memcpy(idat->data, *zdata, oldsize);
+        if(chunkLength != 0) memcpy(idat->data + oldsize, data, chunkLength);
+        *zdata = idat->data;
+        *zsize = idat->size;
+      }
       critical_pos = 3;
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     }
     /*IEND chunk*/
     else if(lodepng_chunk_type_equals(chunk, "IEND"))
     {
       IEND = 1;
     }
-    /*palette chunk (PLTE)*/
-    else if(lodepng_chunk_type_equals(chunk, "PLTE"))
+    else
     {
-      state->error = readChunk_PLTE(&state->info_png.color, data, chunkLength);
+      state->error = readChunk(state, chunk, &critical_pos, &unknown);
       if(state->error) break;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-      critical_pos = 2;
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     }
-    /*palette transparency chunk (tRNS)*/
-    else if(lodepng_chunk_type_equals(chunk, "tRNS"))
+
+    if(!state->decoder.ignore_crc && !unknown) /*check CRC if wanted, only on known chunk types*/
     {
-      state->error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
-      if(state->error) break;
+      if(lodepng_chunk_check_crc(chunk)) CERROR_BREAK(state->error, 57); /*invalid CRC*/
     }
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-    /*background color chunk (bKGD)*/
-    else if(lodepng_chunk_type_equals(chunk, "bKGD"))
+
+    if(!IEND) chunk = lodepng_chunk_next_const(chunk);
+  }
+}
+
+/*predict the decompressed size of the IDAT data: the scanlines with their filter bytes.
+If the decompressed size does not match the prediction, the image must be corrupt.*/
+static size_t predictIdatSize(unsigned w, unsigned h, const LodePNGInfo* info_png)
+{
+  size_t predict;
+  if(info_png->interlace_method == 0)
+  {
+    /*The extra h is added because this are the filter bytes every scanline starts with*/
+    predict = lodepng_get_raw_size_idat(w, h, &info_png->color) + h;
+  }
+  else
+  {
+    /*Adam-7 interlaced: predicted size is the sum of the 7 sub-images sizes*/
+    const LodePNGColorMode* color = &info_png->color;
+    predict = 0;
+    predict += lodepng_get_raw_size_idat((w + 7) >> 3, (h + 7) >> 3, color) + ((h + 7) >> 3);
+    if(w > 4) predict += lodepng_get_raw_size_idat((w + 3) >> 3, (h + 7) >> 3, color) + ((h + 7) >> 3);
+    predict += lodepng_get_raw_size_idat((w + 3) >> 2, (h + 3) >> 3, color) + ((h + 3) >> 3);
+    if(w > 2) predict += lodepng_get_raw_size_idat((w + 1) >> 2, (h + 3) >> 2, color) + ((h + 3) >> 2);
+    predict += lodepng_get_raw_size_idat((w + 1) >> 1, (h + 1) >> 2, color) + ((h + 1) >> 2);
+    if(w > 1) predict += lodepng_get_raw_size_idat((w + 0) >> 1, (h + 1) >> 1, color) + ((h + 1) >> 1);
+    predict += lodepng_get_raw_size_idat((w + 0), (h + 0) >> 1, color) + ((h + 0) >> 1);
+  }
+  return predict;
+}
+
+/*the raw color mode of the decoded image: info_raw, or the PNG's own without color conversion*/
+static const LodePNGColorMode* decodedColorMode(const LodePNGState* state)
+{
+  if(!state->decoder.color_convert) return &state->info_png.color;
+  return &state->info_raw;
+}
+
+size_t lodepng_get_decoded_size(unsigned w, unsigned h, const LodePNGState* state)
+{
+  return lodepng_get_raw_size(w, h, decodedColorMode(state));
+}
+
+void lodepng_decode_arena_init(LodePNGDecodeArena* arena)
+{
+  arena->idat = arena->scanlines = arena->image = 0;
+  arena->idatsize = arena->scanlinessize = arena->imagesize = 0;
+}
+
+void lodepng_decode_arena_cleanup(LodePNGDecodeArena* arena)
+{
+  lodepng_free(arena->idat);
+  lodepng_free(arena->scanlines);
+  lodepng_free(arena->image);
+  lodepng_decode_arena_init(arena);
+}
+
+/*sets convert to whether the image is converted from the PNG's color mode to info_raw, which must be supported*/
+static unsigned checkConversion(unsigned* convert, const LodePNGState* state)
+{
+  *convert = state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+  /*TODO: check if this works according to the statement in the documentation: "The converter can convert
+  from greyscale input color type, to 8-bit greyscale or greyscale with alpha"*/
+  if(*convert && !(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+     && !(state->info_raw.bitdepth == 8))
+  {
+    return 56; /*unsupported color mode conversion*/
+  }
+  return 0;
+}
+
+/*inflate the zlib data of the IDAT chunks into scanlines, which must come out with the predicted size*/
+static unsigned inflateScanlines(ucvector* scanlines, const unsigned char* zdata, size_t zsize, size_t predict,
+                                 const LodePNGDecompressSettings* settings)
+{
+  unsigned error;
+#ifdef LODEPNG_COMPILE_ZLIB
+  if(!settings->custom_zlib && !settings->custom_inflate)
+  {
+    /*with room for the longest match past the prediction, inflate never has to move the data: it stops with
+    an error if the output grows past the prediction*/
+    InflateProgress progress;
+    progress.max_size = predict;
+    progress.step = 0;
+    progress.next = (size_t)(-1);
+    progress.report = 0;
+    progress.context = 0;
+    if(!ucvector_reserve(scanlines, predict + MAX_MATCH_LENGTH)) return 83; /*alloc fail*/
+    error = zlib_decompressv(scanlines, zdata, zsize, settings, &progress);
+  }
+  else
+#endif /*LODEPNG_COMPILE_ZLIB*/
+  {
+    if(!ucvector_reserve(scanlines, predict)) return 83; /*alloc fail*/
+    error = zlib_decompress(&scanlines->data, &scanlines->size, zdata, zsize, settings);
+    /*a custom decoder may have reallocated the buffer, but it has at least this size*/
+    scanlines->allocsize = scanlines->size;
+  }
+  if(!error && scanlines->size != predict) error = 91; /*decompressed size doesn't match prediction*/
+  return error;
+}
+
+/*
+Decode a PNG into *out, which is allocated here if it is NULL. Besides out, only the inflated scanlines are
+kept in memory (plus the deinterlaced image for Adam7 with color conversion): without conversion they are
+unfiltered straight into out, with conversion they are unfiltered in place and converted into out. A PNG
+with a single IDAT chunk is inflated from the input directly. The scratch buffers come from the arena and
+go back to it, grown if needed.
+*/
+static void decodeImage(unsigned char** out, size_t outsize, unsigned* w, unsigned* h,
+                        LodePNGState* state,
+                        const unsigned char* in, size_t insize,
+                        LodePNGDecodeArena* arena)
+{
+  LodePNGDecodeArena temp;
+  ucvector idat, scanlines, image;
+  const unsigned char* zdata;
+  size_t zsize;
+  unsigned convert = 0;
+  size_t rawsize = 0;
+
+  if(!arena)
+  {
+    lodepng_decode_arena_init(&temp);
+    arena = &temp;
+  }
+  ucvector_init_reuse(&idat, arena->idat, arena->idatsize);
+  ucvector_init_reuse(&scanlines, arena->scanlines, arena->scanlinessize);
+  ucvector_init_reuse(&image, arena->image, arena->imagesize);
+
+  decodeChunks(&idat, &zdata, &zsize, w, h, state, in, insize);
+
+  if(!state->error) state->error = checkConversion(&convert, state);
+  if(!state->error)
+  {
+    rawsize = lodepng_get_decoded_size(*w, *h, state);
+    if(!*out)
     {
-      state->error = readChunk_bKGD(&state->info_png, data, chunkLength);
-      if(state->error) break;
+      *out = (unsigned char*)lodepng_malloc(rawsize);
+      if(!*out) state->error = 83; /*alloc fail*/
     }
-    /*text chunk (tEXt)*/
-    else if(lodepng_chunk_type_equals(chunk, "tEXt"))
+    else if(outsize < rawsize) state->error = 95; /*output buffer too small*/
+  }
+  if(!state->error)
+  {
+    state->error = inflateScanlines(&scanlines, zdata, zsize, predictIdatSize(*w, *h, &state->info_png),
+                                    &state->decoder.zlibsettings);
+  }
+  if(!state->error)
+  {
+    if(!convert)
     {
-      if(state->decoder.read_text_chunks)
+      if(lodepng_get_bpp(&state->info_png.color) < 8)
       {
-        state->error = readChunk_tEXt(&state->info_png, data, chunkLength);
-        if(state->error) break;
+        /*Adam7 with less than 8 bits per pixel only sets the 1-bits, else only the unused bits at the end
+        of the last byte are never written*/
+        if(state->info_png.interlace_method != 0) memset(*out, 0, rawsize);
+        else (*out)[rawsize - 1] = 0;
       }
+      state->error = postProcessScanlines(*out, scanlines.data, *w, *h, &state->info_png);
     }
-    /*compressed text chunk (zTXt)*/
-    else if(lodepng_chunk_type_equals(chunk, "zTXt"))
+    else if(state->info_png.interlace_method == 0)
     {
-      if(state->decoder.read_text_chunks)
+      state->error = postProcessScanlines(scanlines.data, scanlines.data, *w, *h, &state->info_png);
+      if(!state->error)
       {
-        state->error = readChunk_zTXt(&state->info_png, &state->decoder.zlibsettings, data, chunkLength);
-        if(state->error) break;
+        state->error = lodepng_convert(*out, scanlines.data, &state->info_raw, &state->info_png.color, *w, *h);
       }
     }
-    /*international text chunk (iTXt)*/
-    else if(lodepng_chunk_type_equals(chunk, "iTXt"))
+    else
     {
-      if(state->decoder.read_text_chunks)
+      size_t imagesize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
+      if(!ucvector_resize(&image, imagesize)) state->error = 83; /*alloc fail*/
+      if(!state->error)
       {
-        state->error = readChunk_iTXt(&state->info_png, &state->decoder.zlibsettings, data, chunkLength);
-        if(state->error) break;
+        if(lodepng_get_bpp(&state->info_png.color) < 8) memset(image.data, 0, imagesize);
+        state->error = postProcessScanlines(image.data, scanlines.data, *w, *h, &state->info_png);
       }
-    }
-    else if(lodepng_chunk_type_equals(chunk, "tIME"))
-    {
-      state->error = readChunk_tIME(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    }
-    else if(lodepng_chunk_type_equals(chunk, "pHYs"))
-    {
-      state->error = readChunk_pHYs(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    }
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
-    else /*it's not an implemented chunk type, so ignore it: skip over the data*/
-    {
-      /*error: unknown critical chunk (5th bit of first byte of chunk type is 0)*/
-      if(!lodepng_chunk_ancillary(chunk)) CERROR_BREAK(state->error, 69);
-
-      unknown = 1;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-      if(state->decoder.remember_unknown_chunks)
+      if(!state->error)
       {
-        state->error = lodepng_chunk_append(&state->info_png.unknown_chunks_data[critical_pos - 1],
-                                            &state->info_png.unknown_chunks_size[critical_pos - 1], chunk);
-        if(state->error) break;
+        state->error = lodepng_convert(*out, image.data, &state->info_raw, &state->info_png.color, *w, *h);
       }
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     }
+  }
+  /*store the info_png color settings on the info_raw so that the info_raw still reflects what colortype
+  the raw image has to the end user*/
+  if(!state->error && !state->decoder.color_convert)
+  {
+    state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+  }
 
-    if(!state->decoder.ignore_crc && !unknown) /*check CRC if wanted, only on known chunk types*/
+  arena->idat = idat.data;
+  arena->idatsize = idat.allocsize;
+  arena->scanlines = scanlines.data;
+  arena->scanlinessize = scanlines.allocsize;
+  arena->image = image.data;
+  arena->imagesize = image.allocsize;
+  if(arena == &temp) lodepng_decode_arena_cleanup(&temp);
+}
+
+unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
+                        LodePNGState* state,
+                        const unsigned char* in, size_t insize)
+{
+  *out = 0;
+  decodeImage(out, 0, w, h, state, in, insize, 0);
+  if(state->error)
+  {
+    lodepng_free(*out);
+    *out = 0;
+  }
+  return state->error;
+}
+
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize,
+                             LodePNGDecodeArena* arena)
+{
+  if(!out) return 95; /*output buffer too small*/
+  decodeImage(&out, outsize, w, h, state, in, insize, arena);
+  return state->error;
+}
+
+#ifdef LODEPNG_COMPILE_ZLIB
+typedef enum LodePNGStreamStage
+{
+  STREAM_HEADER, /*the signature and the IHDR chunk*/
+  STREAM_CHUNK_HEADER, /*length and type of the next chunk*/
+  STREAM_IDAT, /*data of an IDAT chunk, decompressed as it comes*/
+  STREAM_IDAT_CRC,
+  STREAM_CHUNK, /*a chunk other than IDAT, read once it is complete*/
+  STREAM_END /*after IEND*/
+} LodePNGStreamStage;
+
+typedef struct LodePNGStreamData
+{
+  LodePNGStreamStage stage;
+  unsigned char head[33]; /*signature and IHDR chunk, later the length and type of a chunk or the CRC of an IDAT*/
+  size_t headsize; /*bytes in head*/
+  ucvector chunk; /*the chunk being read in STREAM_CHUNK*/
+  size_t chunkpos; /*bytes of it read so far*/
+  size_t idatleft; /*bytes of the IDAT chunk still to come*/
+  unsigned crc; /*CRC register of the IDAT chunk*/
+  unsigned unknown; /*for unknown chunk order and CRC checks, as in decodeChunks*/
+  unsigned critical_pos;
+
+  unsigned started; /*1 once the first IDAT chunk started the image*/
+  InflateStream inflate;
+  unsigned convert; /*1 if the rows are converted to info_raw*/
+  FastConvert fastconvert; /*prepared once for all rows*/
+  size_t linesize; /*bytes of a scanline, including the filter byte*/
+  size_t bytewidth;
+  unsigned char* lines; /*the current and the previous scanline*/
+  unsigned current; /*which of the two is the current one*/
+  size_t fill; /*bytes of the current scanline decompressed so far*/
+  unsigned y; /*number of the current scanline*/
+  unsigned char* row; /*a converted row*/
+} LodePNGStreamData;
+
+void lodepng_stream_decoder_init(LodePNGStreamDecoder* stream)
+{
+  lodepng_state_init(&stream->state);
+  stream->row = 0;
+  stream->context = 0;
+  stream->w = stream->h = 0;
+  stream->header = stream->done = 0;
+  stream->data = 0;
+}
+
+void lodepng_stream_decoder_cleanup(LodePNGStreamDecoder* stream)
+{
+  LodePNGStreamData* data = stream->data;
+  if(data)
+  {
+    ucvector_cleanup(&data->chunk);
+    if(data->started) InflateStream_cleanup(&data->inflate);
+    lodepng_free(data->lines);
+    lodepng_free(data->row);
+    lodepng_free(data);
+    stream->data = 0;
+  }
+  lodepng_state_cleanup(&stream->state);
+}
+
+/*output of the inflate stream: assembles the scanlines, unfilters them and passes them on as rows*/
+static unsigned streamScanlines(void* context, const unsigned char* in, size_t insize)
+{
+  LodePNGStreamDecoder* stream = (LodePNGStreamDecoder*)context;
+  LodePNGStreamData* data = stream->data;
+  while(insize != 0)
+  {
+    unsigned char* line = &data->lines[data->current * data->linesize];
+    size_t size = data->linesize - data->fill;
+    if(data->y == stream->h) return 91; /*more data than the image has*/
+    if(size > insize) size = insize;
+    memcpy(line + data->fill, in, size);
+    data->fill += size;
+    in += size;
+    insize -= size;
+
+    if(data->fill == data->linesize)
     {
-      if(lodepng_chunk_check_crc(chunk)) CERROR_BREAK(state->error, 57); /*invalid CRC*/
+      /*the first scanline has no previous one, the filters take zeros for it then*/
+      const unsigned char* prevline = data->y == 0 ? 0 : &data->lines[(1 - data->current) * data->linesize + 1];
+      unsigned error = unfilterScanline(line + 1, line + 1, prevline, data->bytewidth, line[0], data->linesize - 1);
+      if(error) return error;
+      if(data->convert)
+      {
+        error = convertRow(data->row, line + 1, &data->fastconvert, &stream->state.info_raw,
+                           &stream->state.info_png.color, stream->w);
+        if(error) return error;
+        if(stream->row) stream->row(stream->context, data->y, data->row);
+      }
+      else if(stream->row) stream->row(stream->context, data->y, line + 1);
+      ++data->y;
+      data->fill = 0;
+      data->current = 1 - data->current;
     }
-
-    if(!IEND) chunk = lodepng_chunk_next_const(chunk);
   }
+  return 0;
+}
 
-  ucvector_init(&scanlines);
-  /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
-  If the decompressed size does not match the prediction, the image must be corrupt.*/
-  if(state->info_png.interlace_method == 0)
+/*at the first IDAT chunk, when the palette and transparency are known: sets up the scanlines and the conversion*/
+static unsigned streamStartImage(LodePNGStreamDecoder* stream)
+{
+  LodePNGState* state = &stream->state;
+  LodePNGStreamData* data = stream->data;
+  unsigned bpp = lodepng_get_bpp(&state->info_png.color);
+  unsigned error = checkConversion(&data->convert, state);
+  if(error) return error;
+
+  data->linesize = lodepng_get_raw_size_idat(stream->w, 1, &state->info_png.color) + 1;
+  data->bytewidth = (bpp + 7) / 8;
+  data->lines = (unsigned char*)lodepng_malloc(2 * data->linesize);
+  if(!data->lines) return 83; /*alloc fail*/
+  if(data->convert)
   {
-    /*The extra *h is added because this are the filter bytes every scanline starts with*/
-    predict = lodepng_get_raw_size_idat(*w, *h, &state->info_png.color) + *h;
+    data->row = (unsigned char*)lodepng_malloc(lodepng_get_raw_size(stream->w, 1, &state->info_raw));
+    if(!data->row) return 83; /*alloc fail*/
+    fastConvertInit(&data->fastconvert, &state->info_raw, &state->info_png.color);
   }
-  else
+  else if(!state->decoder.color_convert)
   {
-    /*Adam-7 interlaced: predicted size is the sum of the 7 sub-images sizes*/
-    const LodePNGColorMode* color = &state->info_png.color;
-    predict = 0;
-    predict += lodepng_get_raw_size_idat((*w + 7) >> 3, (*h + 7) >> 3, color) + ((*h + 7) >> 3);
-    if(*w > 4) predict += lodepng_get_raw_size_idat((*w + 3) >> 3, (*h + 7) >> 3, color) + ((*h + 7) >> 3);
-    predict += lodepng_get_raw_size_idat((*w + 3) >> 2, (*h + 3) >> 3, color) + ((*h + 3) >> 3);
-    if(*w > 2) predict += lodepng_get_raw_size_idat((*w + 1) >> 2, (*h + 3) >> 2, color) + ((*h + 3) >> 2);
-    predict += lodepng_get_raw_size_idat((*w + 1) >> 1, (*h + 1) >> 2, color) + ((*h + 1) >> 2);
-    if(*w > 1) predict += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, color) + ((*h + 1) >> 1);
-    predict += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, color) + ((*h + 0) >> 1);
-  }
-  if(!state->error && !ucvector_reserve(&scanlines, predict)) state->error = 83; /*alloc fail*/
-  if(!state->error)
+    /*as with lodepng_decode, info_raw tells the color mode of the rows*/
+    error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+    if(error) return error;
+  }
+
+  error = InflateStream_init(&data->inflate, &state->decoder.zlibsettings, streamScanlines, stream);
+  data->started = 1;
+  return error;
+}
+
+/*copies input into buffer until it has size bytes, returns 1 once it has*/
+static unsigned streamCollect(unsigned char* buffer, size_t* buffersize, size_t size,
+                              const unsigned char** in, size_t* insize)
+{
+  size_t count = size - *buffersize;
+  if(count > *insize) count = *insize;
+  memcpy(buffer + *buffersize, *in, count);
+  *buffersize += count;
+  *in += count;
+  *insize -= count;
+  return *buffersize == size;
+}
+
+/*reads the signature and header chunk in data->head*/
+static unsigned streamReadHeader(LodePNGStreamDecoder* stream)
+{
+  LodePNGState* state = &stream->state;
+  const LodePNGDecompressSettings* zlibsettings = &state->decoder.zlibsettings;
+  unsigned error = lodepng_inspect(&stream->w, &stream->h, state, stream->data->head, 33);
+  if(!error) error = checkPixelCount(stream->w, stream->h);
+  if(!error && state->info_png.interlace_method != 0) error = 96; /*Adam7 needs the whole image*/
+  if(!error && (zlibsettings->custom_zlib || zlibsettings->custom_inflate)) error = 97;
+  if(!error) stream->header = 1;
+  return error;
+}
+
+/*reads a complete chunk other than IDAT, IEND finishes the image*/
+static unsigned streamReadChunk(LodePNGStreamDecoder* stream)
+{
+  LodePNGState* state = &stream->state;
+  LodePNGStreamData* data = stream->data;
+  const unsigned char* chunk = data->chunk.data;
+  unsigned error = 0;
+
+  if(lodepng_chunk_type_equals(chunk, "IEND"))
   {
-    state->error = zlib_decompress(&scanlines.data, &scanlines.size, idat.data,
-                                   idat.size, &state->decoder.zlibsettings);
-    if(!state->error && scanlines.size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
+    if(!data->started) return 53; /*no IDAT chunk: no zlib data at all*/
+    error = InflateStream_push(&data->inflate, 0, 0, 1);
+    if(!error && data->y != stream->h) error = 91; /*less data than the image has*/
+    data->stage = STREAM_END;
   }
-  ucvector_cleanup(&idat);
+  else error = readChunk(state, chunk, &data->critical_pos, &data->unknown);
 
-  if(!state->error)
+  if(!error && !state->decoder.ignore_crc && !data->unknown) /*check CRC if wanted, only on known chunk types*/
   {
-    size_t outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
-    *out = (unsigned char*)lodepng_malloc(outsize);
-    if(!*out) state->error = 83; /*alloc fail*/
-    for(i = 0; i < outsize; i++) (*out)[i] = 0;
-    if(!state->error) state->error = postProcessScanlines(*out, scanlines.data, *w, *h, &state->info_png);
+    if(lodepng_chunk_check_crc(chunk)) error = 57; /*invalid CRC*/
   }
-  ucvector_cleanup(&scanlines);
+  if(!error && data->stage == STREAM_END) stream->done = 1;
+  return error;
 }
 
-unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
-                        LodePNGState* state,
-                        const unsigned char* in, size_t insize)
+/*starts the chunk whose length and type are in data->head*/
+static unsigned streamBeginChunk(LodePNGStreamDecoder* stream)
 {
-  *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
-  if(state->error) return state->error;
-  if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color))
+  LodePNGStreamData* data = stream->data;
+  unsigned chunkLength = lodepng_read32bitInt(data->head);
+  if(chunkLength > 2147483647) return 63; /*error: chunk length larger than the max PNG chunk size*/
+
+  if(lodepng_chunk_type_equals(data->head, "IDAT"))
   {
-    /*same color type, no copying or converting of data needed*/
-    /*store the info_png color settings on the info_raw so that the info_raw still reflects what colortype
-    the raw image has to the end user*/
-    if(!state->decoder.color_convert)
+    if(!data->started)
+    {
+      unsigned error = streamStartImage(stream);
+      if(error) return error;
+    }
+#ifndef LODEPNG_NO_COMPILE_CRC
+    data->crc = updateCRC32(0xffffffffu, &data->head[4], 4);
+#endif /*LODEPNG_NO_COMPILE_CRC*/
+    data->idatleft = chunkLength;
+    data->critical_pos = 3;
+    data->stage = STREAM_IDAT;
+  }
+  else
+  {
+    /*the whole chunk, length and type followed by the data and the CRC, as the chunk functions want it*/
+    if(!ucvector_resize(&data->chunk, (size_t)chunkLength + 12)) return 83; /*alloc fail*/
+    memcpy(data->chunk.data, data->head, 8);
+    data->chunkpos = 8;
+    data->stage = STREAM_CHUNK;
+  }
+  return 0;
+}
+
+unsigned lodepng_stream_decoder_push(LodePNGStreamDecoder* stream, const unsigned char* in, size_t insize)
+{
+  LodePNGState* state = &stream->state;
+  LodePNGStreamData* data = stream->data;
+
+  if(!data)
+  {
+    state->error = 0; /*the first push*/
+    data = (LodePNGStreamData*)lodepng_malloc(sizeof(LodePNGStreamData));
+    if(!data) CERROR_RETURN_ERROR(state->error, 83); /*alloc fail*/
+    data->stage = STREAM_HEADER;
+    data->headsize = 0;
+    ucvector_init(&data->chunk);
+    data->unknown = 0;
+    data->critical_pos = 1;
+    data->started = 0;
+    data->lines = data->row = 0;
+    data->current = 0;
+    data->fill = 0;
+    data->y = 0;
+    stream->data = data;
+  }
+
+  while(insize != 0 && !state->error && data->stage != STREAM_END)
+  {
+    if(data->stage == STREAM_HEADER)
+    {
+      if(streamCollect(data->head, &data->headsize, 33, &in, &insize))
+      {
+        state->error = streamReadHeader(stream);
+        data->headsize = 0;
+        data->stage = STREAM_CHUNK_HEADER;
+      }
+    }
+    else if(data->stage == STREAM_CHUNK_HEADER)
+    {
+      if(streamCollect(data->head, &data->headsize, 8, &in, &insize))
+      {
+        state->error = streamBeginChunk(stream);
+        data->headsize = 0;
+      }
+    }
+    else if(data->stage == STREAM_IDAT)
     {
-      state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
-      if(state->error) return state->error;
+      size_t size = insize < data->idatleft ? insize : data->idatleft;
+#ifndef LODEPNG_NO_COMPILE_CRC
+      if(!state->decoder.ignore_crc && !data->unknown) data->crc = updateCRC32(data->crc, in, size);
+#endif /*LODEPNG_NO_COMPILE_CRC*/
+      state->error = InflateStream_push(&data->inflate, in, size, 0);
+      in += size;
+      insize -= size;
+      data->idatleft -= size;
+      if(data->idatleft == 0) data->stage = STREAM_IDAT_CRC;
     }
-  }
-  else
-  {
-    /*color conversion needed; sort of copy of the data*/
-    unsigned char* data = *out;
-    size_t outsize;
-
-    /*TODO: check if this works according to the statement in the documentation: "The converter can convert
-    from greyscale input color type, to 8-bit greyscale or greyscale with alpha"*/
-    if(!(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
-       && !(state->info_raw.bitdepth == 8))
+    else if(data->stage == STREAM_IDAT_CRC)
     {
-      return 56; /*unsupported color mode conversion*/
+      if(streamCollect(data->head, &data->headsize, 4, &in, &insize))
+      {
+#ifndef LODEPNG_NO_COMPILE_CRC
+        /*the data is decompressed as it comes, so rows can be passed on before a CRC error is found*/
+        if(!state->decoder.ignore_crc && !data->unknown && lodepng_read32bitInt(data->head) != (data->crc ^ 0xffffffffu))
+        {
+          state->error = 57; /*invalid CRC*/
+        }
+#endif /*LODEPNG_NO_COMPILE_CRC*/
+        data->headsize = 0;
+        data->stage = STREAM_CHUNK_HEADER;
+      }
     }
-
-    outsize = lodepng_get_raw_size(*w, *h, &state->info_raw);
-    *out = (unsigned char*)lodepng_malloc(outsize);
-    if(!(*out))
+    else /*STREAM_CHUNK*/
     {
-      state->error = 83; /*alloc fail*/
+      if(streamCollect(data->chunk.data, &data->chunkpos, data->chunk.size, &in, &insize))
+      {
+        data->stage = STREAM_CHUNK_HEADER;
+        state->error = streamReadChunk(stream);
+      }
     }
-    else state->error = lodepng_convert(*out, data, &state->info_raw,
-                                        &state->info_png.color, *w, *h);
-    lodepng_free(data);
   }
   return state->error;
 }
+#endif /*LODEPNG_COMPILE_ZLIB*/
 
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth)
@@ -5924,6 +8352,10 @@ const char* lodepng_error_text(unsigned code)
     case 92: return "too many pixels, not supported";
     case 93: return "zero width or height is invalid";
     case 94: return "header chunk must have a size of 13 bytes";
+    case 95: return "output buffer too small for the decoded image";
+    case 96: return "the streaming decoder does not support interlaced images";
+    case 97: return "the streaming decoder does not support a custom zlib decoder";
+    case 98: return "invalid compression level, must be 0 to 9";
   }
   return "unknown error code";
 }
@@ -6010,6 +8442,205 @@ unsigned compress(std::vector<unsigned char>& out, const std::vector<unsigned ch
 {
   return compress(out, in.empty() ? 0 : &in[0], in.size(), settings);
 }
+
+#ifdef LODEPNG_COMPILE_THREADS
+/*a range of the input that compressParallel deflates on its own*/
+struct DeflatePiece
+{
+  size_t start, end;
+  ucvector out; /*deflate blocks ending at a byte boundary, the last piece has the final block*/
+  unsigned adler; /*Adler32 of the range alone*/
+  unsigned error;
+};
+
+/*shared by the threads of compressParallel*/
+struct DeflateQueue
+{
+  const unsigned char* in;
+  size_t insize;
+  const LodePNGCompressSettings* settings;
+  std::vector<DeflatePiece>* pieces;
+  std::atomic<size_t> next; /*index of the next piece to take*/
+};
+
+/*puts the positions start to end in the hash as if they were compressed just before end*/
+static void hash_prime(Hash* hash, const unsigned char* in, size_t start, size_t end, size_t insize,
+                       const LodePNGCompressSettings* settings)
+{
+  size_t pos;
+  if(settings->level == 1)
+  {
+    for(pos = start; pos < end && insize - pos >= 4; ++pos)
+    {
+      hash->levelhead[levelHash(read24(&in[pos]) | ((unsigned)in[pos + 3] << 24))] = (int)pos;
+    }
+  }
+  else if(settings->level != 0)
+  {
+    for(pos = start; pos < end; ++pos) levelInsert(hash, in, pos, insize);
+  }
+  else
+  {
+    /*as encodeLZ77 does at the end of the block before*/
+    for(pos = start; pos < end; ++pos)
+    {
+      unsigned hashval = getHash(in, end, pos);
+      unsigned numzeros = hashval == 0 ? countZeros(in, end, pos) : 0;
+      updateHashChain(hash, pos & (settings->windowsize - 1), hashval, (unsigned short)numzeros);
+    }
+  }
+}
+
+/*deflates the range of the piece with the window before it as dictionary, then byte aligns it with a sync flush*/
+static unsigned deflatePiece(DeflatePiece* piece, const unsigned char* in, size_t insize,
+                             const LodePNGCompressSettings* settings)
+{
+  size_t window = settings->level != 0 ? LEVEL_WINDOW : settings->windowsize;
+  size_t bp = 0;
+  unsigned final = piece->end == insize;
+  Hash hash;
+  unsigned error = hash_init(&hash, settings->windowsize, settings->level);
+
+  if(!error)
+  {
+    hash_prime(&hash, in, piece->start > window ? piece->start - window : 0, piece->start, insize, settings);
+    if(settings->btype == 1)
+    {
+      error = deflateFixed(&piece->out, &bp, &hash, in, piece->start, piece->end, settings, final);
+    }
+    else error = deflateDynamic(&piece->out, &bp, &hash, in, piece->start, piece->end, settings, final);
+  }
+  hash_cleanup(&hash);
+
+  if(!error && !final)
+  {
+    /*empty stored block: 3 header bits, padding to the byte, length 0 and its complement*/
+    addBitsToStream(&bp, &piece->out, 0, 3);
+    if(!ucvector_push_back(&piece->out, 0) || !ucvector_push_back(&piece->out, 0)
+       || !ucvector_push_back(&piece->out, 255) || !ucvector_push_back(&piece->out, 255)) error = 83; /*alloc fail*/
+  }
+  piece->adler = adler32(&in[piece->start], (unsigned)(piece->end - piece->start));
+  return error;
+}
+
+static void deflatePieces(DeflateQueue* queue)
+{
+  size_t i;
+  while((i = queue->next++) < queue->pieces->size())
+  {
+    DeflatePiece* piece = &(*queue->pieces)[i];
+    piece->error = deflatePiece(piece, queue->in, queue->insize, queue->settings);
+  }
+}
+
+/*Adler32 of two pieces of data after each other, from their own Adler32s (as adler32_combine of zlib)*/
+static unsigned adler32Combine(unsigned adler1, unsigned adler2, size_t len2)
+{
+  const unsigned base = 65521;
+  unsigned rem = (unsigned)(len2 % base);
+  unsigned s1 = adler1 & 0xffff;
+  unsigned s2 = rem * s1 % base;
+  s1 += (adler2 & 0xffff) + base - 1;
+  s2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + base - rem;
+  if(s1 >= base) s1 -= base;
+  if(s1 >= base) s1 -= base;
+  if(s2 >= base << 1) s2 -= base << 1;
+  if(s2 >= base) s2 -= base;
+  return (s2 << 16) | s1;
+}
+
+/*whether lodepng_deflatev would compress with these settings, and with the hash that hash_prime fills*/
+static bool canDeflateParallel(const LodePNGCompressSettings* settings)
+{
+  unsigned windowsize = settings->windowsize;
+  if(settings->custom_zlib || settings->custom_deflate) return false;
+  if(settings->btype != 1 && settings->btype != 2) return false;
+  if(settings->level > 9) return false;
+  return settings->level != 0 || (windowsize != 0 && windowsize <= 32768 && (windowsize & (windowsize - 1)) == 0);
+}
+
+unsigned compressParallel(std::vector<unsigned char>& out, const unsigned char* in, size_t insize,
+                          const LodePNGCompressSettings& settings, unsigned numthreads)
+{
+  size_t piecesize = dynamicBlockSize(insize);
+  size_t numpieces = (insize + piecesize - 1) / piecesize;
+  std::vector<DeflatePiece> pieces;
+  std::vector<std::thread> threads;
+  DeflateQueue queue;
+  size_t oldsize = out.size();
+  unsigned adler = 1;
+  unsigned error = 0;
+  size_t i;
+
+  if(numthreads == 0) numthreads = std::thread::hardware_concurrency();
+  if(numthreads > numpieces) numthreads = (unsigned)numpieces;
+  if(numthreads < 2 || !canDeflateParallel(&settings)) return compress(out, in, insize, settings);
+
+  pieces.resize(numpieces);
+  for(i = 0; i != numpieces; ++i)
+  {
+    pieces[i].start = i * piecesize;
+    pieces[i].end = i + 1 == numpieces ? insize : (i + 1) * piecesize;
+    ucvector_init_buffer(&pieces[i].out, 0, 0);
+    pieces[i].error = 0;
+  }
+  queue.in = in;
+  queue.insize = insize;
+  queue.settings = &settings;
+  queue.pieces = &pieces;
+  queue.next = 0;
+
+  for(i = 1; i < numthreads; ++i)
+  {
+    try
+    {
+      threads.push_back(std::thread(deflatePieces, &queue));
+    }
+    catch(const std::system_error&)
+    {
+      break; /*the threads that did start take the remaining pieces*/
+    }
+  }
+  deflatePieces(&queue);
+  for(i = 0; i != threads.size(); ++i) threads[i].join();
+
+  /*the same zlib header as lodepng_zlib_compress: deflate with a 32K window, no dictionary*/
+  out.push_back(120);
+  out.push_back(1);
+  for(i = 0; i != numpieces; ++i)
+  {
+    if(!error) error = pieces[i].error;
+    if(!error)
+    {
+      out.insert(out.end(), pieces[i].out.data, pieces[i].out.data + pieces[i].out.size);
+      adler = adler32Combine(adler, pieces[i].adler, pieces[i].end - pieces[i].start);
+    }
+    lodepng_free(pieces[i].out.data);
+  }
+  if(!error)
+  {
+    out.push_back((unsigned char)(adler >> 24));
+    out.push_back((unsigned char)(adler >> 16));
+    out.push_back((unsigned char)(adler >> 8));
+    out.push_back((unsigned char)adler);
+  }
+  else out.resize(oldsize);
+  return error;
+}
+#else /*no threads: compress like compress()*/
+unsigned compressParallel(std::vector<unsigned char>& out, const unsigned char* in, size_t insize,
+                          const LodePNGCompressSettings& settings, unsigned numthreads)
+{
+  (void)numthreads;
+  return compress(out, in, insize, settings);
+}
+#endif /*LODEPNG_COMPILE_THREADS*/
+
+unsigned compressParallel(std::vector<unsigned char>& out, const std::vector<unsigned char>& in,
+                          const LodePNGCompressSettings& settings, unsigned numthreads)
+{
+  return compressParallel(out, in.empty() ? 0 : &in[0], in.size(), settings, numthreads);
+}
 #endif /* LODEPNG_COMPILE_ENCODER */
 #endif /* LODEPNG_COMPILE_ZLIB */
 
@@ -6043,18 +8674,10 @@ State& State::operator=(const State& other)
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const unsigned char* in,
                 size_t insize, LodePNGColorType colortype, unsigned bitdepth)
 {
-  unsigned char* buffer;
-  unsigned error = lodepng_decode_memory(&buffer, &w, &h, in, insize, colortype, bitdepth);
-  if(buffer && !error)
-  {
-    State state;
-    state.info_raw.colortype = colortype;
-    state.info_raw.bitdepth = bitdepth;
-    size_t buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
-    out.insert(out.end(), &buffer[0], &buffer[buffersize]);
-    lodepng_free(buffer);
-  }
-  return error;
+  State state;
+  state.info_raw.colortype = colortype;
+  state.info_raw.bitdepth = bitdepth;
+  return decode(out, w, h, state, in, insize);
 }
 
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
@@ -6063,19 +8686,42 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
   return decode(out, w, h, in.empty() ? 0 : &in[0], (unsigned)in.size(), colortype, bitdepth);
 }
 
+DecodeArena::DecodeArena()
+{
+  lodepng_decode_arena_init(this);
+}
+
+DecodeArena::~DecodeArena()
+{
+  lodepng_decode_arena_cleanup(this);
+}
+
+#ifdef LODEPNG_COMPILE_ZLIB
+StreamDecoder::StreamDecoder()
+{
+  lodepng_stream_decoder_init(this);
+}
+
+StreamDecoder::~StreamDecoder()
+{
+  lodepng_stream_decoder_cleanup(this);
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
-                const unsigned char* in, size_t insize)
+                const unsigned char* in, size_t insize,
+                LodePNGDecodeArena* arena)
 {
-  unsigned char* buffer = NULL;
-  unsigned error = lodepng_decode(&buffer, &w, &h, &state, in, insize);
-  if(buffer && !error)
+  unsigned char* buffer = 0;
+  decodeImage(&buffer, 0, &w, &h, &state, in, insize, arena);
+  if(buffer && !state.error)
   {
     size_t buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
     out.insert(out.end(), &buffer[0], &buffer[buffersize]);
   }
   lodepng_free(buffer);
-  return error;
+  return state.error;
 }
 
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
@@ -6085,6 +8731,218 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
   return decode(out, w, h, state, in.empty() ? 0 : &in[0], in.size());
 }
 
+#if defined(LODEPNG_COMPILE_THREADS) && defined(LODEPNG_COMPILE_ZLIB)
+/*raw images smaller than this are decoded on one thread: starting a thread takes longer than decoding them*/
+#define PIPELINE_MIN_SIZE 65536u
+/*the unfiltering thread is woken up each time this many more bytes are inflated*/
+#define PIPELINE_STEP 16384u
+
+/*shared by the inflating and the unfiltering thread of decodePipelined*/
+struct ScanlinePipeline
+{
+  /*set before the unfiltering thread starts*/
+  unsigned char* out;
+  const unsigned char* scanlines;
+  unsigned w, h;
+  const LodePNGState* state;
+  bool convert;
+
+  /*progress of inflate, guarded by mutex*/
+  size_t size; /*bytes of scanlines that are decompressed*/
+  bool done; /*inflate ended, with or without error*/
+  std::mutex mutex;
+  std::condition_variable progress;
+
+  unsigned error; /*result of the unfiltering thread*/
+};
+
+static void reportScanlines(void* context, size_t size)
+{
+  ScanlinePipeline* pipeline = (ScanlinePipeline*)context;
+  std::lock_guard<std::mutex> lock(pipeline->mutex);
+  pipeline->size = size;
+  pipeline->progress.notify_one();
+}
+
+/*unfilter and color convert each scanline of a non-interlaced image as soon as inflate has produced it*/
+static unsigned unfilterPipelined(ScanlinePipeline* pipeline)
+{
+  const LodePNGState* state = pipeline->state;
+  unsigned w = pipeline->w;
+  unsigned bpp = lodepng_get_bpp(&state->info_png.color);
+  size_t bytewidth = (bpp + 7) / 8;
+  size_t linebytes = ((size_t)w * bpp + 7) / 8;
+  size_t outlinebytes = lodepng_get_raw_size(w, 1, pipeline->convert ? &state->info_raw : &state->info_png.color);
+  /*with color conversion only the current and the previous unfiltered scanline are kept*/
+  std::vector<unsigned char> lines(pipeline->convert ? 2 * linebytes : 0);
+  FastConvert convert;
+  unsigned char* prevline = 0;
+  size_t available = 0;
+  unsigned y;
+
+  if(pipeline->convert) fastConvertInit(&convert, &state->info_raw, &state->info_png.color);
+  for(y = 0; y < pipeline->h; ++y)
+  {
+    const unsigned char* in = &pipeline->scanlines[(linebytes + 1) * y];
+    unsigned char* outline = &pipeline->out[outlinebytes * y];
+    unsigned char* line = pipeline->convert ? &lines[(y & 1) * linebytes] : outline;
+    size_t end = (linebytes + 1) * (y + 1);
+
+    if(end > available)
+    {
+      std::unique_lock<std::mutex> lock(pipeline->mutex);
+      while(pipeline->size < end && !pipeline->done) pipeline->progress.wait(lock);
+      available = pipeline->size;
+      if(available < end) return 0; /*inflate failed, its error is the result*/
+    }
+
+    CERROR_TRY_RETURN(unfilterScanline(line, &in[1], prevline, bytewidth, in[0], linebytes));
+    if(pipeline->convert)
+    {
+      CERROR_TRY_RETURN(convertRow(outline, line, &convert, &state->info_raw, &state->info_png.color, w));
+    }
+    prevline = line;
+  }
+
+  return 0;
+}
+
+static void unfilterThread(ScanlinePipeline* pipeline)
+{
+  pipeline->error = unfilterPipelined(pipeline);
+}
+
+/*whether the image, whose header is in state, can be decoded one scanline at a time*/
+static bool canPipeline(const LodePNGState* state, unsigned w, unsigned h)
+{
+  const LodePNGDecompressSettings* zlibsettings = &state->decoder.zlibsettings;
+  bool convert = state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+  const LodePNGColorMode* mode_out = convert ? &state->info_raw : &state->info_png.color;
+
+  if(std::thread::hardware_concurrency() < 2) return false; /*the threads would only take turns*/
+  if(state->info_png.interlace_method != 0) return false;
+  if(zlibsettings->custom_zlib || zlibsettings->custom_inflate) return false;
+  if(convert)
+  {
+    /*palette output searches the palette for each pixel, other modes are unsupported by lodepng_decode*/
+    if(mode_out->colortype == LCT_PALETTE) return false;
+    if(!(mode_out->colortype == LCT_RGB || mode_out->colortype == LCT_RGBA) && mode_out->bitdepth != 8) return false;
+  }
+  /*raw images have no padding bits between rows: each output row must start at a byte*/
+  if((size_t)w * lodepng_get_bpp(mode_out) % 8 != 0) return false;
+  return lodepng_get_raw_size(w, h, mode_out) >= PIPELINE_MIN_SIZE;
+}
+
+unsigned decodePipelined(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                         State& state,
+                         const unsigned char* in, size_t insize)
+{
+  const LodePNGDecompressSettings* zlibsettings = &state.decoder.zlibsettings;
+  size_t predict = 0;
+  ucvector idat, scanlines;
+  const unsigned char* zdata;
+  size_t zsize;
+  unsigned char* buffer = 0;
+  size_t buffersize = 0;
+  ScanlinePipeline pipeline;
+  InflateProgress progress;
+  std::thread thread;
+  unsigned error = lodepng_inspect(&w, &h, &state, in, insize);
+
+  if(!error) error = checkPixelCount(w, h);
+  if(error || !canPipeline(&state, w, h)) return decode(out, w, h, state, in, insize);
+
+  ucvector_init(&idat);
+  ucvector_init(&scanlines);
+  decodeChunks(&idat, &zdata, &zsize, &w, &h, &state, in, insize);
+  error = state.error;
+  if(!error)
+  {
+    /*room for the longest match past the prediction: inflate stops there with an error instead of moving the data*/
+    predict = predictIdatSize(w, h, &state.info_png);
+    if(!ucvector_reserve(&scanlines, predict + MAX_MATCH_LENGTH)) error = 83; /*alloc fail*/
+  }
+  if(!error)
+  {
+    /*like lodepng_decode, the image is only appended to out once it decoded without error*/
+    pipeline.convert = state.decoder.color_convert
+                    && !lodepng_color_mode_equal(&state.info_raw, &state.info_png.color);
+    buffersize = lodepng_get_raw_size(w, h, pipeline.convert ? &state.info_raw : &state.info_png.color);
+    buffer = (unsigned char*)lodepng_malloc(buffersize);
+    if(!buffer) error = 83; /*alloc fail*/
+  }
+  if(error)
+  {
+    ucvector_cleanup(&idat);
+    ucvector_cleanup(&scanlines);
+    return error;
+  }
+
+  pipeline.out = buffer;
+  pipeline.scanlines = scanlines.data;
+  pipeline.w = w;
+  pipeline.h = h;
+  pipeline.state = &state;
+  pipeline.size = 0;
+  pipeline.done = false;
+  pipeline.error = 0;
+
+  progress.max_size = predict;
+  progress.step = PIPELINE_STEP;
+  progress.next = PIPELINE_STEP;
+  progress.report = reportScanlines;
+  progress.context = &pipeline;
+
+  try
+  {
+    thread = std::thread(unfilterThread, &pipeline);
+  }
+  catch(const std::system_error&)
+  {
+    /*no thread available: unfilter on this thread after inflate*/
+  }
+
+  error = zlib_decompressv(&scanlines, zdata, zsize, zlibsettings, &progress);
+  if(!error && scanlines.size != predict) error = 91; /*decompressed size doesn't match prediction*/
+
+  {
+    std::lock_guard<std::mutex> lock(pipeline.mutex);
+    pipeline.done = true;
+    pipeline.progress.notify_one();
+  }
+  if(thread.joinable()) thread.join();
+  else unfilterThread(&pipeline);
+  if(!error) error = pipeline.error;
+
+  ucvector_cleanup(&idat);
+  ucvector_cleanup(&scanlines);
+
+  /*same as lodepng_decode: without conversion info_raw tells the color type of the result*/
+  if(!error && !state.decoder.color_convert) error = lodepng_color_mode_copy(&state.info_raw, &state.info_png.color);
+  if(!error) out.insert(out.end(), &buffer[0], &buffer[buffersize]);
+  lodepng_free(buffer);
+  state.error = error;
+  return error;
+}
+#else /*no threads: decode like decode()*/
+unsigned decodePipelined(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                         State& state,
+                         const unsigned char* in, size_t insize)
+{
+  return decode(out, w, h, state, in, insize);
+}
+#endif /*LODEPNG_COMPILE_THREADS && LODEPNG_COMPILE_ZLIB*/
+
+unsigned decodePipelined(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                         const unsigned char* in, size_t insize,
+                         LodePNGColorType colortype, unsigned bitdepth)
+{
+  State state;
+  state.info_raw.colortype = colortype;
+  state.info_raw.bitdepth = bitdepth;
+  return decodePipelined(out, w, h, state, in, insize);
+}
+
 #ifdef LODEPNG_COMPILE_DISK
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const std::string& filename,
                 LodePNGColorType colortype, unsigned bitdepth)
@@ -6094,6 +8952,86 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const
   if(error) return error;
   return decode(out, w, h, buffer, colortype, bitdepth);
 }
+
+DecodeJob::DecodeJob(const std::string& filename, LodePNGColorType colortype, unsigned bitdepth)
+  : filename(filename), colortype(colortype), bitdepth(bitdepth), ignore_checksums(0), w(0), h(0), error(0)
+{
+}
+
+static void decodeJob(DecodeJob* job, bool pipelined, DecodeArena* arena)
+{
+  std::vector<unsigned char> buffer;
+  State state;
+  job->image.clear();
+  job->error = load_file(buffer, job->filename);
+  if(job->error) return;
+  state.info_raw.colortype = job->colortype;
+  state.info_raw.bitdepth = job->bitdepth;
+  state.decoder.ignore_crc = job->ignore_checksums;
+  state.decoder.zlibsettings.ignore_adler32 = job->ignore_checksums;
+  if(pipelined)
+  {
+    job->error = decodePipelined(job->image, job->w, job->h, state, buffer.empty() ? 0 : &buffer[0], buffer.size());
+  }
+  else
+  {
+    job->error = decode(job->image, job->w, job->h, state, buffer.empty() ? 0 : &buffer[0], buffer.size(), arena);
+  }
+}
+
+#ifdef LODEPNG_COMPILE_THREADS
+struct DecodeQueue
+{
+  std::vector<DecodeJob>* jobs;
+  std::atomic<size_t> next; /*index of the next job to take*/
+  bool pipelined;
+};
+
+static void decodeJobs(DecodeQueue* queue)
+{
+  DecodeArena arena; /*the scratch memory of one image is reused for the next*/
+  size_t i;
+  while((i = queue->next++) < queue->jobs->size()) decodeJob(&(*queue->jobs)[i], queue->pipelined, &arena);
+}
+#endif /*LODEPNG_COMPILE_THREADS*/
+
+void decodeBatch(std::vector<DecodeJob>& jobs, unsigned numthreads)
+{
+#ifdef LODEPNG_COMPILE_THREADS
+  DecodeQueue queue;
+  std::vector<std::thread> threads;
+  unsigned hardware = std::thread::hardware_concurrency();
+  unsigned i;
+
+  if(hardware == 0) hardware = 1;
+  if(numthreads == 0) numthreads = hardware;
+  if(numthreads > jobs.size()) numthreads = (unsigned)jobs.size();
+
+  queue.jobs = &jobs;
+  queue.next = 0;
+  /*with fewer jobs than hardware threads, each job can use a second thread to unfilter*/
+  queue.pipelined = (size_t)numthreads * 2 <= hardware;
+
+  for(i = 1; i < numthreads; ++i)
+  {
+    try
+    {
+      threads.push_back(std::thread(decodeJobs, &queue));
+    }
+    catch(const std::system_error&)
+    {
+      break; /*the threads that did start take the remaining jobs*/
+    }
+  }
+  decodeJobs(&queue);
+  for(i = 0; i != threads.size(); ++i) threads[i].join();
+#else /*no threads: one job after the other*/
+  DecodeArena arena;
+  size_t i;
+  (void)numthreads;
+  for(i = 0; i != jobs.size(); ++i) decodeJob(&jobs[i], false, &arena);
+#endif /*LODEPNG_COMPILE_THREADS*/
+}
 #endif /* LODEPNG_COMPILE_DECODER */
 #endif /* LODEPNG_COMPILE_DISK */
 
@@ -6143,6 +9081,55 @@ unsigned encode(std::vector<unsigned char>& out,
   return encode(out, in.empty() ? 0 : &in[0], w, h, state);
 }
 
+#ifdef LODEPNG_COMPILE_ZLIB
+/*custom_zlib of encodeParallel, custom_context points to the number of threads*/
+static unsigned zlibCompressParallel(unsigned char** out, size_t* outsize, const unsigned char* in, size_t insize,
+                                     const LodePNGCompressSettings* settings)
+{
+  LodePNGCompressSettings builtin = *settings;
+  std::vector<unsigned char> buffer;
+  unsigned error;
+  builtin.custom_zlib = 0;
+  builtin.custom_context = 0;
+  error = compressParallel(buffer, in, insize, builtin, *(const unsigned*)settings->custom_context);
+  if(error) return error;
+  *out = (unsigned char*)lodepng_malloc(buffer.size());
+  if(!*out) return 83; /*alloc fail*/
+  memcpy(*out, &buffer[0], buffer.size());
+  *outsize = buffer.size();
+  return 0;
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
+unsigned encodeParallel(std::vector<unsigned char>& out,
+                        const unsigned char* in, unsigned w, unsigned h,
+                        State& state, unsigned numthreads)
+{
+#ifdef LODEPNG_COMPILE_ZLIB
+  LodePNGCompressSettings* zlibsettings = &state.encoder.zlibsettings;
+  const void* context = zlibsettings->custom_context;
+  unsigned error;
+  if(zlibsettings->custom_zlib || zlibsettings->custom_deflate) return encode(out, in, w, h, state);
+  zlibsettings->custom_zlib = zlibCompressParallel;
+  zlibsettings->custom_context = &numthreads;
+  error = encode(out, in, w, h, state);
+  zlibsettings->custom_zlib = 0;
+  zlibsettings->custom_context = context;
+  return error;
+#else /*no zlib: only the custom one*/
+  (void)numthreads;
+  return encode(out, in, w, h, state);
+#endif /*LODEPNG_COMPILE_ZLIB*/
+}
+
+unsigned encodeParallel(std::vector<unsigned char>& out,
+                        const std::vector<unsigned char>& in, unsigned w, unsigned h,
+                        State& state, unsigned numthreads)
+{
+  if(lodepng_get_raw_size(w, h, &state.info_raw) > in.size()) return 84;
+  return encodeParallel(out, in.empty() ? 0 : &in[0], w, h, state, numthreads);
+}
+
 #ifdef LODEPNG_COMPILE_DISK
 unsigned encode(const std::string& filename,
                 const unsigned char* in, unsigned w, unsigned h,
@@ -74,12 +74,25 @@ source files with custom allocators.*/
 #ifndef LODEPNG_NO_COMPILE_ALLOCATORS
 #define LODEPNG_COMPILE_ALLOCATORS
 #endif
+/*SIMD code for x86 CPUs (unfiltering, color conversion, CRC32 and Adler32), the instruction set is
+chosen at runtime. Without it only the portable C code is compiled, which gives the same results.*/
+#ifndef LODEPNG_NO_COMPILE_SIMD
+#define LODEPNG_COMPILE_SIMD
+#endif
 /*compile the C++ version (you can disable the C++ wrapper here even when compiling for C++)*/
 #ifdef __cplusplus
 #ifndef LODEPNG_NO_COMPILE_CPP
 #define LODEPNG_COMPILE_CPP
 #endif
 #endif
+/*multithreaded decoding and compression in the C++ wrapper (lodepng::decodePipelined, lodepng::decodeBatch,
+lodepng::compressParallel and lodepng::encodeParallel) with C++11 std::thread. Without it those functions
+still exist but do all work on the calling thread.*/
+#ifdef LODEPNG_COMPILE_CPP
+#ifndef LODEPNG_NO_COMPILE_THREADS
+#define LODEPNG_COMPILE_THREADS
+#endif
+#endif
 
 #ifdef LODEPNG_COMPILE_CPP
 #include <vector>
@@ -290,6 +303,9 @@ struct LodePNGCompressSettings /*deflate = compress*/
   unsigned minmatch; /*mininum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*compression level 1 (fastest) to 9 (smallest) with the faster match finder, which ignores windowsize,
+  minmatch, nicematch and lazymatching. 0 uses those settings instead. Default: 0*/
+  unsigned level;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -505,6 +521,8 @@ The out buffer must have size (w * h * bpp + 7) / 8, where bpp is the bits per p
 of the output color type (lodepng_get_bpp).
 For < 8 bpp images, there should not be padding bits at the end of scanlines.
 For 16-bit per channel colors, uses big endian format like PNG does.
+RGB, grey, grey with alpha and palette to 8-bit RGBA, and 16 to 8 bits of the same color type, have
+fast paths.
 Return value is LodePNG error code
 */
 unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
@@ -520,7 +538,9 @@ typedef struct LodePNGDecoderSettings
 {
   LodePNGDecompressSettings zlibsettings; /*in here is the setting to ignore Adler32 checksums*/
 
-  unsigned ignore_crc; /*ignore CRC checksums*/
+  /*ignore CRC checksums. Together with zlibsettings.ignore_adler32 no checksum is computed at all, which saves
+  a pass over the data for trusted files*/
+  unsigned ignore_crc;
 
   unsigned color_convert; /*whether to convert the PNG to the color type you want. Default: yes*/
 
@@ -659,6 +679,78 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Scratch memory of lodepng_decode_into: the concatenated IDAT chunks (only needed when a PNG has more
+than one), the inflated scanlines, and for Adam7 images with color conversion the deinterlaced image.
+Keep one arena per thread and pass it to every decode: the buffers grow to the largest image decoded
+and are reused, instead of allocated and freed for each image. The buffers are allocated with
+lodepng_malloc; a caller may also put buffers of its own from lodepng_malloc in, with their sizes.
+*/
+typedef struct LodePNGDecodeArena
+{
+  unsigned char* idat;
+  size_t idatsize; /*allocated size*/
+  unsigned char* scanlines;
+  size_t scanlinessize;
+  unsigned char* image;
+  size_t imagesize;
+} LodePNGDecodeArena;
+
+void lodepng_decode_arena_init(LodePNGDecodeArena* arena);
+void lodepng_decode_arena_cleanup(LodePNGDecodeArena* arena); /*frees the buffers*/
+
+/*
+Size in bytes of the image lodepng_decode and lodepng_decode_into produce: of the raw color mode in
+state->info_raw, or of the PNG's own color mode if state->decoder.color_convert is off. Call it after
+lodepng_inspect to size the output buffer.
+*/
+size_t lodepng_get_decoded_size(unsigned w, unsigned h, const LodePNGState* state);
+
+/*
+Same as lodepng_decode, but decodes into a buffer of the caller, e.g. a mapped OpenGL pixel buffer
+object, which must have at least lodepng_get_decoded_size bytes (else error 95). Nothing else is
+allocated if the arena already has enough memory; arena may be NULL for temporary scratch memory.
+No memory besides out and the arena is needed: without color conversion the scanlines are unfiltered
+straight into out, and a PNG with a single IDAT chunk is inflated from the input directly.
+*/
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, unsigned* w, unsigned* h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize,
+                             LodePNGDecodeArena* arena);
+
+#ifdef LODEPNG_COMPILE_ZLIB
+/*
+Streaming decoder: the PNG file is pushed in pieces of any size, e.g. as it is read from disk, and the image
+comes out row by row, top to bottom, through a callback while it is decoded. Only two scanlines and the 32 KB
+inflate window are kept (plus the ancillary chunk being read), the same memory for any image size. Interlaced
+images need the whole image and are not supported (error 96), nor are custom zlib decoders (error 97). The
+other settings in state work as with lodepng_decode.
+*/
+typedef struct LodePNGStreamDecoder
+{
+  LodePNGState state; /*settings before the first push, the PNG info after the header was pushed*/
+  /*
+  called with each row in the color mode of state.info_raw (which is the PNG's own if color_convert is off).
+  A row starts on a byte boundary and has lodepng_get_raw_size(w, 1, &state.info_raw) bytes. May be NULL.
+  */
+  void (*row)(void* context, unsigned y, const unsigned char* pixels);
+  void* context; /*passed to row*/
+  unsigned w, h; /*the image size*/
+  unsigned header; /*1 once w, h and state.info_png are known, which is before the first row*/
+  unsigned done; /*1 once the IEND chunk was pushed: all rows were passed on. Else the file was truncated*/
+  struct LodePNGStreamData* data; /*internal*/
+} LodePNGStreamDecoder;
+
+void lodepng_stream_decoder_init(LodePNGStreamDecoder* stream);
+void lodepng_stream_decoder_cleanup(LodePNGStreamDecoder* stream);
+
+/*
+Decodes the next piece of the PNG file, calling row for the rows that are complete. Returns the error (also in
+state.error), after an error the following pushes do nothing. Input after the IEND chunk is ignored.
+*/
+unsigned lodepng_stream_decoder_push(LodePNGStreamDecoder* stream, const unsigned char* in, size_t insize);
+#endif /*LODEPNG_COMPILE_ZLIB*/
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 
@@ -827,13 +919,81 @@ class State : public LodePNGState
 };
 
 #ifdef LODEPNG_COMPILE_DECODER
-/* Same as other lodepng::decode, but using a State for more settings and information. */
+/* LodePNGDecodeArena that frees its buffers when it goes out of scope */
+class DecodeArena : public LodePNGDecodeArena
+{
+  public:
+    DecodeArena();
+    virtual ~DecodeArena();
+  private:
+    DecodeArena(const DecodeArena& other);
+    DecodeArena& operator=(const DecodeArena& other);
+};
+
+#ifdef LODEPNG_COMPILE_ZLIB
+/* LodePNGStreamDecoder with init and cleanup */
+class StreamDecoder : public LodePNGStreamDecoder
+{
+  public:
+    StreamDecoder();
+    virtual ~StreamDecoder();
+  private:
+    StreamDecoder(const StreamDecoder& other);
+    StreamDecoder& operator=(const StreamDecoder& other);
+};
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
+/*
+Same as other lodepng::decode, but using a State for more settings and information. The image is
+appended to out once it decoded without error. An arena, if given, provides the scratch memory; to
+decode into memory you own without a copy, use lodepng_decode_into.
+*/
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
-                const unsigned char* in, size_t insize);
+                const unsigned char* in, size_t insize,
+                LodePNGDecodeArena* arena = 0);
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
                 const std::vector<unsigned char>& in);
+
+/*
+Same as decode, but while the calling thread inflates the IDAT data, a second thread already unfilters and
+color converts the scanlines that are complete, so the two halves of the work overlap. Only the unfiltered
+previous and current scanline are kept besides the output. Small images (where starting a thread costs more
+than it saves), interlaced images, custom zlib decoders and raw output with partial bytes at the end of the
+rows are decoded exactly like decode does. The result is the same as that of decode; a corrupt file may
+report a different one of its errors.
+*/
+unsigned decodePipelined(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                         State& state,
+                         const unsigned char* in, size_t insize);
+unsigned decodePipelined(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                         const unsigned char* in, size_t insize,
+                         LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
+
+#ifdef LODEPNG_COMPILE_DISK
+/*One file for decodeBatch: set filename, colortype and bitdepth, the other fields receive the result.*/
+struct DecodeJob
+{
+  std::string filename;
+  LodePNGColorType colortype;
+  unsigned bitdepth;
+  unsigned ignore_checksums; /*skip the CRC and Adler32 checks (ignore_crc and ignore_adler32), default 0*/
+
+  std::vector<unsigned char> image;
+  unsigned w, h;
+  unsigned error;
+
+  DecodeJob(const std::string& filename = "", LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
+};
+
+/*
+Loads and decodes the files of all jobs on a pool of threads, each thread takes the next job when it is
+done with one. numthreads 0 uses one thread per hardware thread, never more than there are jobs; the
+calling thread is one of them. A failing file only sets the error of its own job.
+*/
+void decodeBatch(std::vector<DecodeJob>& jobs, unsigned numthreads = 0);
+#endif /* LODEPNG_COMPILE_DISK */
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -844,6 +1004,18 @@ unsigned encode(std::vector<unsigned char>& out,
 unsigned encode(std::vector<unsigned char>& out,
                 const std::vector<unsigned char>& in, unsigned w, unsigned h,
                 State& state);
+
+/*
+Same as encode, but the image data is compressed on numthreads threads (0: one per hardware thread) with
+compressParallel. The PNG is standard, and slightly larger than that of encode. With a custom zlib or deflate
+function in the settings this is the same as encode.
+*/
+unsigned encodeParallel(std::vector<unsigned char>& out,
+                        const unsigned char* in, unsigned w, unsigned h,
+                        State& state, unsigned numthreads = 0);
+unsigned encodeParallel(std::vector<unsigned char>& out,
+                        const std::vector<unsigned char>& in, unsigned w, unsigned h,
+                        State& state, unsigned numthreads = 0);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_DISK
@@ -880,6 +1052,20 @@ unsigned compress(std::vector<unsigned char>& out, const unsigned char* in, size
 /* Zlib-compress an std::vector */
 unsigned compress(std::vector<unsigned char>& out, const std::vector<unsigned char>& in,
                   const LodePNGCompressSettings& settings = lodepng_default_compress_settings);
+
+/*
+Zlib-compress on numthreads threads (0: one per hardware thread), like pigz: the input is split in the pieces
+that would be the dynamic deflate blocks, each piece is compressed on its own with the 32 KB before it as
+dictionary and ends with a sync flush (an empty stored block), so the pieces join into one standard zlib
+stream. The Adler32s of the pieces are combined. Input of one piece, one thread, btype 0 and custom
+functions are compressed like compress does.
+*/
+unsigned compressParallel(std::vector<unsigned char>& out, const unsigned char* in, size_t insize,
+                          const LodePNGCompressSettings& settings = lodepng_default_compress_settings,
+                          unsigned numthreads = 0);
+unsigned compressParallel(std::vector<unsigned char>& out, const std::vector<unsigned char>& in,
+                          const LodePNGCompressSettings& settings = lodepng_default_compress_settings,
+                          unsigned numthreads = 0);
 #endif /* LODEPNG_COMPILE_ENCODER */
 #endif /* LODEPNG_COMPILE_ZLIB */
 } /* namespace lodepng */
@@ -1582,6 +1768,7 @@ state.encoder.zlibsettings.windowsize: tweak LZ77 windowsize
 state.encoder.zlibsettings.minmatch: tweak min LZ77 length to match
 state.encoder.zlibsettings.nicematch: tweak LZ77 match where to stop searching
 state.encoder.zlibsettings.lazymatching: try one more LZ77 matching
+state.encoder.zlibsettings.level: 1 (fastest) to 9 (smallest) instead of the 4 settings above
 state.encoder.zlibsettings.custom_...: use custom deflate function
 state.encoder.auto_convert: choose optimal PNG color type, if 0 uses info_png
 state.encoder.filter_palette_zero: PNG filter strategy for palette
@@ -1607,6 +1794,23 @@ yyyymmdd.
 Some changes aren't backwards compatible. Those are indicated with a (!)
 symbol.
 
+*) 19 okt 2026: lodepng::compressParallel and lodepng::encodeParallel: deflate in pieces on a thread pool,
+    each primed with the 32 KB before it and ended with a sync flush, Adler32s combined.
+*) 19 okt 2026: Compression levels (LodePNGCompressSettings.level) with a new LZ77 match finder: a single
+    probe hash at level 1, hash chains with a probe budget and optional lazy matching at 2-9.
+*) 19 okt 2026: Slicing-by-8 and PCLMULQDQ CRC32, SSSE3/AVX2 Adler32, selected at runtime.
+    DecodeJob::ignore_checksums, the streaming inflate skips Adler32 when it's ignored.
+*) 19 okt 2026: Fast paths in lodepng_convert for RGB, grey, grey alpha and palette to RGBA8 (palette
+    through a color table, AVX2 gather) and 16 to 8 bit, prepared once per image by the decoder.
+*) 19 okt 2026: Streaming decoder (LodePNGStreamDecoder): push the file in pieces, get the rows through a
+    callback, with two scanlines and the 32 KB inflate window in memory.
+*) 19 okt 2026: lodepng_decode_into (decode into a caller buffer) with a reusable LodePNGDecodeArena,
+    single IDAT chunks are inflated in place and the decoder keeps no intermediate image copies.
+*) 19 okt 2026: lodepng::decodePipelined (inflate and unfilter on two threads) and
+    lodepng::decodeBatch (files on a thread pool), LODEPNG_NO_COMPILE_THREADS.
+*) 19 okt 2026: SSE2/SSSE3/AVX2 unfiltering of RGB and RGBA scanlines (LODEPNG_NO_COMPILE_SIMD).
+*) 19 okt 2026: Word-at-a-time bit reader for inflate and sub-byte pixel unpacking.
+*) 19 okt 2026: Table-driven huffman decoding with a 64-bit bit buffer in inflate.
 *) 08 dec 2015: Made load_file function return error if file can't be opened.
 *) 24 okt 2015: Bugfix with decoding to palette output.
 *) 18 apr 2015: Boundary PM instead of just package-merge for faster encoding.
@@ -12,10 +12,25 @@
 #include "constants.h"
 #include "lodepng.h"
 #include "shaderprogram.h"
+#include "ShaderLibrary.h"
 #include "vertices.h"
 #include "Stone.h"
 #include "Fish.h"
 #include "Coral.h"
+#include "NoiseVolume.h"
+#include "FogPass.h"
+#include "DepthPrepassSelector.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "HeadlessContext.h"
+#include "Random.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "GoldenImages.h"
+#include "TextureCache.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
 
 // Camera variables
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);  // Start underwater level
@@ -35,16 +50,55 @@ bool mousePressed = false;
 float aspectRatio = 1;
 bool keys[1024];
 
+// Owns all programs; the pointers below are permutations selected per material
+ShaderLibrary* shaders;
 ShaderProgram* sp;
 ShaderProgram* skyboxShader;
-ShaderProgram* roomSkyboxShader;
 ShaderProgram* glassShader;
 ShaderProgram* frameShader;
 ShaderProgram* outsideShader;
 ShaderProgram* waterFogShader;
+ShaderProgram* waterFogVolumeShader;
 ShaderProgram* stoneShader;
 ShaderProgram* fishShader;
 ShaderProgram* coralShader;
+ShaderProgram* depthShader;
+ShaderProgram* depthAlphaShader;
+
+// Chooses between depth pre-pass and plain front-to-back opaque rendering (cycle with Z)
+DepthPrepassSelector* prepassSelector;
+
+// GPU time per drawScene section (timestamp queries, merged into the profiler trace)
+GpuProfiler* gpuProfiler;
+
+// Command line options (see printUsage)
+struct Options {
+    bool headless = false;          // render offscreen, fixed frame count and timestep
+    int width = 800;
+    int height = 600;
+    int frames = 300;               // headless only
+    bool framesSet = false;
+    float timestep = 1.0f / 60.0f;  // headless only, seconds of simulated time per frame
+    bool seedSet = false;
+    unsigned seed = 1;
+    bool vsync = true;
+    bool trustTextures = false;       // skip the checksums of the PNG textures
+    std::string cameraPath = "orbit"; // orbit or fixed (headless only), or a recording to replay
+    std::string outputImage;          // headless only: PNG of the last frame
+    std::string benchmarkFile;        // scenario for --benchmark (implies headless)
+    std::string reportFile;           // benchmark JSON report (stdout if empty)
+    std::string goldenDirectory;      // golden-image references (implies headless)
+    bool goldenRecord = false;        // record references instead of checking them
+    int goldenInterval = 30;          // every Nth frame (and the last one) is recorded or checked
+    GoldenImages::Thresholds goldenThresholds;
+    int fishCount = -1;               // population; -1 = default random scene
+    int coralCount = -1;
+    int stoneCount = -1;
+};
+Options options;
+
+// Framebuffer the finished frame goes to: 0 for the window, the offscreen target when headless
+GLuint outputFramebuffer = 0;
 
 GLuint sandVAO, sandVBO;
 GLuint skyboxVAO, skyboxVBO;
@@ -55,28 +109,55 @@ GLuint waterFogVAO, waterFogVBO;
 GLuint sandDiffuseTexture, sandDisplacementTexture;
 GLuint floorDiffuseTexture, floorDisplacementTexture;
 
+// Water fog noise: baked 3D texture or analytic fractal noise (toggle with N)
+NoiseVolume* fogNoiseVolume;
+bool useFogNoiseVolume = true;
+
+// Water fog resolution: 1 = full resolution, 2/4 = half/quarter resolution with bilateral upsample (toggle with H)
+FogPass* fogPass;
+int fogDownscale = 2;
+
+// Frame time accumulated since the last fog mode switch, for comparing the paths
+float fogModeFrameTime = 0.0f;
+int fogModeFrames = 0;
+
+// Camera recording (toggle with R) and replay (--camera FILE.aqcp)
+CameraPath cameraRecording;
+bool recordingCamera = false;
+float recordingStart = 0.0f;
+CameraPath cameraReplay;
+bool replayingCamera = false;
+
+// Fish movement is skipped when false (render-only benchmarks)
+bool simulateFish = true;
+
 // Objects
 std::vector<std::unique_ptr<Stone>> aquarium_stones;
 std::vector<std::unique_ptr<Fish>> aquarium_fish;
 std::vector<std::unique_ptr<Coral>> aquarium_corals;
 
+// Per-frame draw order, nearest first. The vectors above keep their order so the fish
+// update (and its random numbers) doesn't depend on the camera
+std::vector<Stone*> stoneDrawOrder;
+std::vector<Fish*> fishDrawOrder;
+std::vector<Coral*> coralDrawOrder;
+
 // Texture loading function
 GLuint loadTexture(const char* path) {
+    PROFILE_SCOPE("loadTexture");
     GLuint textureID;
     glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
 
-    std::vector<unsigned char> image;
     unsigned width, height;
-    unsigned error = lodepng::decode(image, width, height, path);
+    unsigned error = TextureCache::upload(path, width, height);
 
     if (error) {
         std::cout << "Error loading texture " << path << ": " << lodepng_error_text(error) << std::endl;
+        glDeleteTextures(1, &textureID);
         return 0;
     }
 
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &image[0]);
-
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -86,6 +167,50 @@ GLuint loadTexture(const char* path) {
     return textureID;
 }
 
+// Fill order with the instances sorted by distance to the camera, nearest first
+template <typename T>
+void sortFrontToBack(const std::vector<std::unique_ptr<T>>& objects, const glm::vec3& eye, std::vector<T*>& order) {
+    order.clear();
+    for (const auto& object : objects) {
+        order.push_back(object.get());
+    }
+    std::sort(order.begin(), order.end(), [&eye](const T* a, const T* b) {
+        glm::vec3 da = a->getPosition() - eye;
+        glm::vec3 db = b->getPosition() - eye;
+        return glm::dot(da, da) < glm::dot(db, db);
+    });
+}
+
+// Camera front vector from yaw and pitch
+void updateCameraFront() {
+    glm::vec3 front;
+    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+    front.y = sin(glm::radians(pitch));
+    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+    cameraFront = glm::normalize(front);
+}
+
+// Deterministic camera for replays and headless runs: a recorded path, or a slow orbit
+// whose radius swings between inside the aquarium (fog, underwater skybox) and outside
+// the glass (room view)
+void updateCameraPath(float time) {
+    if (replayingCamera) {
+        CameraPath::Sample sample = cameraReplay.sample(time);
+        cameraPos = sample.position;
+        yaw = sample.yaw;
+        pitch = sample.pitch;
+        fov = sample.fov;
+        updateCameraFront();
+        return;
+    }
+    if (options.cameraPath == "fixed") return;
+
+    float angle = time * 0.3f;
+    float radius = 7.0f + 3.0f * sinf(time * 0.2f);
+    cameraPos = glm::vec3(radius * cosf(angle), 1.0f + 0.5f * sinf(time * 0.5f), radius * sinf(angle));
+    cameraFront = glm::normalize(glm::vec3(0.0f, 0.0f, 0.0f) - cameraPos);
+}
+
 // Error callback
 void error_callback(int error, const char* description) {
     fputs(description, stderr);
@@ -120,11 +245,7 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
             pitch = -89.0f;
 
         // Aktualizacja wektora front kamery
-        glm::vec3 front;
-        front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-        front.y = sin(glm::radians(pitch));
-        front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-        cameraFront = glm::normalize(front);
+        updateCameraFront();
     }
     else {
         lastX = xpos;
@@ -151,6 +272,16 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
         fov = 45.0f;
 }
 
+// Print the average frame time of the current fog mode and start measuring the next one
+void reportFogModeFrameTime() {
+    if (fogModeFrames > 0) {
+        std::cout << "Fog (" << (useFogNoiseVolume ? "baked" : "analytic") << " noise, 1/" << fogDownscale << " resolution): "
+            << fogModeFrameTime * 1000.0f / fogModeFrames << " ms/frame over " << fogModeFrames << " frames" << std::endl;
+    }
+    fogModeFrameTime = 0.0f;
+    fogModeFrames = 0;
+}
+
 // Key callback with WSAD movement
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key >= 0 && key < 1024) {
@@ -159,6 +290,57 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         else if (action == GLFW_RELEASE)
             keys[key] = false;
     }
+
+    // Switch between baked and analytic fog noise
+    if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+        reportFogModeFrameTime();
+        useFogNoiseVolume = !useFogNoiseVolume;
+        std::cout << "Fog noise: " << (useFogNoiseVolume ? "baked 3D texture" : "analytic") << std::endl;
+    }
+
+    // Write the last few seconds of CPU profiling as a Chrome trace (open in Perfetto)
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        static int captureIndex = 0;
+        std::string fileName = "profile_" + std::to_string(captureIndex++) + ".json";
+        if (Profiler::writeChromeTrace(fileName.c_str()))
+            std::cout << "Profiler capture written to " << fileName << std::endl;
+        else
+            std::cout << "Cannot write profiler capture " << fileName << std::endl;
+        gpuProfiler->report();
+    }
+
+    // Start/stop recording the camera to camera_N.aqcp (replay with --camera camera_N.aqcp)
+    if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+        if (!recordingCamera) {
+            cameraRecording.clear();
+            cameraRecording.setSeed(Random::getSeed());
+            recordingStart = glfwGetTime();
+            recordingCamera = true;
+            std::cout << "Recording camera path (seed " << Random::getSeed() << ")" << std::endl;
+        }
+        else {
+            static int recordingIndex = 0;
+            recordingCamera = false;
+            std::string fileName = "camera_" + std::to_string(recordingIndex++) + ".aqcp";
+            if (cameraRecording.save(fileName.c_str()))
+                std::cout << "Camera path written to " << fileName << " (" << cameraRecording.size() << " samples, "
+                    << cameraRecording.getDuration() << " s)" << std::endl;
+        }
+    }
+
+    // Cycle depth pre-pass mode: auto -> always -> never
+    if (key == GLFW_KEY_Z && action == GLFW_PRESS) {
+        prepassSelector->cycleMode();
+    }
+
+    // Cycle fog resolution: full -> half -> quarter
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+        reportFogModeFrameTime();
+        fogDownscale = fogDownscale >= 4 ? 1 : fogDownscale * 2;
+        if (fogDownscale > 1)
+            fogPass->setDownscale(fogDownscale);
+        std::cout << "Fog resolution: 1/" << fogDownscale << std::endl;
+    }
 }
 
 // Process continuous key input
@@ -181,10 +363,12 @@ void processInput(float deltaTime) {
         cameraPos.y = 8.0f;
 }
 
-void windowResizeCallback(GLFWwindow* window, int width, int height) {
+// Framebuffer pixels, which differ from window units on HiDPI displays
+void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
     if (height == 0) return;
     aspectRatio = (float)width / (float)height;
     glViewport(0, 0, width, height);
+    fogPass->resize(width, height);
 }
 
 // Setup glass walls geometry
@@ -314,24 +498,46 @@ void initOpenGLProgram(GLFWwindow* window) {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glfwSetWindowSizeCallback(window, windowResizeCallback);
-    glfwSetKeyCallback(window, keyCallback);
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetMouseButtonCallback(window, mouseButtonCallback);
-    glfwSetScrollCallback(window, scrollCallback);
-
-    // Create shader programs
-    sp = new ShaderProgram("v_sand.glsl", NULL, "f_sand.glsl");
-    skyboxShader = new ShaderProgram("v_skybox.glsl", NULL, "f_skybox.glsl");
-    roomSkyboxShader = new ShaderProgram("v_room_skybox.glsl", NULL, "f_room_skybox.glsl");
-    glassShader = new ShaderProgram("v_glass.glsl", NULL, "f_glass.glsl");
-    frameShader = new ShaderProgram("v_frame.glsl", NULL, "f_frame.glsl");
-    outsideShader = new ShaderProgram("v_outside.glsl", NULL, "f_outside.glsl");
-    waterFogShader = new ShaderProgram("v_water_fog.glsl", NULL, "f_water_fog.glsl");
-    stoneShader = new ShaderProgram("v_stone.glsl", NULL, "f_stone.glsl");
-    fishShader = new ShaderProgram("v_fish.glsl", NULL, "f_fish.glsl");
-    coralShader = new ShaderProgram("v_coral.glsl", NULL, "f_coral.glsl");
+    // No window (and no input) in headless mode
+    int width = options.width;
+    int height = options.height;
+    if (window != NULL) {
+        glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+        glfwSetKeyCallback(window, keyCallback);
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+    aspectRatio = (float)width / (float)height;
 
+    ProfileSequence section("Init: submit shaders");
+
+    // Submit shader programs (linked binaries are reused from shader_cache/ when the driver allows).
+    // Compile and link run in the driver while assets load below; results are checked at the end.
+    auto shaderSetupStart = std::chrono::steady_clock::now();
+    ShaderProgram::enableParallelCompile();
+
+    shaders = new ShaderLibrary();
+    sp = shaders->get("v_sand.glsl", NULL, "f_sand.glsl");
+    skyboxShader = shaders->get("v_skybox.glsl", NULL, "f_skybox.glsl");
+    glassShader = shaders->get("v_glass.glsl", NULL, "f_glass.glsl");
+    frameShader = shaders->get("v_frame.glsl", NULL, "f_frame.glsl");
+    outsideShader = shaders->get("v_outside.glsl", NULL, "f_outside.glsl");
+    waterFogShader = shaders->get("v_water_fog.glsl", NULL, "f_water_fog.glsl");
+    waterFogVolumeShader = shaders->get("v_water_fog.glsl", NULL, "f_water_fog.glsl", "NOISE_VOLUME");
+    stoneShader = shaders->get("v_sand.glsl", NULL, "f_sand.glsl"); // Stones share the sand material
+    fishShader = shaders->get("v_model.glsl", NULL, "f_model.glsl", "ALPHA_DISCARD FOG");
+    coralShader = shaders->get("v_model.glsl", NULL, "f_model.glsl", "SWAY ALPHA_DISCARD FOG CORAL_LIGHTING");
+    depthShader = shaders->get("v_depth.glsl", NULL, "f_depth.glsl");
+    depthAlphaShader = shaders->get("v_depth.glsl", NULL, "f_depth.glsl", "ALPHA_DISCARD");
+
+    std::chrono::duration<double, std::milli> shaderSubmitTime = std::chrono::steady_clock::now() - shaderSetupStart;
+
+    prepassSelector = new DepthPrepassSelector();
+    gpuProfiler = new GpuProfiler();
+
+    section.next("Init: geometry");
     // Setup geometry
     setupSandFloor();
     setupSkybox();
@@ -340,18 +546,43 @@ void initOpenGLProgram(GLFWwindow* window) {
     setupOutsideFloor();
     setupWaterFog();
 
+    section.next("Init: noise volume");
+    // Bake fog noise volume
+    fogNoiseVolume = new NoiseVolume(64);
+
+    section.next("Init: fog targets");
+    // Low resolution fog targets
+    fogPass = new FogPass(shaders, width, height, fogDownscale > 1 ? fogDownscale : 2);
+    fogPass->setOutputFramebuffer(outputFramebuffer);
+
+    section.next("Init: decode textures");
+    // Decode the PNG textures of the whole scene in parallel; the loaders below take them from the cache
+    std::vector<std::string> textureFiles = { "sand_diff.png", "sand_disp.png", "floor_diff.png", "floor_disp.png" };
+    for (const auto& files : { Stone::textureFiles(), Coral::textureFiles(), Fish::textureFiles() }) {
+        textureFiles.insert(textureFiles.end(), files.begin(), files.end());
+    }
+    auto textureDecodeStart = std::chrono::steady_clock::now();
+    TextureCache::setVerifyChecksums(!options.trustTextures);
+    TextureCache::preload(textureFiles);
+    std::chrono::duration<double, std::milli> textureDecodeTime = std::chrono::steady_clock::now() - textureDecodeStart;
+    std::cout << "Decoded " << textureFiles.size() << " textures in " << textureDecodeTime.count() << " ms" << std::endl;
+
+    section.next("Init: stones");
     // Create stones
-    aquarium_stones = Stone::createRandomStones();
+    aquarium_stones = Stone::createRandomStones(options.stoneCount);
     std::cout << "Created " << aquarium_stones.size() << " stones in aquarium" << std::endl;
 
+    section.next("Init: corals");
     // Create corals (after stones to avoid collisions)
-    aquarium_corals = Coral::createRandomCorals(aquarium_stones);
+    aquarium_corals = Coral::createRandomCorals(aquarium_stones, options.coralCount);
     std::cout << "Created " << aquarium_corals.size() << " corals in aquarium" << std::endl;
 
+    section.next("Init: fish");
     // Create fish
-    aquarium_fish = Fish::createRandomFish();
+    aquarium_fish = Fish::createRandomFish(options.fishCount);
     std::cout << "Created " << aquarium_fish.size() << " fish in aquarium" << std::endl;
 
+    section.next("Init: textures");
     // Load textures
     sandDiffuseTexture = loadTexture("sand_diff.png");
     sandDisplacementTexture = loadTexture("sand_disp.png");
@@ -362,6 +593,26 @@ void initOpenGLProgram(GLFWwindow* window) {
         floorDiffuseTexture == 0 || floorDisplacementTexture == 0) {
         std::cout << "Failed to load textures!" << std::endl;
     }
+    TextureCache::clear();
+
+    section.next("Init: finalize shaders");
+    // Finalize shader programs (waits only for those still compiling)
+    auto shaderFinalizeStart = std::chrono::steady_clock::now();
+    std::vector<ShaderProgram*> programs = shaders->all();
+    int cachedPrograms = 0;
+    int readyPrograms = 0;
+    for (ShaderProgram* program : programs) {
+        if (program->isFromBinaryCache()) cachedPrograms++;
+        else if (program->isReady()) readyPrograms++;
+        program->finalize();
+    }
+    std::chrono::duration<double, std::milli> shaderWaitTime = std::chrono::steady_clock::now() - shaderFinalizeStart;
+    const int programCount = (int)programs.size();
+    std::cout << "Shader setup: submit " << shaderSubmitTime.count() << " ms, wait after asset loading "
+        << shaderWaitTime.count() << " ms ("
+        << (cachedPrograms == programCount ? "warm" : cachedPrograms == 0 ? "cold" : "partially cached")
+        << ": " << cachedPrograms << "/" << programCount << " programs from binary cache, "
+        << readyPrograms << " finished compiling in the background)" << std::endl;
 }
 
 // Free resources
@@ -382,20 +633,33 @@ void freeOpenGLProgram(GLFWwindow* window) {
     glDeleteTextures(1, &sandDisplacementTexture);
     glDeleteTextures(1, &floorDiffuseTexture);
     glDeleteTextures(1, &floorDisplacementTexture);
-    delete sp;
-    delete skyboxShader;
-    delete roomSkyboxShader;
-    delete glassShader;
-    delete frameShader;
-    delete outsideShader;
-    delete waterFogShader;
-    delete stoneShader;
-    delete fishShader;
-    delete coralShader;
+    delete fogNoiseVolume;
+    delete fogPass;
+    delete shaders;
+    delete prepassSelector;
+    delete gpuProfiler;
 }
 
-// Draw scene
-void drawScene(GLFWwindow* window, float deltaTime) {
+// Move the fish (the simulation part of a frame)
+void updateFish(float deltaTime) {
+    for (auto& fish : aquarium_fish) {
+        fish->update(deltaTime);
+    }
+}
+
+// Draw scene; window is NULL when rendering headless (nothing to present)
+void drawScene(GLFWwindow* window, float deltaTime, float time) {
+    // CPU time per section (GPU work is asynchronous, this measures command submission)
+    // and GPU time of the same sections from timestamp queries
+    ProfileSequence section("Begin frame");
+    gpuProfiler->beginFrame("Begin frame");
+    auto beginSection = [&section](const char* name) {
+        section.next(name);
+        gpuProfiler->mark(name);
+    };
+
+    // Draw into the output framebuffer unless the fog pass redirects the scene; only its composite binds it otherwise
+    fogPass->beginOutput();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Process input
@@ -405,9 +669,10 @@ void drawScene(GLFWwindow* window, float deltaTime) {
     glm::mat4 V = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
     // Projection matrix with variable FOV for zoom
-    glm::mat4 P = glm::perspective(glm::radians(fov), aspectRatio, 0.1f, 100.0f);
+    const float nearPlane = 0.1f;
+    const float farPlane = 100.0f;
+    glm::mat4 P = glm::perspective(glm::radians(fov), aspectRatio, nearPlane, farPlane);
 
-    float time = glfwGetTime();
     glm::mat4 M = glm::mat4(1.0f);
 
     // Check if camera is inside aquarium for different skybox
@@ -415,53 +680,81 @@ void drawScene(GLFWwindow* window, float deltaTime) {
         cameraPos.z > -6.0f && cameraPos.z < 6.0f &&
         cameraPos.y > -1.0f && cameraPos.y < 4.0f);
 
-    // === DRAW OUTSIDE FLOOR FIRST ===
-    outsideShader->use();
-    glUniformMatrix4fv(outsideShader->u("P"), 1, false, glm::value_ptr(P));
-    glUniformMatrix4fv(outsideShader->u("V"), 1, false, glm::value_ptr(V));
-    glUniformMatrix4fv(outsideShader->u("M"), 1, false, glm::value_ptr(M));
-    glUniform1f(outsideShader->u("time"), time);
-    glUniform3fv(outsideShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+    // Low resolution fog needs the scene depth, so render the scene offscreen first
+    bool lowResFog = insideAquarium && fogDownscale > 1;
+    if (lowResFog) {
+        fogPass->beginScene();
+    }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, floorDiffuseTexture);
-    glUniform1i(outsideShader->u("floorDiffuse"), 0);
+    section.next("Update fish"); // CPU only
+    // === UPDATE FISH (before drawing, so the pre-pass and color pass agree) ===
+    if (simulateFish) {
+        updateFish(deltaTime);
+    }
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, floorDisplacementTexture);
-    glUniform1i(outsideShader->u("floorDisplacement"), 1);
+    section.next("Sort"); // CPU only
+    // Front-to-back order lets early-Z reject fragments of farther instances
+    sortFrontToBack(aquarium_fish, cameraPos, fishDrawOrder);
+    sortFrontToBack(aquarium_corals, cameraPos, coralDrawOrder);
+    sortFrontToBack(aquarium_stones, cameraPos, stoneDrawOrder);
+
+    prepassSelector->beginOpaquePass(time);
+    bool depthPrepass = prepassSelector->useDepthPrepass();
+
+    beginSection("Depth pre-pass");
+    // === DEPTH PRE-PASS (position only, no color writes) ===
+    if (depthPrepass) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+        for (Fish* fish : fishDrawOrder) {
+            fish->drawDepth(depthAlphaShader, P, V);
+        }
+        for (Stone* stone : stoneDrawOrder) {
+            stone->drawDepth(depthShader, P, V);
+        }
+
+        depthShader->use();
+        glUniformMatrix4fv(depthShader->u("P"), 1, false, glm::value_ptr(P));
+        glUniformMatrix4fv(depthShader->u("V"), 1, false, glm::value_ptr(V));
+        glUniformMatrix4fv(depthShader->u("M"), 1, false, glm::value_ptr(M));
+
+        glBindVertexArray(sandVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(outsideFloorVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
 
-    glBindVertexArray(outsideFloorVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
 
-    // === DRAW SKYBOX (different based on location) ===
-    glDepthMask(GL_FALSE);
-    glm::mat4 skyboxView = glm::mat4(glm::mat3(V));
+    beginSection("Corals");
+    // === DRAW CORALS (swaying, not in the pre-pass) ===
+    coralShader->use();
+    glUniform3fv(coralShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
 
-    if (insideAquarium) {
-        // Underwater skybox
-        skyboxShader->use();
-        glUniformMatrix4fv(skyboxShader->u("P"), 1, false, glm::value_ptr(P));
-        glUniformMatrix4fv(skyboxShader->u("V"), 1, false, glm::value_ptr(skyboxView));
-        glUniform1f(skyboxShader->u("time"), time);
-        glUniform3fv(skyboxShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+    for (Coral* coral : coralDrawOrder) {
+        coral->draw(coralShader, P, V, time);
     }
-    else {
-        // Bright room skybox
-        roomSkyboxShader->use();
-        glUniformMatrix4fv(roomSkyboxShader->u("P"), 1, false, glm::value_ptr(P));
-        glUniformMatrix4fv(roomSkyboxShader->u("V"), 1, false, glm::value_ptr(skyboxView));
-        glUniform1f(roomSkyboxShader->u("time"), time);
-        glUniform3fv(roomSkyboxShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+
+    // Pre-passed geometry only shades the visible surface
+    if (depthPrepass) {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
     }
 
-    glBindVertexArray(skyboxVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    beginSection("Fish");
+    // === DRAW FISH ===
+    for (Fish* fish : fishDrawOrder) {
+        fish->draw(fishShader, P, V, time);
+    }
 
-    glDepthMask(GL_TRUE);
+    beginSection("Stones");
+    // === DRAW STONES ===
+    for (Stone* stone : stoneDrawOrder) {
+        stone->draw(stoneShader, P, V, time);
+    }
 
+    beginSection("Sand");
     // === DRAW SAND FLOOR (inside aquarium only) ===
     sp->use();
     glUniformMatrix4fv(sp->u("P"), 1, false, glm::value_ptr(P));
@@ -482,25 +775,52 @@ void drawScene(GLFWwindow* window, float deltaTime) {
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
 
-    // === DRAW STONES ===
-    for (auto& stone : aquarium_stones) {
-        stone->draw(stoneShader, P, V, time);
-    }
+    beginSection("Outside floor");
+    // === DRAW OUTSIDE FLOOR ===
+    outsideShader->use();
+    glUniformMatrix4fv(outsideShader->u("P"), 1, false, glm::value_ptr(P));
+    glUniformMatrix4fv(outsideShader->u("V"), 1, false, glm::value_ptr(V));
+    glUniformMatrix4fv(outsideShader->u("M"), 1, false, glm::value_ptr(M));
+    glUniform1f(outsideShader->u("time"), time);
+    glUniform3fv(outsideShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
 
-    // === DRAW CORALS ===
-    coralShader->use();
-    glUniform3fv(coralShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, floorDiffuseTexture);
+    glUniform1i(outsideShader->u("floorDiffuse"), 0);
 
-    for (auto& coral : aquarium_corals) {
-        coral->draw(coralShader, P, V, time);
-    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, floorDisplacementTexture);
+    glUniform1i(outsideShader->u("floorDisplacement"), 1);
 
-    // === UPDATE AND DRAW FISH ===
-    for (auto& fish : aquarium_fish) {
-        fish->update(deltaTime);
-        fish->draw(fishShader, P, V, time);
-    }
+    glBindVertexArray(outsideFloorVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
 
+    beginSection("Skybox");
+    // === DRAW SKYBOX LAST (at max depth, early-Z skips every covered pixel) ===
+    // One program for both views: underwater inside the aquarium, bright room outside (roomView uniform).
+    // A single draw per frame, so the uniform branch costs less than a second program to bind and cache
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glm::mat4 skyboxView = glm::mat4(glm::mat3(V));
+
+    skyboxShader->use();
+    glUniformMatrix4fv(skyboxShader->u("P"), 1, false, glm::value_ptr(P));
+    glUniformMatrix4fv(skyboxShader->u("V"), 1, false, glm::value_ptr(skyboxView));
+    glUniform1f(skyboxShader->u("time"), time);
+    glUniform3fv(skyboxShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+    glUniform1i(skyboxShader->u("roomView"), !insideAquarium);
+
+    glBindVertexArray(skyboxVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+
+    prepassSelector->endOpaquePass();
+
+    beginSection("Aquarium frame");
     // === DRAW AQUARIUM FRAME ===
     frameShader->use();
     glUniformMatrix4fv(frameShader->u("P"), 1, false, glm::value_ptr(P));
@@ -514,11 +834,13 @@ void drawScene(GLFWwindow* window, float deltaTime) {
     glDrawArrays(GL_LINES, 0, 16); // 12 edges: 8 horizontal + 4 vertical
     glBindVertexArray(0);
 
+    beginSection("Glass");
     // === DRAW GLASS WALLS ===
     glassShader->use();
     glUniformMatrix4fv(glassShader->u("P"), 1, false, glm::value_ptr(P));
     glUniformMatrix4fv(glassShader->u("V"), 1, false, glm::value_ptr(V));
     glUniformMatrix4fv(glassShader->u("M"), 1, false, glm::value_ptr(M));
+    glUniformMatrix3fv(glassShader->u("N"), 1, false, glm::value_ptr(glm::mat3(1.0f))); // M is identity
     glUniform1f(glassShader->u("time"), time);
     glUniform3fv(glassShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
 
@@ -526,17 +848,29 @@ void drawScene(GLFWwindow* window, float deltaTime) {
     glDrawArrays(GL_TRIANGLES, 0, 24);
     glBindVertexArray(0);
 
+    beginSection("Water fog");
     // === DRAW WATER FOG (only when inside aquarium) ===
     if (insideAquarium) {
+        if (lowResFog) {
+            fogPass->beginFog();
+        }
+
         // Disable depth writing for fog volume
         glDepthMask(GL_FALSE);
 
-        waterFogShader->use();
-        glUniformMatrix4fv(waterFogShader->u("P"), 1, false, glm::value_ptr(P));
-        glUniformMatrix4fv(waterFogShader->u("V"), 1, false, glm::value_ptr(V));
-        glUniformMatrix4fv(waterFogShader->u("M"), 1, false, glm::value_ptr(M));
-        glUniform1f(waterFogShader->u("time"), time);
-        glUniform3fv(waterFogShader->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+        // Baked noise volume or analytic noise, chosen by shader permutation
+        ShaderProgram* fog = useFogNoiseVolume ? waterFogVolumeShader : waterFogShader;
+        fog->use();
+        glUniformMatrix4fv(fog->u("P"), 1, false, glm::value_ptr(P));
+        glUniformMatrix4fv(fog->u("V"), 1, false, glm::value_ptr(V));
+        glUniformMatrix4fv(fog->u("M"), 1, false, glm::value_ptr(M));
+        glUniform1f(fog->u("time"), time);
+        glUniform3fv(fog->u("cameraPos"), 1, glm::value_ptr(cameraPos));
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_3D, fogNoiseVolume->getTexture());
+        glUniform1i(fog->u("noiseVolume"), 0);
+        glUniform3fv(fog->u("noiseVolumeScale"), 1, glm::value_ptr(1.0f / NoiseVolume::getPeriod()));
 
         glBindVertexArray(waterFogVAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -544,55 +878,389 @@ void drawScene(GLFWwindow* window, float deltaTime) {
 
         // Re-enable depth writing
         glDepthMask(GL_TRUE);
+
+        if (lowResFog) {
+            fogPass->composite(nearPlane, farPlane);
+        }
+    }
+
+    gpuProfiler->endFrame();
+    if (window != NULL) {
+        section.next("Swap buffers");
+        glfwSwapBuffers(window);
     }
+}
+
+void printUsage(const char* program) {
+    printf("Usage: %s [options]\n"
+        "  --headless            render offscreen (EGL or hidden window), no vsync, then exit\n"
+        "  --resolution WxH      window or offscreen size (default 800x600)\n"
+        "  --frames N            headless: frames to render (default 300)\n"
+        "  --timestep S          headless: simulated seconds per frame (default 1/60)\n"
+        "  --seed N              fixed seed for stone, coral and fish placement and movement\n"
+        "  --camera PATH         orbit or fixed (headless), or a recorded .aqcp file to replay\n"
+        "  --output FILE.png     headless: save the last frame\n"
+        "  --no-vsync            windowed: don't wait for vertical sync\n"
+        "  --trust-textures      don't verify the CRC and Adler-32 checksums of the textures\n"
+        "  --benchmark FILE      run a benchmark scenario (benchmarks/*.txt) headless\n"
+        "  --report FILE.json    benchmark: write the JSON report here instead of stdout\n"
+        "  --golden-record DIR   headless: store every Nth frame as a golden reference\n"
+        "  --golden-check DIR    headless: compare frames against DIR, exit code 1 on a mismatch\n"
+        "  --golden-interval N   golden: frames between compared frames (default 30)\n"
+        "  --golden-tolerance N  golden: per channel difference ignored (default 8)\n"
+        "  --golden-min-ssim X   golden: lowest accepted SSIM (default 0.99)\n", program);
+}
 
-    glfwSwapBuffers(window);
+// Returns false if the arguments are invalid or only help was requested
+bool parseOptions(int argc, char** argv, bool& failed) {
+    failed = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg == "--no-vsync") {
+            options.vsync = false;
+        }
+        else if (arg == "--trust-textures") {
+            options.trustTextures = true;
+        }
+        else if (arg == "--resolution" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                fprintf(stderr, "Invalid resolution: %s\n", argv[i]);
+                failed = true;
+            }
+        }
+        else if (arg == "--frames" && hasValue) {
+            options.framesSet = true;
+            options.frames = atoi(argv[++i]);
+            if (options.frames <= 0) {
+                fprintf(stderr, "Invalid frame count: %s\n", argv[i]);
+                failed = true;
+            }
+        }
+        else if (arg == "--timestep" && hasValue) {
+            options.timestep = (float)atof(argv[++i]);
+            if (options.timestep <= 0.0f) {
+                fprintf(stderr, "Invalid timestep: %s\n", argv[i]);
+                failed = true;
+            }
+        }
+        else if (arg == "--seed" && hasValue) {
+            options.seed = (unsigned)strtoul(argv[++i], NULL, 10);
+            options.seedSet = true;
+        }
+        else if (arg == "--camera" && hasValue) {
+            options.cameraPath = argv[++i];
+        }
+        else if (arg == "--output" && hasValue) {
+            options.outputImage = argv[++i];
+        }
+        else if (arg == "--benchmark" && hasValue) {
+            options.benchmarkFile = argv[++i];
+        }
+        else if (arg == "--report" && hasValue) {
+            options.reportFile = argv[++i];
+        }
+        else if ((arg == "--golden-record" || arg == "--golden-check") && hasValue) {
+            options.goldenRecord = arg == "--golden-record";
+            options.goldenDirectory = argv[++i];
+            options.headless = true;
+        }
+        else if (arg == "--golden-interval" && hasValue) {
+            options.goldenInterval = atoi(argv[++i]);
+            if (options.goldenInterval <= 0) {
+                fprintf(stderr, "Invalid golden interval: %s\n", argv[i]);
+                failed = true;
+            }
+        }
+        else if (arg == "--golden-tolerance" && hasValue) {
+            options.goldenThresholds.tolerance = atoi(argv[++i]);
+        }
+        else if (arg == "--golden-min-ssim" && hasValue) {
+            options.goldenThresholds.minSsim = atof(argv[++i]);
+        }
+        else {
+            if (arg != "--help" && arg != "-h") {
+                fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                failed = true;
+            }
+            printUsage(argv[0]);
+            return false;
+        }
+        if (failed) return false;
+    }
+    return true;
 }
 
-int main(void) {
-    GLFWwindow* window;
+// Window loop: real time, input, hot reload
+void runInteractive(GLFWwindow* window) {
+    float deltaTime = 0.0f;
+    float lastFrame = 0.0f;
+    int replayFrame = 0;
+
+    while (!glfwWindowShouldClose(window)) {
+        PROFILE_SCOPE("Frame");
+        float currentFrame = glfwGetTime();
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+        float time = currentFrame;
+
+        // A replay runs on the fixed timestep (frame for frame like a headless replay),
+        // then hands the camera back to the mouse and keyboard
+        if (replayingCamera) {
+            time = replayFrame++ * options.timestep;
+            deltaTime = options.timestep;
+            if (time > cameraReplay.getDuration()) {
+                replayingCamera = false;
+                std::cout << "Camera replay finished" << std::endl;
+            }
+            else {
+                updateCameraPath(time);
+            }
+        }
+
+        // Pick up edited GLSL files (programs are swapped only if the new version links)
+        {
+            PROFILE_SCOPE("Shader hot reload");
+            shaders->reloadChanged();
+        }
+
+        drawScene(window, deltaTime, time);
+        if (recordingCamera) {
+            CameraPath::Sample sample = { currentFrame - recordingStart, cameraPos, yaw, pitch, fov };
+            cameraRecording.add(sample);
+        }
+        fogModeFrameTime += deltaTime;
+        fogModeFrames++;
+        {
+            PROFILE_SCOPE("Poll events");
+            glfwPollEvents();
+        }
+    }
+}
+
+// Fixed number of frames with simulated time, so every run renders the same images
+int runHeadless(HeadlessContext& context) {
+    std::cout << "Headless: " << options.frames << " frames at " << options.width << "x" << options.height
+        << " (" << context.getBackend() << "), seed " << options.seed << ", camera " << options.cameraPath << std::endl;
+
+    // Golden frames are read back with glReadPixels, which stalls; time such runs with care
+    std::unique_ptr<GoldenImages> golden;
+    if (!options.goldenDirectory.empty()) {
+        golden.reset(new GoldenImages(options.goldenRecord ? GoldenImages::RECORD : GoldenImages::CHECK,
+            options.goldenDirectory, options.goldenThresholds));
+    }
+    std::vector<unsigned char> frameImage;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < options.frames; ++frame) {
+        PROFILE_SCOPE("Frame");
+        float time = frame * options.timestep;
+        updateCameraPath(time);
+        drawScene(NULL, options.timestep, time);
+
+        if (golden && (frame % options.goldenInterval == 0 || frame == options.frames - 1)) {
+            PROFILE_SCOPE("Golden image");
+            context.readPixels(frameImage);
+            golden->processFrame(frame, frameImage, options.width, options.height);
+        }
+
+        // Nothing is presented, so nothing else submits the queued commands
+        glFlush();
+    }
+    glFinish();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Rendered " << options.frames << " frames in " << elapsed.count() << " ms: "
+        << elapsed.count() / options.frames << " ms/frame, "
+        << options.frames * 1000.0 / elapsed.count() << " frames/s" << std::endl;
+    gpuProfiler->report();
+
+    if (!options.outputImage.empty()) {
+        std::vector<unsigned char> image;
+        context.readPixels(image);
+        lodepng::State state;
+        state.encoder.zlibsettings.level = 1;
+        std::vector<unsigned char> png;
+        unsigned error = lodepng::encodeParallel(png, image, options.width, options.height, state);
+        if (!error) error = lodepng::save_file(png, options.outputImage);
+        if (error) {
+            std::cout << "Cannot write " << options.outputImage << ": " << lodepng_error_text(error) << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Last frame written to " << options.outputImage << std::endl;
+    }
+
+    if (golden) {
+        golden->report();
+        if (golden->getFailures() > 0) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Run a benchmark scenario: warmup frames, then measured frames with simulated time.
+// Rendered frames end with glFinish, so a frame time includes its GPU work.
+int runBenchmark(BenchmarkScenario& scenario, double setupMilliseconds) {
+    scenario.fish = (int)aquarium_fish.size();
+    scenario.corals = (int)aquarium_corals.size();
+    scenario.stones = (int)aquarium_stones.size();
+    scenario.seed = options.seed; // a camera recording's seed when the scenario has none
+    std::cerr << "Benchmark " << scenario.name << ": " << scenario.getModeName() << ", " << scenario.fish << " fish, "
+        << scenario.corals << " corals, " << scenario.stones << " stones, " << scenario.frames << " frames" << std::endl;
+
+    simulateFish = scenario.simulates();
+    BenchmarkReport report;
+    report.reserve(scenario.frames);
+
+    for (int frame = 0; frame < scenario.warmupFrames + scenario.frames; ++frame) {
+        PROFILE_SCOPE("Frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        float time = frame * scenario.timestep;
+
+        if (scenario.renders()) {
+            updateCameraPath(time);
+            drawScene(NULL, scenario.timestep, time);
+            glFinish();
+        }
+        else {
+            updateFish(scenario.timestep);
+        }
+
+        std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+        if (frame >= scenario.warmupFrames) {
+            report.addFrame(frameTime.count());
+        }
+    }
+
+    const char* reportFile = options.reportFile.empty() ? NULL : options.reportFile.c_str();
+    if (!report.writeJson(reportFile, scenario, setupMilliseconds)) {
+        std::cerr << "Cannot write benchmark report " << options.reportFile << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    GLFWwindow* window = NULL;
+    HeadlessContext* headless = NULL;
 
     glfwSetErrorCallback(error_callback);
+    Profiler::setThreadName("Main");
 
-    if (!glfwInit()) {
-        fprintf(stderr, "Cannot initialize GLFW.\n");
-        exit(EXIT_FAILURE);
+    bool failed;
+    if (!parseOptions(argc, argv, failed)) {
+        exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
     }
 
-    window = glfwCreateWindow(800, 600, "Aquarium with Fish and Corals", NULL, NULL);
+    // A benchmark is a headless run configured by its scenario file
+    BenchmarkScenario scenario;
+    if (!options.benchmarkFile.empty()) {
+        if (!scenario.load(options.benchmarkFile.c_str())) {
+            exit(EXIT_FAILURE);
+        }
+        options.headless = true;
+        if (scenario.seedSet) {
+            options.seed = scenario.seed;
+            options.seedSet = true;
+        }
+        options.width = scenario.width;
+        options.height = scenario.height;
+        options.cameraPath = scenario.camera;
+        options.fishCount = scenario.fish;
+        options.coralCount = scenario.corals;
+        options.stoneCount = scenario.stones;
+    }
 
-    if (!window) {
-        fprintf(stderr, "Cannot create window.\n");
-        glfwTerminate();
-        exit(EXIT_FAILURE);
+    // Replay a recording with the scene seed it was recorded with (unless --seed
+    // or the benchmark scenario says otherwise) and, headless, for its whole length
+    if (options.cameraPath != "orbit" && options.cameraPath != "fixed") {
+        if (!cameraReplay.load(options.cameraPath.c_str())) {
+            exit(EXIT_FAILURE);
+        }
+        replayingCamera = true;
+        if (!options.seedSet) {
+            options.seed = cameraReplay.getSeed();
+            options.seedSet = true;
+        }
+        if (!options.framesSet) {
+            options.frames = (int)(cameraReplay.getDuration() / options.timestep) + 1;
+        }
+    }
+
+    // Headless runs are reproducible by default
+    if (options.seedSet || options.headless) {
+        Random::seed(options.seed);
+    }
+
+    if (options.headless) {
+        headless = new HeadlessContext(options.width, options.height);
+        if (!headless->createContext()) {
+            fprintf(stderr, "Cannot create a headless OpenGL context.\n");
+            delete headless;
+            exit(EXIT_FAILURE);
+        }
     }
+    else {
+        if (!glfwInit()) {
+            fprintf(stderr, "Cannot initialize GLFW.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        window = glfwCreateWindow(options.width, options.height, "Aquarium with Fish and Corals", NULL, NULL);
+
+        if (!window) {
+            fprintf(stderr, "Cannot create window.\n");
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
 
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(options.vsync ? 1 : 0);
+    }
 
-    if (glewInit() != GLEW_OK) {
+    // A GLX build of GLEW loads every GL function and only then fails to find a GLX display under EGL
+    GLenum glewStatus = glewInit();
+    bool eglWithoutGlx = headless != NULL && headless->usesEgl() && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY;
+    if (glewStatus != GLEW_OK && !eglWithoutGlx) {
         fprintf(stderr, "Cannot initialize GLEW.\n");
         exit(EXIT_FAILURE);
     }
 
-    initOpenGLProgram(window);
-
-    // Main loop with delta time
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+    if (headless != NULL) {
+        if (!headless->createFramebuffer()) {
+            delete headless;
+            exit(EXIT_FAILURE);
+        }
+        outputFramebuffer = headless->getFramebuffer();
+    }
 
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+    auto setupStart = std::chrono::steady_clock::now();
+    initOpenGLProgram(window);
+    std::chrono::duration<double, std::milli> setupTime = std::chrono::steady_clock::now() - setupStart;
 
-        drawScene(window, deltaTime);
-        glfwPollEvents();
+    int exitCode = EXIT_SUCCESS;
+    if (!options.benchmarkFile.empty()) {
+        exitCode = runBenchmark(scenario, setupTime.count());
+    }
+    else if (headless != NULL) {
+        exitCode = runHeadless(*headless);
+    }
+    else {
+        runInteractive(window);
     }
 
     freeOpenGLProgram(window);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
-    exit(EXIT_SUCCESS);
-}
\ No newline at end of file
+    if (headless != NULL) {
+        delete headless;
+    }
+    else {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+    exit(exitCode);
+}
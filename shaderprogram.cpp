@@ -18,6 +18,13 @@ Place, Fifth Floor, Boston, MA  02110 - 1301  USA
 */
 
 #include "shaderprogram.h"
+#include <string.h>
+#include <utility>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 
 
@@ -46,20 +53,64 @@ char* ShaderProgram::readFile(const char* fileName) {
 
 }
 
-//Metoda wczytuje i kompiluje shader, a następnie zwraca jego uchwyt
-GLuint ShaderProgram::loadShader(GLenum shaderType,const char* fileName) {
+//Metoda wstawia dyrektywy #define (nazwy oddzielone spacjami) zaraz za linią #version.
+//Zwraca nową tablicę znaków, źródło przekazane w parametrze jest zwalniane.
+char* ShaderProgram::injectDefines(char* source,const char* defines) {
+	if (source==NULL || defines==NULL || *defines==0) return source;
+
+	//Miejsce wstawienia - początek linii za #version (lub początek pliku)
+	const char* version=strstr(source,"#version");
+	size_t insertAt=0;
+	if (version!=NULL) {
+		const char* lineEnd=strchr(version,'\n');
+		insertAt=lineEnd!=NULL ? (size_t)(lineEnd-source)+1 : strlen(source);
+	}
+
+	//Numer kolejnej linii źródła, aby logi kompilacji wskazywały właściwe linie pliku
+	int nextLine=1;
+	for (size_t i=0;i<insertAt;i++) if (source[i]=='\n') nextLine++;
+
+	std::string header;
+	if (insertAt>0 && source[insertAt-1]!='\n') {
+		header+="\n";
+		nextLine++;
+	}
+	const char* p=defines;
+	while (*p) {
+		while (*p==' ') p++;
+		const char* nameEnd=p;
+		while (*nameEnd && *nameEnd!=' ') nameEnd++;
+		if (nameEnd>p) header+="#define "+std::string(p,nameEnd)+" 1\n";
+		p=nameEnd;
+	}
+	header+="#line "+std::to_string(nextLine)+"\n";
+
+	size_t sourceLength=strlen(source);
+	char* result=new char[sourceLength+header.size()+1];
+	memcpy(result,source,insertAt);
+	memcpy(result+insertAt,header.c_str(),header.size());
+	memcpy(result+insertAt+header.size(),source+insertAt,sourceLength-insertAt+1);
+	delete []source;
+	return result;
+}
+
+//Metoda kompiluje shader z tekstu źródłowego, a następnie zwraca jego uchwyt
+GLuint ShaderProgram::compileShader(GLenum shaderType,const char* shaderSource) {
+	//Brak pliku (np. w trakcie zapisu przez edytor) - kompilacja się nie powiedzie zamiast błędu dostępu do pamięci
+	if (shaderSource==NULL) shaderSource="";
 	//Wygeneruj uchwyt na shader
 	GLuint shader=glCreateShader(shaderType);//shaderType to GL_VERTEX_SHADER, GL_GEOMETRY_SHADER lub GL_FRAGMENT_SHADER
-	//Wczytaj plik ze źródłem shadera do tablicy znaków
-	const GLchar* shaderSource=readFile(fileName);
 	//Powiąż źródło z uchwytem shadera
 	glShaderSource(shader,1,&shaderSource,NULL);
-	//Skompiluj źródło
+	//Skompiluj źródło (bez odpytywania o wynik - log pobiera finalize(), aby nie czekać na sterownik)
 	glCompileShader(shader);
-	//Usuń źródło shadera z pamięci (nie będzie już potrzebne)
-	delete []shaderSource;
 
-	//Pobierz log błędów kompilacji i wyświetl
+	//Zwróć uchwyt wygenerowanego shadera
+	return shader;
+}
+
+//Metoda wyświetla log błędów kompilacji shadera
+void ShaderProgram::printShaderLog(GLuint shader) {
 	int infologLength = 0;
 	int charsWritten  = 0;
 	char *infoLog;
@@ -72,37 +123,215 @@ GLuint ShaderProgram::loadShader(GLenum shaderType,const char* fileName) {
 		printf("%s\n",infoLog);
 		delete []infoLog;
 	}
+}
 
-	//Zwróć uchwyt wygenerowanego shadera
-	return shader;
+//Równoległa kompilacja shaderów (GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile)
+bool ShaderProgram::parallelCompileSupported() {
+	return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+bool ShaderProgram::enableParallelCompile() {
+	//0xFFFFFFFF - sterownik sam wybiera liczbę wątków kompilatora
+	if (GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	} else if (GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	} else {
+		printf("Parallel shader compilation not supported, programs will be compiled serially\n");
+		return false;
+	}
+	printf("Parallel shader compilation enabled\n");
+	return true;
+}
+
+//Pamięć podręczna binariów programów (glGetProgramBinary/glProgramBinary)
+const char* ShaderProgram::binaryCacheDirectory = "shader_cache";
+
+//Nagłówek pliku w pamięci podręcznej, za nim binaria programu
+struct ProgramBinaryHeader {
+	char magic[4]; //"SPBC"
+	GLenum format; //Format binariów zwrócony przez sterownik
+	GLint length; //Długość binariów w bajtach
+};
+
+bool ShaderProgram::binaryCacheSupported() {
+	return GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary;
+}
+
+//Skrót FNV-1a 64-bit
+static unsigned long long fnv1a(unsigned long long hash, const char* text) {
+	if (text == NULL) text = "";
+	for (; *text; text++) {
+		hash ^= (unsigned char)*text;
+		hash *= 1099511628211ULL;
+	}
+	//Separator, aby "ab"+"c" i "a"+"bc" dawały różne skróty
+	hash ^= 0xff;
+	hash *= 1099511628211ULL;
+	return hash;
+}
+
+std::string ShaderProgram::binaryCachePath(const char* vertexSource,const char* geometrySource,const char* fragmentSource) {
+	//Binaria są ważne tylko dla tych samych źródeł i tego samego sterownika
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = fnv1a(hash, vertexSource);
+	hash = fnv1a(hash, geometrySource);
+	hash = fnv1a(hash, fragmentSource);
+	hash = fnv1a(hash, (const char*)glGetString(GL_VENDOR));
+	hash = fnv1a(hash, (const char*)glGetString(GL_RENDERER));
+	hash = fnv1a(hash, (const char*)glGetString(GL_VERSION));
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", hash);
+	return std::string(binaryCacheDirectory) + "/" + name;
+}
+
+bool ShaderProgram::loadBinary(const std::string& cacheFile) {
+	#pragma warning(suppress : 4996)
+	FILE* plik = fopen(cacheFile.c_str(), "rb");
+	if (plik == NULL) return false;
+
+	ProgramBinaryHeader header;
+	bool ok = fread(&header, sizeof(header), 1, plik) == 1 &&
+		memcmp(header.magic, "SPBC", 4) == 0 && header.length > 0;
+
+	char* binary = NULL;
+	if (ok) {
+		binary = new char[header.length];
+		ok = fread(binary, 1, header.length, plik) == (size_t)header.length;
+	}
+	fclose(plik);
+
+	if (ok) {
+		glProgramBinary(shaderProgram, header.format, binary, header.length);
+		GLint linked = GL_FALSE;
+		glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linked);
+		//Sterownik może odrzucić binaria (np. po aktualizacji) - wtedy kompilujemy ze źródeł
+		ok = linked == GL_TRUE;
+	}
+	delete []binary;
+	return ok;
+}
+
+void ShaderProgram::saveBinary(const std::string& cacheFile) {
+	GLint length = 0;
+	glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	ProgramBinaryHeader header;
+	memcpy(header.magic, "SPBC", 4);
+	header.length = length;
+	char* binary = new char[length];
+	glGetProgramBinary(shaderProgram, length, NULL, &header.format, binary);
+
+	#ifdef _WIN32
+	_mkdir(binaryCacheDirectory);
+	#else
+	mkdir(binaryCacheDirectory, 0755);
+	#endif
+
+	#pragma warning(suppress : 4996)
+	FILE* plik = fopen(cacheFile.c_str(), "wb");
+	if (plik != NULL) {
+		fwrite(&header, sizeof(header), 1, plik);
+		fwrite(binary, 1, length, plik);
+		fclose(plik);
+	}
+	delete []binary;
 }
 
-ShaderProgram::ShaderProgram(const char* vertexShaderFile,const char* geometryShaderFile,const char* fragmentShaderFile) {
+ShaderProgram::ShaderProgram(const char* vertexShaderFile,const char* geometryShaderFile,const char* fragmentShaderFile,const char* defines) {
+	vertexShader=0;
+	geometryShader=0;
+	fragmentShader=0;
+	fromBinaryCache=false;
+	finalized=false;
+	vertexFile=vertexShaderFile;
+	geometryFile=geometryShaderFile!=NULL ? geometryShaderFile : "";
+	fragmentFile=fragmentShaderFile;
+	this->defines=defines!=NULL ? defines : "";
+
+	//Wczytaj źródła (potrzebne także do skrótu w pamięci podręcznej)
+	char* vertexSource=readFile(vertexShaderFile);
+	char* geometrySource=geometryShaderFile!=NULL ? readFile(geometryShaderFile) : NULL;
+	char* fragmentSource=readFile(fragmentShaderFile);
+
+	//Wariant programu (permutacja) - dyrektywy #define trafiają do wszystkich etapów,
+	//więc skrót w pamięci podręcznej binariów rozróżnia też permutacje
+	if (defines!=NULL && *defines!=0) {
+		printf("Shader permutation: %s\n", defines);
+		vertexSource=injectDefines(vertexSource,defines);
+		geometrySource=injectDefines(geometrySource,defines);
+		fragmentSource=injectDefines(fragmentSource,defines);
+	}
+
+	//Wygeneruj uchwyt programu cieniującego
+	shaderProgram=glCreateProgram();
+
+	//Spróbuj wczytać gotowe binaria zamiast kompilować
+	useBinaryCache=binaryCacheSupported();
+	if (useBinaryCache) {
+		cacheFile=binaryCachePath(vertexSource,geometrySource,fragmentSource);
+		if (loadBinary(cacheFile)) {
+			printf("Shader program loaded from binary cache (%s)\n", cacheFile.c_str());
+			fromBinaryCache=true;
+			finalized=true;
+			delete []vertexSource;
+			delete []geometrySource;
+			delete []fragmentSource;
+			return;
+		}
+	}
+
 	//Wczytaj vertex shader
 	printf("Loading vertex shader...\n");
-	vertexShader=loadShader(GL_VERTEX_SHADER,vertexShaderFile);
+	vertexShader=compileShader(GL_VERTEX_SHADER,vertexSource);
 
 	//Wczytaj geometry shader
-	if (geometryShaderFile!=NULL) {
+	if (geometrySource!=NULL) {
 		printf("Loading geometry shader...\n");
-		geometryShader=loadShader(GL_GEOMETRY_SHADER,geometryShaderFile);
-	} else {
-		geometryShader=0;
+		geometryShader=compileShader(GL_GEOMETRY_SHADER,geometrySource);
 	}
 
 	//Wczytaj fragment shader
 	printf("Loading fragment shader...\n");
-	fragmentShader=loadShader(GL_FRAGMENT_SHADER,fragmentShaderFile);
+	fragmentShader=compileShader(GL_FRAGMENT_SHADER,fragmentSource);
 
-	//Wygeneruj uchwyt programu cieniującego
-	shaderProgram=glCreateProgram();
+	delete []vertexSource;
+	delete []geometrySource;
+	delete []fragmentSource;
 
 	//Podłącz do niego shadery i zlinkuj program
 	glAttachShader(shaderProgram,vertexShader);
 	glAttachShader(shaderProgram,fragmentShader);
-	if (geometryShaderFile!=NULL) glAttachShader(shaderProgram,geometryShader);
+	if (geometryShader!=0) glAttachShader(shaderProgram,geometryShader);
+	if (useBinaryCache) glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(shaderProgram);
 
+	//Logi i status linkowania pobiera finalize() - do tego czasu sterownik może kompilować w tle
+}
+
+//Sprawdza bez blokowania, czy kompilacja i linkowanie już się zakończyły
+bool ShaderProgram::isReady() {
+	if (finalized) return true;
+	//Bez rozszerzenia nie da się tego sprawdzić bez czekania na sterownik - nic nie kompilowało się w tle
+	if (!parallelCompileSupported()) return false;
+
+	GLint completed = GL_FALSE;
+	glGetProgramiv(shaderProgram, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+
+//Kończy tworzenie programu: wyświetla logi, sprawdza linkowanie i zapisuje binaria
+void ShaderProgram::finalize() {
+	if (finalized) return;
+	finalized=true;
+
+	//Pobierz logi błędów kompilacji i wyświetl
+	printShaderLog(vertexShader);
+	if (geometryShader!=0) printShaderLog(geometryShader);
+	printShaderLog(fragmentShader);
+
 	//Pobierz log błędów linkowania i wyświetl
 	int infologLength = 0;
 	int charsWritten  = 0;
@@ -118,36 +347,95 @@ ShaderProgram::ShaderProgram(const char* vertexShaderFile,const char* geometrySh
 		delete []infoLog;
 	}
 
+	//Zapisz zlinkowany program do pamięci podręcznej na kolejne uruchomienia
+	GLint linked = GL_FALSE;
+	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linked);
+	if (useBinaryCache && linked == GL_TRUE) saveBinary(cacheFile);
+
 	printf("Shader program created \n");
 }
 
 ShaderProgram::~ShaderProgram() {
-	//Odłącz shadery od programu
-	glDetachShader(shaderProgram, vertexShader);
+	//Odłącz shadery od programu (program z pamięci podręcznej nie ma obiektów shaderów)
+	if (vertexShader!=0) glDetachShader(shaderProgram, vertexShader);
 	if (geometryShader!=0) glDetachShader(shaderProgram, geometryShader);
-	glDetachShader(shaderProgram, fragmentShader);
+	if (fragmentShader!=0) glDetachShader(shaderProgram, fragmentShader);
 
 	//Wykasuj shadery
-	glDeleteShader(vertexShader);
+	if (vertexShader!=0) glDeleteShader(vertexShader);
 	if (geometryShader!=0) glDeleteShader(geometryShader);
-	glDeleteShader(fragmentShader);
+	if (fragmentShader!=0) glDeleteShader(fragmentShader);
 
 	//Wykasuj program
 	glDeleteProgram(shaderProgram);
 }
 
 
+//Kompiluje program ponownie z aktualnych plików. Stary program jest podmieniany dopiero wtedy,
+//gdy nowy się zlinkuje, więc błąd w shaderze nie psuje działającej aplikacji.
+bool ShaderProgram::reload() {
+	finalize();
+
+	ShaderProgram* candidate=new ShaderProgram(vertexFile.c_str(),geometryFile.empty() ? NULL : geometryFile.c_str(),
+		fragmentFile.c_str(),defines.empty() ? NULL : defines.c_str());
+	candidate->finalize();
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(candidate->shaderProgram, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) {
+		printf("Shader reload failed, keeping previous program (%s)\n", getFiles().c_str());
+		delete candidate;
+		return false;
+	}
+
+	//Zamień uchwyty - obiekt (i wskaźniki na niego) zostaje, stary program usuwa destruktor kandydata
+	std::swap(shaderProgram, candidate->shaderProgram);
+	std::swap(vertexShader, candidate->vertexShader);
+	std::swap(geometryShader, candidate->geometryShader);
+	std::swap(fragmentShader, candidate->fragmentShader);
+	std::swap(fromBinaryCache, candidate->fromBinaryCache);
+	std::swap(cacheFile, candidate->cacheFile);
+	delete candidate;
+
+	//Numery slotów nowego programu mogą być inne
+	uniformLocations.clear();
+
+	printf("Shader program reloaded (%s)\n", getFiles().c_str());
+	return true;
+}
+
+bool ShaderProgram::usesFile(const std::string& fileName) const {
+	return fileName==vertexFile || fileName==geometryFile || fileName==fragmentFile;
+}
+
+std::string ShaderProgram::getFiles() const {
+	std::string result=vertexFile;
+	if (!geometryFile.empty()) result+=", "+geometryFile;
+	result+=", "+fragmentFile;
+	if (!defines.empty()) result+=" ["+defines+"]";
+	return result;
+}
+
 //Włącz używanie programu cieniującego reprezentowanego przez aktualny obiekt
 void ShaderProgram::use() {
+	finalize();
 	glUseProgram(shaderProgram);
 }
 
 //Pobierz numer slotu odpowiadającego zmiennej jednorodnej o nazwie variableName
 GLuint ShaderProgram::u(const char* variableName) {
-	return glGetUniformLocation(shaderProgram,variableName);
+	finalize();
+	//glGetUniformLocation przeszukuje listę zmiennych w sterowniku - zapamiętaj wynik
+	std::unordered_map<std::string,GLuint>::iterator found=uniformLocations.find(variableName);
+	if (found!=uniformLocations.end()) return found->second;
+
+	GLuint location=glGetUniformLocation(shaderProgram,variableName);
+	uniformLocations[variableName]=location;
+	return location;
 }
 
 //Pobierz numer slotu odpowiadającego atrybutowi o nazwie variableName
 GLuint ShaderProgram::a(const char* variableName) {
+	finalize();
 	return glGetAttribLocation(shaderProgram,variableName);
 }
@@ -24,6 +24,8 @@ Place, Fifth Floor, Boston, MA  02110 - 1301  USA
 
 #include <GL/glew.h>
 #include "stdio.h"
+#include <string>
+#include <unordered_map>
 
 
 
@@ -33,11 +35,35 @@ private:
 	GLuint vertexShader; //Uchwyt reprezentujący vertex shader
 	GLuint geometryShader; //Uchwyt reprezentujący geometry shader
 	GLuint fragmentShader; //Uchwyt reprezentujący fragment shader
+	bool fromBinaryCache; //Czy program został wczytany z pamięci podręcznej binariów
+	bool finalized; //Czy logi i status linkowania zostały już pobrane
+	bool useBinaryCache; //Czy zapisać binaria po udanym linkowaniu
+	std::string cacheFile; //Plik programu w pamięci podręcznej binariów
+	std::string vertexFile,geometryFile,fragmentFile; //Pliki źródłowe (do ponownego wczytania)
+	std::string defines; //Flagi permutacji
+	std::unordered_map<std::string,GLuint> uniformLocations; //Zapamiętane numery slotów zmiennych jednorodnych
 	char* readFile(const char* fileName); //metoda wczytująca plik tekstowy do tablicy znaków
-	GLuint loadShader(GLenum shaderType,const char* fileName); //Metoda wczytuje i kompiluje shader, a następnie zwraca jego uchwyt
+	static char* injectDefines(char* source,const char* defines); //Wstawia dyrektywy #define za linią #version
+	GLuint compileShader(GLenum shaderType,const char* shaderSource); //Metoda zleca kompilację shadera z tekstu źródłowego i zwraca jego uchwyt
+	void printShaderLog(GLuint shader); //Wyświetla log kompilacji shadera
+	static bool parallelCompileSupported(); //Czy sterownik obsługuje GL_COMPLETION_STATUS_KHR
+	static bool binaryCacheSupported(); //Czy sterownik obsługuje glGetProgramBinary/glProgramBinary
+	static std::string binaryCachePath(const char* vertexSource,const char* geometrySource,const char* fragmentSource); //Ścieżka pliku w pamięci podręcznej (skrót źródeł + producent i wersja sterownika)
+	bool loadBinary(const std::string& cacheFile); //Próbuje wczytać zlinkowany program z pliku
+	void saveBinary(const std::string& cacheFile); //Zapisuje zlinkowany program do pliku
 public:
-	ShaderProgram(const char* vertexShaderFile,const char* geometryShaderFile,const char* fragmentShaderFile);
+	static const char* binaryCacheDirectory; //Katalog pamięci podręcznej binariów programów
+
+	static bool enableParallelCompile(); //Włącza równoległą kompilację shaderów w sterowniku (jeśli dostępna)
+
+	ShaderProgram(const char* vertexShaderFile,const char* geometryShaderFile,const char* fragmentShaderFile,const char* defines=NULL); //Zleca kompilację i linkowanie bez czekania na wynik; defines - nazwy flag oddzielone spacjami
 	~ShaderProgram();
+	bool isFromBinaryCache() const { return fromBinaryCache; } //Czy program pochodzi z pamięci podręcznej (bez kompilacji)
+	bool isReady(); //Czy kompilacja i linkowanie już się zakończyły (bez blokowania); false, jeśli sterownik nie potrafi tego sprawdzić
+	void finalize(); //Czeka na zakończenie linkowania, wyświetla logi i zapisuje binaria (wywoływane też przez use/u/a)
+	bool reload(); //Kompiluje program ponownie ze źródeł; podmienia go tylko, jeśli nowa wersja się zlinkuje
+	bool usesFile(const std::string& fileName) const; //Czy program jest budowany z danego pliku
+	std::string getFiles() const; //Nazwy plików źródłowych i flagi (do komunikatów)
 	void use(); //Włącza wykorzystywanie programu cieniującego
 	GLuint u(const char* variableName); //Pobiera numer slotu związanego z daną zmienną jednorodną
 	GLuint a(const char* variableName); //Pobiera numer slotu związanego z danym atrybutem
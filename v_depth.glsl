@@ -0,0 +1,23 @@
+#version 330 core
+
+// Position-only vertex shader for the depth pre-pass.
+// Must compute gl_Position exactly like the color pass shaders (see invariant there).
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 TexCoord;
+
+uniform mat4 M;
+uniform mat4 V;
+uniform mat4 P;
+
+invariant gl_Position;
+
+void main()
+{
+    vec3 WorldPos = vec3(M * vec4(aPos, 1.0));
+    TexCoord = aTexCoord;
+
+    gl_Position = P * V * vec4(WorldPos, 1.0);
+}
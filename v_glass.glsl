@@ -13,6 +13,7 @@ out float DistanceFromCamera;
 uniform mat4 M;
 uniform mat4 V;
 uniform mat4 P;
+uniform mat3 N; // Normal matrix, computed on the CPU
 uniform vec3 cameraPos;
 
 void main()
@@ -20,7 +21,7 @@ void main()
     WorldPos = vec3(M * vec4(aPos, 1.0));
     FragPos = WorldPos;
     TexCoord = aTexCoord;
-    Normal = mat3(transpose(inverse(M))) * aNormal;
+    Normal = N * aNormal;
     
     DistanceFromCamera = length(cameraPos - WorldPos);
     
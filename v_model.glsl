@@ -1,4 +1,5 @@
-// v_coral.glsl - Vertex shader for animated corals
+// v_model.glsl - Vertex shader for OBJ models (fish, corals)
+// Permutation flags (ShaderLibrary): SWAY - coral swaying animation
 #version 330 core
 
 layout (location = 0) in vec3 aPos;
@@ -12,12 +13,20 @@ out vec3 FragPos;
 uniform mat4 P;
 uniform mat4 V;
 uniform mat4 M;
+uniform mat3 N; // Normal matrix, computed on the CPU
+
+#ifdef SWAY
 uniform float time;
 uniform float swayAmplitude;
+#endif
+
+// Depth pre-pass (v_depth.glsl) relies on bit-identical positions
+invariant gl_Position;
 
 void main() {
     vec3 pos = aPos;
-    
+
+#ifdef SWAY
     // Calculate height factor (0 at bottom, 1 at top)
     // Assuming coral grows upward from origin
     float heightFactor = max(0.0, pos.y + 1.0) / 4.0; // Adjust based on coral model
@@ -30,14 +39,11 @@ void main() {
     // Apply swaying to position
     pos.x += swayAmountX;
     pos.z += swayAmountZ;
-    
-    // Transform position
-    vec4 worldPos = M * vec4(pos, 1.0);
-    FragPos = worldPos.xyz;
-    
-    // Transform normal (adjust for swaying)
-    Normal = mat3(transpose(inverse(M))) * aNormal;
+#endif
+
+    FragPos = vec3(M * vec4(pos, 1.0));
+    Normal = N * aNormal;
     TexCoord = aTexCoord;
     
-    gl_Position = P * V * worldPos;
-}
\ No newline at end of file
+    gl_Position = P * V * vec4(FragPos, 1.0);
+}
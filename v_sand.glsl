@@ -13,6 +13,9 @@ uniform mat4 V;
 uniform mat4 P;
 uniform vec3 cameraPos;
 
+// Depth pre-pass (v_depth.glsl) relies on bit-identical positions
+invariant gl_Position;
+
 void main()
 {
     WorldPos = vec3(M * vec4(aPos, 1.0));